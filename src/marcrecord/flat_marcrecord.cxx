@@ -0,0 +1,839 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "flat_marcrecord.h"
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+FlatMarcRecord::FlatMarcRecord()
+{
+	m_formatVariant = MarcRecord::UNIMARC;
+	clear();
+}
+
+FlatMarcRecord::FlatMarcRecord(MarcRecord::FormatVariant formatVariant)
+{
+	m_formatVariant = formatVariant;
+	clear();
+}
+
+/*
+ * Destructor.
+ */
+FlatMarcRecord::~FlatMarcRecord()
+{
+}
+
+/*
+ * Clear record.
+ */
+void
+FlatMarcRecord::clear(void)
+{
+	// Clear field and subfield entries keeping allocated storage.
+	m_fieldList.clear();
+	m_subfieldList.clear();
+	m_data.erase();
+	m_unusedLen = 0;
+	m_firstField = NULL_HANDLE;
+	m_lastField = NULL_HANDLE;
+
+	// Reset record leader.
+	memset(m_leader.recordLength, ' ', sizeof(m_leader.recordLength));
+	m_leader.recordStatus = 'n';
+	m_leader.recordType = 'a';
+	m_leader.bibliographicLevel = 'm';
+	m_leader.hierarchicalLevel = ' ';
+	m_leader.undefined1 = ' ';
+	m_leader.indicatorLength = '2';
+	m_leader.subfieldIdLength = '2';
+	memset(m_leader.baseAddress, ' ', sizeof(m_leader.baseAddress));
+	m_leader.encodingLevel = ' ';
+	m_leader.cataloguingForm = ' ';
+	m_leader.undefined2 = ' ';
+	m_leader.lengthOfFieldLength = '4';
+	m_leader.startingPositionLength = '5';
+	m_leader.implementationDefinedLength = '0';
+	m_leader.undefined3 = ' ';
+}
+
+/*
+ * Get record format variant.
+ */
+MarcRecord::FormatVariant
+FlatMarcRecord::getFormatVariant(void)
+{
+	return m_formatVariant;
+}
+
+/*
+ * Set record format variant.
+ */
+void
+FlatMarcRecord::setFormatVariant(MarcRecord::FormatVariant formatVariant)
+{
+	m_formatVariant = formatVariant;
+}
+
+/*
+ * Get record leader.
+ */
+MarcRecord::Leader &
+FlatMarcRecord::getLeader(void)
+{
+	return m_leader;
+}
+
+/*
+ * Set record leader.
+ */
+void
+FlatMarcRecord::setLeader(const MarcRecord::Leader &leader)
+{
+	m_leader = leader;
+}
+
+void
+FlatMarcRecord::setLeader(const std::string &leaderData)
+{
+	memcpy((void *) &m_leader, leaderData.c_str(),
+		std::min(sizeof(MarcRecord::Leader), leaderData.size()));
+}
+
+/*
+ * Copy content of MARC record.
+ */
+void
+FlatMarcRecord::assign(MarcRecord &record)
+{
+	clear();
+	m_formatVariant = record.getFormatVariant();
+	m_leader = record.getLeader();
+
+	// Copy fields.
+	record.decodeFields();
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		if (fieldIt->isControlField()) {
+			addControlField(fieldIt->m_tag, fieldIt->m_data);
+			continue;
+		}
+
+		// Copy data field with subfields.
+		FieldIt newFieldIt = addDataField(fieldIt->m_tag,
+			fieldIt->m_ind1, fieldIt->m_ind2);
+		for (MarcRecord::SubfieldIt subfieldIt =
+			fieldIt->m_subfieldList.begin();
+			subfieldIt != fieldIt->m_subfieldList.end();
+			subfieldIt++)
+		{
+			addSubfield(newFieldIt, subfieldIt->m_id,
+				subfieldIt->m_data);
+		}
+	}
+}
+
+/*
+ * Copy content to MARC record.
+ */
+void
+FlatMarcRecord::toMarcRecord(MarcRecord &record)
+{
+	record.clear();
+	record.setFormatVariant(m_formatVariant);
+	record.setLeader(m_leader);
+
+	// Copy fields through single buffer keeping its capacity.
+	std::string data;
+	for (FieldIt fieldIt = m_firstField; fieldIt != NULL_HANDLE;
+		fieldIt = m_fieldList[fieldIt].nextField)
+	{
+		FieldEntry &field = m_fieldList[fieldIt];
+		if (field.controlField) {
+			data.assign(m_data, field.dataPos, field.dataLen);
+			record.addControlField(field.tag, data);
+			continue;
+		}
+
+		// Copy data field with subfields.
+		MarcRecord::FieldIt newFieldIt = record.addDataField(field.tag,
+			field.ind1, field.ind2);
+		for (SubfieldIt subfieldIt = field.firstSubfield;
+			subfieldIt != NULL_HANDLE;
+			subfieldIt = m_subfieldList[subfieldIt].nextSubfield)
+		{
+			SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+			data.assign(m_data, subfield.dataPos, subfield.dataLen);
+			newFieldIt->addSubfield(subfield.id, data);
+		}
+	}
+}
+
+/*
+ * Get list of fields.
+ */
+FlatMarcRecord::FieldRefList
+FlatMarcRecord::getFields(const std::string &fieldTag)
+{
+	FieldRefList resultFieldList;
+
+	// Check fields in list.
+	for (FieldIt fieldIt = m_firstField; fieldIt != NULL_HANDLE;
+		fieldIt = m_fieldList[fieldIt].nextField)
+	{
+		if (fieldTag == "" || hasTag(fieldIt, fieldTag)) {
+			resultFieldList.push_back(fieldIt);
+		}
+	}
+
+	return resultFieldList;
+}
+
+/*
+ * Get field.
+ */
+FlatMarcRecord::FieldIt
+FlatMarcRecord::getField(const std::string &fieldTag)
+{
+	// Check fields in list.
+	for (FieldIt fieldIt = m_firstField; fieldIt != NULL_HANDLE;
+		fieldIt = m_fieldList[fieldIt].nextField)
+	{
+		if (fieldTag == "" || hasTag(fieldIt, fieldTag)) {
+			return fieldIt;
+		}
+	}
+
+	return NULL_HANDLE;
+}
+
+/*
+ * Get first field of record.
+ */
+FlatMarcRecord::FieldIt
+FlatMarcRecord::firstField(void)
+{
+	return m_firstField;
+}
+
+/*
+ * Get next field of record.
+ */
+FlatMarcRecord::FieldIt
+FlatMarcRecord::nextField(FieldIt fieldIt)
+{
+	if (fieldIt == NULL_HANDLE) {
+		return NULL_HANDLE;
+	}
+
+	return m_fieldList[fieldIt].nextField;
+}
+
+/*
+ * Add field to the end of record.
+ */
+FlatMarcRecord::FieldIt
+FlatMarcRecord::addControlField(const Tag &fieldTag,
+	const std::string &fieldData)
+{
+	return addControlFieldBefore(NULL_HANDLE, fieldTag, fieldData);
+}
+
+FlatMarcRecord::FieldIt
+FlatMarcRecord::addDataField(const Tag &fieldTag,
+	char fieldInd1, char fieldInd2)
+{
+	return addDataFieldBefore(NULL_HANDLE, fieldTag, fieldInd1, fieldInd2);
+}
+
+/*
+ * Add field to the record before specified field.
+ */
+FlatMarcRecord::FieldIt
+FlatMarcRecord::addControlFieldBefore(FieldIt nextFieldIt,
+	const Tag &fieldTag, const std::string &fieldData)
+{
+	FieldIt fieldIt = createField(fieldTag, true);
+	FieldEntry &field = m_fieldList[fieldIt];
+	field.dataPos = storeData(fieldData.data(), fieldData.size());
+	field.dataLen = fieldData.size();
+	linkField(fieldIt, nextFieldIt);
+	return fieldIt;
+}
+
+FlatMarcRecord::FieldIt
+FlatMarcRecord::addDataFieldBefore(FieldIt nextFieldIt,
+	const Tag &fieldTag, char fieldInd1, char fieldInd2)
+{
+	FieldIt fieldIt = createField(fieldTag, false);
+	FieldEntry &field = m_fieldList[fieldIt];
+	field.ind1 = fieldInd1;
+	field.ind2 = fieldInd2;
+	linkField(fieldIt, nextFieldIt);
+	return fieldIt;
+}
+
+/*
+ * Remove field from the record.
+ */
+void
+FlatMarcRecord::removeField(FieldIt fieldIt)
+{
+	FieldEntry &field = m_fieldList[fieldIt];
+
+	// Unlink field entry (entry itself stays in storage until clear()).
+	if (field.prevField == NULL_HANDLE) {
+		m_firstField = field.nextField;
+	} else {
+		m_fieldList[field.prevField].nextField = field.nextField;
+	}
+	if (field.nextField == NULL_HANDLE) {
+		m_lastField = field.prevField;
+	} else {
+		m_fieldList[field.nextField].prevField = field.prevField;
+	}
+	field.prevField = NULL_HANDLE;
+	field.nextField = NULL_HANDLE;
+
+	// Count data of field as unused and drop it from entries.
+	m_unusedLen += field.dataLen;
+	field.dataPos = 0;
+	field.dataLen = 0;
+	for (SubfieldIt subfieldIt = field.firstSubfield;
+		subfieldIt != NULL_HANDLE;
+		subfieldIt = m_subfieldList[subfieldIt].nextSubfield)
+	{
+		SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+		m_unusedLen += subfield.dataLen;
+		subfield.dataPos = 0;
+		subfield.dataLen = 0;
+	}
+}
+
+/*
+ * Return true if field is control field.
+ */
+bool
+FlatMarcRecord::isControlField(FieldIt fieldIt)
+{
+	return m_fieldList[fieldIt].controlField;
+}
+
+/*
+ * Return true if field is data field.
+ */
+bool
+FlatMarcRecord::isDataField(FieldIt fieldIt)
+{
+	return !m_fieldList[fieldIt].controlField;
+}
+
+/*
+ * Get tag of field.
+ */
+std::string
+FlatMarcRecord::getTag(FieldIt fieldIt)
+{
+	return m_fieldList[fieldIt].tag.str();
+}
+
+/*
+ * Set tag of field.
+ */
+void
+FlatMarcRecord::setTag(FieldIt fieldIt, const Tag &fieldTag)
+{
+	m_fieldList[fieldIt].tag = fieldTag;
+}
+
+/*
+ * Get indicator 1 of data field.
+ */
+char
+FlatMarcRecord::getInd1(FieldIt fieldIt)
+{
+	return m_fieldList[fieldIt].ind1;
+}
+
+/*
+ * Get indicator 2 of data field.
+ */
+char
+FlatMarcRecord::getInd2(FieldIt fieldIt)
+{
+	return m_fieldList[fieldIt].ind2;
+}
+
+/*
+ * Set indicator 1 of data field.
+ */
+void
+FlatMarcRecord::setInd1(FieldIt fieldIt, char ind1)
+{
+	m_fieldList[fieldIt].ind1 = ind1;
+}
+
+/*
+ * Set indicator 2 of data field.
+ */
+void
+FlatMarcRecord::setInd2(FieldIt fieldIt, char ind2)
+{
+	m_fieldList[fieldIt].ind2 = ind2;
+}
+
+/*
+ * Get data of control field.
+ */
+std::string
+FlatMarcRecord::getData(FieldIt fieldIt)
+{
+	FieldEntry &field = m_fieldList[fieldIt];
+	return std::string(m_data, field.dataPos, field.dataLen);
+}
+
+/*
+ * Get data of control field without copying.
+ */
+FlatMarcRecord::Slice
+FlatMarcRecord::getDataSlice(FieldIt fieldIt)
+{
+	FieldEntry &field = m_fieldList[fieldIt];
+	Slice slice = { m_data.data() + field.dataPos, field.dataLen };
+	return slice;
+}
+
+/*
+ * Set data of control field.
+ */
+void
+FlatMarcRecord::setData(FieldIt fieldIt, const std::string &fieldData)
+{
+	FieldEntry &field = m_fieldList[fieldIt];
+	replaceData(field.dataPos, field.dataLen, fieldData);
+}
+
+/*
+ * Get list of subfields.
+ */
+FlatMarcRecord::SubfieldRefList
+FlatMarcRecord::getSubfields(FieldIt fieldIt, char subfieldId)
+{
+	SubfieldRefList resultSubfieldList;
+
+	// Check subfields in list.
+	for (SubfieldIt subfieldIt = firstSubfield(fieldIt);
+		subfieldIt != NULL_HANDLE;
+		subfieldIt = m_subfieldList[subfieldIt].nextSubfield)
+	{
+		if (subfieldId == ' '
+			|| m_subfieldList[subfieldIt].id == subfieldId)
+		{
+			resultSubfieldList.push_back(subfieldIt);
+		}
+	}
+
+	return resultSubfieldList;
+}
+
+/*
+ * Get subfield.
+ */
+FlatMarcRecord::SubfieldIt
+FlatMarcRecord::getSubfield(FieldIt fieldIt, char subfieldId)
+{
+	// Check subfields in list.
+	for (SubfieldIt subfieldIt = firstSubfield(fieldIt);
+		subfieldIt != NULL_HANDLE;
+		subfieldIt = m_subfieldList[subfieldIt].nextSubfield)
+	{
+		if (subfieldId == ' '
+			|| m_subfieldList[subfieldIt].id == subfieldId)
+		{
+			return subfieldIt;
+		}
+	}
+
+	return NULL_HANDLE;
+}
+
+/*
+ * Get first subfield of field.
+ */
+FlatMarcRecord::SubfieldIt
+FlatMarcRecord::firstSubfield(FieldIt fieldIt)
+{
+	if (fieldIt == NULL_HANDLE) {
+		return NULL_HANDLE;
+	}
+
+	return m_fieldList[fieldIt].firstSubfield;
+}
+
+/*
+ * Get next subfield of field.
+ */
+FlatMarcRecord::SubfieldIt
+FlatMarcRecord::nextSubfield(SubfieldIt subfieldIt)
+{
+	if (subfieldIt == NULL_HANDLE) {
+		return NULL_HANDLE;
+	}
+
+	return m_subfieldList[subfieldIt].nextSubfield;
+}
+
+/*
+ * Add subfield to the end of field.
+ */
+FlatMarcRecord::SubfieldIt
+FlatMarcRecord::addSubfield(FieldIt fieldIt, char subfieldId,
+	const std::string &subfieldData)
+{
+	return addSubfieldBefore(fieldIt, NULL_HANDLE, subfieldId,
+		subfieldData);
+}
+
+/*
+ * Add subfield to the field before specified subfield.
+ */
+FlatMarcRecord::SubfieldIt
+FlatMarcRecord::addSubfieldBefore(FieldIt fieldIt,
+	SubfieldIt nextSubfieldIt, char subfieldId,
+	const std::string &subfieldData)
+{
+	// Create subfield entry.
+	SubfieldEntry subfield;
+	subfield.id = subfieldId;
+	subfield.dataPos = storeData(subfieldData.data(), subfieldData.size());
+	subfield.dataLen = subfieldData.size();
+	subfield.nextSubfield = nextSubfieldIt;
+	SubfieldIt subfieldIt = (SubfieldIt) m_subfieldList.size();
+
+	// Link subfield entry into list of field subfields.
+	FieldEntry &field = m_fieldList[fieldIt];
+	if (nextSubfieldIt == NULL_HANDLE) {
+		subfield.prevSubfield = field.lastSubfield;
+		field.lastSubfield = subfieldIt;
+	} else {
+		subfield.prevSubfield =
+			m_subfieldList[nextSubfieldIt].prevSubfield;
+		m_subfieldList[nextSubfieldIt].prevSubfield = subfieldIt;
+	}
+	if (subfield.prevSubfield == NULL_HANDLE) {
+		field.firstSubfield = subfieldIt;
+	} else {
+		m_subfieldList[subfield.prevSubfield].nextSubfield =
+			subfieldIt;
+	}
+	m_subfieldList.push_back(subfield);
+
+	return subfieldIt;
+}
+
+/*
+ * Remove subfield from the field.
+ */
+void
+FlatMarcRecord::removeSubfield(FieldIt fieldIt, SubfieldIt subfieldIt)
+{
+	FieldEntry &field = m_fieldList[fieldIt];
+	SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+
+	// Unlink subfield entry (entry itself stays in storage until clear()).
+	if (subfield.prevSubfield == NULL_HANDLE) {
+		field.firstSubfield = subfield.nextSubfield;
+	} else {
+		m_subfieldList[subfield.prevSubfield].nextSubfield =
+			subfield.nextSubfield;
+	}
+	if (subfield.nextSubfield == NULL_HANDLE) {
+		field.lastSubfield = subfield.prevSubfield;
+	} else {
+		m_subfieldList[subfield.nextSubfield].prevSubfield =
+			subfield.prevSubfield;
+	}
+	subfield.prevSubfield = NULL_HANDLE;
+	subfield.nextSubfield = NULL_HANDLE;
+
+	// Count data of subfield as unused and drop it from entry.
+	m_unusedLen += subfield.dataLen;
+	subfield.dataPos = 0;
+	subfield.dataLen = 0;
+}
+
+/*
+ * Get identifier of subfield.
+ */
+char
+FlatMarcRecord::getSubfieldId(SubfieldIt subfieldIt)
+{
+	return m_subfieldList[subfieldIt].id;
+}
+
+/*
+ * Set identifier of subfield.
+ */
+void
+FlatMarcRecord::setSubfieldId(SubfieldIt subfieldIt, char subfieldId)
+{
+	m_subfieldList[subfieldIt].id = subfieldId;
+}
+
+/*
+ * Get data of subfield.
+ */
+std::string
+FlatMarcRecord::getSubfieldData(SubfieldIt subfieldIt)
+{
+	SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+	return std::string(m_data, subfield.dataPos, subfield.dataLen);
+}
+
+/*
+ * Get data of subfield without copying.
+ */
+FlatMarcRecord::Slice
+FlatMarcRecord::getSubfieldDataSlice(SubfieldIt subfieldIt)
+{
+	SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+	Slice slice = { m_data.data() + subfield.dataPos, subfield.dataLen };
+	return slice;
+}
+
+/*
+ * Set data of subfield.
+ */
+void
+FlatMarcRecord::setSubfieldData(SubfieldIt subfieldIt,
+	const std::string &subfieldData)
+{
+	SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+	replaceData(subfield.dataPos, subfield.dataLen, subfieldData);
+}
+
+/*
+ * Format record to string for printing.
+ */
+std::string
+FlatMarcRecord::toString(void)
+{
+	// Print leader.
+	std::string textRecord = "Leader [";
+	textRecord.append((const char *) &m_leader,
+		sizeof(MarcRecord::Leader));
+	textRecord += "]";
+
+	// Iterate all fields.
+	for (FieldIt fieldIt = m_firstField; fieldIt != NULL_HANDLE;
+		fieldIt = m_fieldList[fieldIt].nextField)
+	{
+		FieldEntry &field = m_fieldList[fieldIt];
+		textRecord += '\n';
+		textRecord += field.tag.c_str();
+
+		// Print control field.
+		if (field.controlField) {
+			textRecord += ' ';
+			textRecord.append(m_data, field.dataPos, field.dataLen);
+			continue;
+		}
+
+		// Print indicators of data field.
+		textRecord += " [";
+		textRecord += field.ind1;
+		textRecord += field.ind2;
+		textRecord += ']';
+
+		// Iterate all subfields.
+		for (SubfieldIt subfieldIt = field.firstSubfield;
+			subfieldIt != NULL_HANDLE;
+			subfieldIt = m_subfieldList[subfieldIt].nextSubfield)
+		{
+			SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+			textRecord += " $";
+			textRecord += subfield.id;
+			textRecord += ' ';
+			if (subfield.id != '1') {
+				// Print regular subfield.
+				textRecord.append(m_data, subfield.dataPos,
+					subfield.dataLen);
+				continue;
+			}
+
+			// Print header of embedded field.
+			Slice embeddedData = getSubfieldDataSlice(subfieldIt);
+			size_t tagLen = std::min(embeddedData.size, (size_t) 3);
+			textRecord += '<';
+			textRecord.append(embeddedData.data, tagLen);
+			textRecord += "> ";
+			if (m_data.compare(subfield.dataPos, tagLen,
+				"010") < 0)
+			{
+				textRecord.append(embeddedData.data + tagLen,
+					embeddedData.size - tagLen);
+			} else {
+				textRecord += '[';
+				textRecord += embeddedData.size >= 4
+					? embeddedData.data[3] : '?';
+				textRecord += embeddedData.size >= 5
+					? embeddedData.data[4] : '?';
+				textRecord += ']';
+			}
+		}
+	}
+
+	return textRecord;
+}
+
+/*
+ * Store string in data buffer.
+ */
+size_t
+FlatMarcRecord::storeData(const char *data, size_t dataLen)
+{
+	size_t dataPos = m_data.size();
+	m_data.append(data, dataLen);
+	return dataPos;
+}
+
+/*
+ * Replace data of entry in data buffer.
+ */
+void
+FlatMarcRecord::replaceData(size_t &dataPos, size_t &dataLen,
+	const std::string &data)
+{
+	// Overwrite old data in place if new data fit.
+	if (data.size() <= dataLen) {
+		m_data.replace(dataPos, data.size(), data);
+		m_unusedLen += dataLen - data.size();
+		dataLen = data.size();
+		return;
+	}
+
+	// Store new data at the end of buffer.
+	m_unusedLen += dataLen;
+	dataPos = storeData(data.data(), data.size());
+	dataLen = data.size();
+
+	// Reclaim unused data when it takes half of buffer.
+	if (m_unusedLen > m_data.size() / 2) {
+		compactData();
+	}
+}
+
+/*
+ * Move data of all entries to the start of data buffer.
+ */
+void
+FlatMarcRecord::compactData(void)
+{
+	// Copy data of fields and subfields in order of record.
+	std::string data;
+	data.reserve(m_data.size() - m_unusedLen);
+	for (FieldIt fieldIt = m_firstField; fieldIt != NULL_HANDLE;
+		fieldIt = m_fieldList[fieldIt].nextField)
+	{
+		FieldEntry &field = m_fieldList[fieldIt];
+		data.append(m_data, field.dataPos, field.dataLen);
+		field.dataPos = data.size() - field.dataLen;
+		for (SubfieldIt subfieldIt = field.firstSubfield;
+			subfieldIt != NULL_HANDLE;
+			subfieldIt = m_subfieldList[subfieldIt].nextSubfield)
+		{
+			SubfieldEntry &subfield = m_subfieldList[subfieldIt];
+			data.append(m_data, subfield.dataPos,
+				subfield.dataLen);
+			subfield.dataPos = data.size() - subfield.dataLen;
+		}
+	}
+
+	m_data.swap(data);
+	m_unusedLen = 0;
+}
+
+/*
+ * Create field entry.
+ */
+FlatMarcRecord::FieldIt
+FlatMarcRecord::createField(const Tag &fieldTag, bool controlField)
+{
+	FieldEntry field;
+	field.controlField = controlField;
+	field.ind1 = ' ';
+	field.ind2 = ' ';
+	field.tag = fieldTag;
+	field.dataPos = 0;
+	field.dataLen = 0;
+	field.firstSubfield = NULL_HANDLE;
+	field.lastSubfield = NULL_HANDLE;
+	field.prevField = NULL_HANDLE;
+	field.nextField = NULL_HANDLE;
+	m_fieldList.push_back(field);
+
+	return (FieldIt) (m_fieldList.size() - 1);
+}
+
+/*
+ * Link field entry into list of fields.
+ */
+void
+FlatMarcRecord::linkField(FieldIt fieldIt, FieldIt nextFieldIt)
+{
+	FieldEntry &field = m_fieldList[fieldIt];
+
+	field.nextField = nextFieldIt;
+	if (nextFieldIt == NULL_HANDLE) {
+		field.prevField = m_lastField;
+		m_lastField = fieldIt;
+	} else {
+		field.prevField = m_fieldList[nextFieldIt].prevField;
+		m_fieldList[nextFieldIt].prevField = fieldIt;
+	}
+	if (field.prevField == NULL_HANDLE) {
+		m_firstField = fieldIt;
+	} else {
+		m_fieldList[field.prevField].nextField = fieldIt;
+	}
+}
+
+/*
+ * Check if field has specified tag.
+ */
+bool
+FlatMarcRecord::hasTag(FieldIt fieldIt, const std::string &fieldTag)
+{
+	return m_fieldList[fieldIt].tag == fieldTag;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_FLAT_MARCRECORD_H
+#define MARCRECORD_FLAT_MARCRECORD_H
+
+#include <string>
+#include <vector>
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * MARC record with contiguous storage.
+ *
+ * Fields and subfields are kept in vectors and linked by indexes, their
+ * data are kept in single data buffer. Fields and subfields are
+ * referenced by index handles, which stay valid until record is cleared.
+ * Storage keeps its capacity, so clearing and filling record again does
+ * not allocate memory when record size does not grow. Data of changed
+ * and removed entries is reclaimed when it takes half of data buffer.
+ */
+class FlatMarcRecord {
+public:
+	// Handle of field.
+	typedef unsigned int FieldIt;
+	// List of field handles.
+	typedef std::vector<FieldIt> FieldRefList;
+	typedef FieldRefList::iterator FieldRefIt;
+
+	// Handle of subfield.
+	typedef unsigned int SubfieldIt;
+	// List of subfield handles.
+	typedef std::vector<SubfieldIt> SubfieldRefList;
+	typedef SubfieldRefList::iterator SubfieldRefIt;
+
+	// Null value of field and subfield handle.
+	enum { NULL_HANDLE = 0xFFFFFFFF };
+
+	// Part of data buffer (valid until record is changed).
+	struct Slice {
+		// Pointer to data.
+		const char *data;
+		// Length of data.
+		size_t size;
+	};
+	typedef struct Slice Slice;
+
+	// ISO 2709 reader and writer classes.
+	friend class MarcIsoReader;
+	friend class MarcIsoWriter;
+
+private:
+	/*
+	 * Field entry.
+	 */
+	struct FieldEntry {
+		// Field is control field.
+		bool controlField;
+		// Indicator 1.
+		char ind1;
+		// Indicator 2.
+		char ind2;
+		// Field tag.
+		Tag tag;
+		// Position and length of control field data in data buffer.
+		size_t dataPos;
+		size_t dataLen;
+		// First and last subfields.
+		SubfieldIt firstSubfield;
+		SubfieldIt lastSubfield;
+		// Previous and next fields.
+		FieldIt prevField;
+		FieldIt nextField;
+	};
+	typedef struct FieldEntry FieldEntry;
+
+	/*
+	 * Subfield entry.
+	 */
+	struct SubfieldEntry {
+		// Subfield identifier.
+		char id;
+		// Position and length of subfield data in data buffer.
+		size_t dataPos;
+		size_t dataLen;
+		// Previous and next subfields.
+		SubfieldIt prevSubfield;
+		SubfieldIt nextSubfield;
+	};
+	typedef struct SubfieldEntry SubfieldEntry;
+
+	// Variant of record format.
+	MarcRecord::FormatVariant m_formatVariant;
+
+	// Record leader.
+	MarcRecord::Leader m_leader;
+	// Entries of fields.
+	std::vector<FieldEntry> m_fieldList;
+	// Entries of subfields.
+	std::vector<SubfieldEntry> m_subfieldList;
+	// Buffer of control field and subfield data.
+	std::string m_data;
+	// Length of data in buffer left by changed and removed entries.
+	size_t m_unusedLen;
+	// First and last fields.
+	FieldIt m_firstField;
+	FieldIt m_lastField;
+
+	// Store string in data buffer.
+	size_t storeData(const char *data, size_t dataLen);
+	// Replace data of entry in data buffer.
+	void replaceData(size_t &dataPos, size_t &dataLen,
+		const std::string &data);
+	// Move data of all entries to the start of data buffer.
+	void compactData(void);
+	// Create field entry.
+	FieldIt createField(const Tag &fieldTag, bool controlField);
+	// Link field entry into list of fields.
+	void linkField(FieldIt fieldIt, FieldIt nextFieldIt);
+	// Check if field has specified tag.
+	bool hasTag(FieldIt fieldIt, const std::string &fieldTag);
+
+public:
+	// Constructors and destructor.
+	FlatMarcRecord();
+	FlatMarcRecord(MarcRecord::FormatVariant formatVariant);
+	~FlatMarcRecord();
+
+	// Clear record.
+	void clear(void);
+
+	// Get record format variant.
+	MarcRecord::FormatVariant getFormatVariant(void);
+	// Set record format variant.
+	void setFormatVariant(MarcRecord::FormatVariant formatVariant);
+
+	// Get record leader.
+	MarcRecord::Leader & getLeader(void);
+	// Set record leader.
+	void setLeader(const MarcRecord::Leader &leader);
+	void setLeader(const std::string &leaderData = "");
+
+	// Copy content of MARC record.
+	void assign(MarcRecord &record);
+	// Copy content to MARC record.
+	void toMarcRecord(MarcRecord &record);
+
+	// Get list of fields.
+	FieldRefList getFields(const std::string &fieldTag = "");
+	// Get field.
+	FieldIt getField(const std::string &fieldTag);
+	// Get first field of record.
+	FieldIt firstField(void);
+	// Get next field of record.
+	FieldIt nextField(FieldIt fieldIt);
+
+	// Add field to the end of record.
+	FieldIt addControlField(const Tag &fieldTag = Tag(),
+		const std::string &fieldData = "");
+	FieldIt addDataField(const Tag &fieldTag = Tag(),
+		char fieldInd1 = ' ', char fieldInd2 = ' ');
+	// Add field to the record before specified field.
+	FieldIt addControlFieldBefore(FieldIt nextFieldIt,
+		const Tag &fieldTag = Tag(),
+		const std::string &fieldData = "");
+	FieldIt addDataFieldBefore(FieldIt nextFieldIt,
+		const Tag &fieldTag = Tag(),
+		char fieldInd1 = ' ', char fieldInd2 = ' ');
+	// Remove field from the record.
+	void removeField(FieldIt fieldIt);
+
+	// Return true if field is control field.
+	bool isControlField(FieldIt fieldIt);
+	// Return true if field is data field.
+	bool isDataField(FieldIt fieldIt);
+	// Get tag of field.
+	std::string getTag(FieldIt fieldIt);
+	// Set tag of field.
+	void setTag(FieldIt fieldIt, const Tag &fieldTag);
+	// Get indicator 1 of data field.
+	char getInd1(FieldIt fieldIt);
+	// Get indicator 2 of data field.
+	char getInd2(FieldIt fieldIt);
+	// Set indicator 1 of data field.
+	void setInd1(FieldIt fieldIt, char ind1);
+	// Set indicator 2 of data field.
+	void setInd2(FieldIt fieldIt, char ind2);
+	// Get data of control field.
+	std::string getData(FieldIt fieldIt);
+	// Get data of control field without copying.
+	Slice getDataSlice(FieldIt fieldIt);
+	// Set data of control field.
+	void setData(FieldIt fieldIt, const std::string &fieldData);
+
+	// Get list of subfields.
+	SubfieldRefList getSubfields(FieldIt fieldIt, char subfieldId = ' ');
+	// Get subfield.
+	SubfieldIt getSubfield(FieldIt fieldIt, char subfieldId);
+	// Get first subfield of field.
+	SubfieldIt firstSubfield(FieldIt fieldIt);
+	// Get next subfield of field.
+	SubfieldIt nextSubfield(SubfieldIt subfieldIt);
+
+	// Add subfield to the end of field.
+	SubfieldIt addSubfield(FieldIt fieldIt, char subfieldId = ' ',
+		const std::string &subfieldData = "");
+	// Add subfield to the field before specified subfield.
+	SubfieldIt addSubfieldBefore(FieldIt fieldIt,
+		SubfieldIt nextSubfieldIt, char subfieldId = ' ',
+		const std::string &subfieldData = "");
+	// Remove subfield from the field.
+	void removeSubfield(FieldIt fieldIt, SubfieldIt subfieldIt);
+
+	// Get identifier of subfield.
+	char getSubfieldId(SubfieldIt subfieldIt);
+	// Set identifier of subfield.
+	void setSubfieldId(SubfieldIt subfieldIt, char subfieldId);
+	// Get data of subfield.
+	std::string getSubfieldData(SubfieldIt subfieldIt);
+	// Get data of subfield without copying.
+	Slice getSubfieldDataSlice(SubfieldIt subfieldIt);
+	// Set data of subfield.
+	void setSubfieldData(SubfieldIt subfieldIt,
+		const std::string &subfieldData);
+
+	// Format record to string for printing.
+	std::string toString(void);
+
+	// Return null field value.
+	inline FieldIt nullField(void)
+	{
+		return NULL_HANDLE;
+	}
+
+	// Return null subfield value.
+	inline SubfieldIt nullSubfield(void)
+	{
+		return NULL_HANDLE;
+	}
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_FLAT_MARCRECORD_H
@@ -45,6 +45,13 @@ MarcReader::MarcReader()
 	m_autoCorrectionMode = false;
 }
 
+/*
+ * Destructor.
+ */
+MarcReader::~MarcReader()
+{
+}
+
 /*
  * Get last error code.
  */
@@ -45,7 +45,8 @@ public:
 		END_OF_FILE = 1,
 		ERROR_INVALID_RECORD = -1,
 		ERROR_ICONV = -2,
-		ERROR_XML_PARSER = -3
+		ERROR_XML_PARSER = -3,
+		ERROR_IO = -4
 	};
 
 protected:
@@ -63,8 +64,9 @@ protected:
 	bool m_autoCorrectionMode;
 
 public:
-	// Constructor.
+	// Constructor and destructor.
 	MarcReader();
+	virtual ~MarcReader();
 
 	// Get last error code.
 	ErrorCode getErrorCode(void);
@@ -42,6 +42,8 @@ MarcWriter::MarcWriter()
 {
 	// Clear member variables.
 	m_errorCode = OK;
+	m_outputFile = NULL;
+	m_outputLen = 0;
 }
 
 /*
@@ -70,3 +72,110 @@ MarcWriter::getOutputFile()
 {
 	return m_outputFile;
 }
+
+/*
+ * Set size of output buffer (0 to write every record directly).
+ */
+bool
+MarcWriter::setBufferSize(size_t bufferSize)
+{
+	// Write data accumulated in current buffer.
+	if (!flushBuffer()) {
+		return false;
+	}
+
+	// Resize buffer.
+	std::vector<char>(bufferSize).swap(m_outputBuf);
+
+	return true;
+}
+
+/*
+ * Write buffered data to output file and flush it.
+ */
+bool
+MarcWriter::flush(void)
+{
+	if (m_outputFile == NULL) {
+		return true;
+	}
+
+	// Write buffered data.
+	if (!flushBuffer()) {
+		return false;
+	}
+
+	// Flush output file.
+	if (fflush(m_outputFile) != 0) {
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "i/o operation failed";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Write data to output file through output buffer.
+ */
+bool
+MarcWriter::writeData(const char *data, size_t len)
+{
+	if (len == 0) {
+		return true;
+	}
+
+	// Copy data to output buffer if it fits.
+	if (m_outputLen + len <= m_outputBuf.size()) {
+		memcpy(&m_outputBuf[m_outputLen], data, len);
+		m_outputLen += len;
+		return true;
+	}
+
+	// Write buffered data and copy data to empty buffer if it fits.
+	if (!flushBuffer()) {
+		return false;
+	}
+	if (len < m_outputBuf.size()) {
+		memcpy(&m_outputBuf[0], data, len);
+		m_outputLen = len;
+		return true;
+	}
+
+	// Write data directly to output file.
+	if (fwrite(data, len, 1, m_outputFile) != 1) {
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "i/o operation failed";
+		return false;
+	}
+
+	return true;
+}
+
+bool
+MarcWriter::writeData(const std::string &data)
+{
+	return writeData(data.c_str(), data.size());
+}
+
+/*
+ * Write data from output buffer to output file.
+ */
+bool
+MarcWriter::flushBuffer(void)
+{
+	if (m_outputLen == 0) {
+		return true;
+	}
+
+	// Write buffered data, discard it on error.
+	size_t outputLen = m_outputLen;
+	m_outputLen = 0;
+	if (fwrite(&m_outputBuf[0], outputLen, 1, m_outputFile) != 1) {
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "i/o operation failed";
+		return false;
+	}
+
+	return true;
+}
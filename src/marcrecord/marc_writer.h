@@ -29,13 +29,19 @@
 #ifndef MARCRECORD_MARC_WRITER_H
 #define MARCRECORD_MARC_WRITER_H
 
+#include <cstdio>
 #include <string>
+#include <vector>
 #include "marcrecord.h"
 
 namespace marcrecord {
 
 /*
  * MARC records writer.
+ *
+ * Written records are kept in output buffer, so flush() or close() must be
+ * called before the output file is closed by the caller. Opening another
+ * output file writes buffered data to the previous one.
  */
 class MarcWriter {
 public:
@@ -58,6 +64,17 @@ protected:
 	// Encoding of output file.
 	std::string m_outputEncoding;
 
+	// Output buffer.
+	std::vector<char> m_outputBuf;
+	// Length of data in output buffer.
+	size_t m_outputLen;
+
+	// Write data to output file through output buffer.
+	bool writeData(const char *data, size_t len);
+	bool writeData(const std::string &data);
+	// Write data from output buffer to output file.
+	bool flushBuffer(void);
+
 public:
 	// Constructor.
 	MarcWriter();
@@ -70,10 +87,15 @@ public:
 	// Return output file handle.
 	FILE *getOutputFile();
 
-	// Open output file.
+	// Set size of output buffer (0 to write every record directly).
+	bool setBufferSize(size_t bufferSize);
+	// Write buffered data to output file and flush it.
+	bool flush(void);
+
+	// Open output file (buffered data is written to previous one).
 	virtual bool open(FILE *outputFile,
 		const char *outputEncoding = NULL) = 0;
-	// Close output file.
+	// Write buffered data and detach output file (not closed by writer).
 	virtual void close(void) = 0;
 	// Write record to output file.
 	virtual bool write(MarcRecord &record) = 0;
@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marciso_parallel_reader.h"
+
+using namespace marcrecord;
+
+// Default number of records in batch per worker thread.
+#define DEFAULT_BATCH_SIZE_PER_THREAD	256
+// Maximum size of raw records data in batch.
+#define MAX_BATCH_DATA_SIZE		(16 * 1024 * 1024)
+
+/*
+ * Constructor.
+ */
+MarcIsoParallelReader::MarcIsoParallelReader(FILE *inputFile,
+	const char *inputEncoding, unsigned int numThreads)
+	: MarcReader()
+{
+	// Clear member variables.
+	setNumThreads(numThreads);
+	m_batchSize = 0;
+	m_endOfFile = false;
+	m_currentBatch = 0;
+	for (int i = 0; i < 2; i++) {
+		m_batches[i].numRecords = 0;
+		m_batches[i].recordPos = 0;
+		m_batches[i].running = false;
+	}
+
+	if (inputFile) {
+		// Open input file.
+		open(inputFile, inputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcIsoParallelReader::~MarcIsoParallelReader()
+{
+	// Close input file.
+	close();
+}
+
+/*
+ * Set number of worker threads (0 means number of processors).
+ */
+void
+MarcIsoParallelReader::setNumThreads(unsigned int numThreads)
+{
+	m_numThreads = numThreads == 0 ? cpu_count() : numThreads;
+}
+
+/*
+ * Set maximum number of records in batch (0 means default).
+ */
+void
+MarcIsoParallelReader::setBatchSize(unsigned int batchSize)
+{
+	m_batchSize = batchSize;
+}
+
+/*
+ * Open input file.
+ */
+bool
+MarcIsoParallelReader::open(FILE *inputFile, const char *inputEncoding)
+{
+	// Clear state of previously opened file.
+	reset();
+
+	// Open reader of raw records.
+	if (!m_reader.open(inputFile, inputEncoding)) {
+		m_errorCode = m_reader.getErrorCode();
+		m_errorMessage = m_reader.getErrorMessage();
+		return false;
+	}
+
+	// Initialize input stream parameters.
+	m_inputFile = m_reader.getInputFile();
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+
+	return true;
+}
+
+/*
+ * Open input file by name and map it into memory.
+ */
+bool
+MarcIsoParallelReader::openMapped(const char *inputFileName,
+	const char *inputEncoding)
+{
+	// Clear state of previously opened file.
+	reset();
+
+	// Open reader of raw records.
+	if (!m_reader.openMapped(inputFileName, inputEncoding)) {
+		m_errorCode = m_reader.getErrorCode();
+		m_errorMessage = m_reader.getErrorMessage();
+		return false;
+	}
+
+	// Initialize input stream parameters.
+	m_inputFile = NULL;
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+
+	return true;
+}
+
+/*
+ * Close input file.
+ */
+void
+MarcIsoParallelReader::close(void)
+{
+	// Clear state of opened file.
+	reset();
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_inputFile = NULL;
+	m_inputEncoding = "";
+	m_autoCorrectionMode = false;
+}
+
+/*
+ * Stop worker threads and clear state of opened file.
+ */
+void
+MarcIsoParallelReader::reset(void)
+{
+	// Wait for worker threads and free their parsers.
+	for (int i = 0; i < 2; i++) {
+		Batch &batch = m_batches[i];
+		joinBatch(batch);
+		batch.numRecords = 0;
+		batch.recordPos = 0;
+		for (size_t j = 0; j < batch.workers.size(); j++) {
+			delete batch.workers[j].parser;
+		}
+		batch.workers.clear();
+	}
+
+	// Close reader of raw records.
+	m_reader.close();
+
+	m_endOfFile = false;
+	m_currentBatch = 0;
+}
+
+/*
+ * Read next record from file in original order.
+ */
+bool
+MarcIsoParallelReader::next(MarcRecord &record)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	Batch *batch = &m_batches[m_currentBatch];
+	while (batch->recordPos >= batch->numRecords) {
+		// Start parsing of next batch if it is not started yet.
+		Batch *nextBatch = &m_batches[1 - m_currentBatch];
+		if (!nextBatch->running) {
+			if (m_endOfFile) {
+				m_errorCode = END_OF_FILE;
+				return false;
+			}
+			fillBatch(*nextBatch);
+			startBatch(*nextBatch);
+		}
+
+		// Switch to parsed batch.
+		joinBatch(*nextBatch);
+		m_currentBatch = 1 - m_currentBatch;
+		batch = nextBatch;
+
+		// Parse following batch while records are returned.
+		if (!m_endOfFile) {
+			Batch *followingBatch = &m_batches[1 - m_currentBatch];
+			fillBatch(*followingBatch);
+			startBatch(*followingBatch);
+		}
+	}
+
+	// Return error of invalid record.
+	BatchRecord &batchRecord = batch->records[batch->recordPos++];
+	if (batchRecord.errorCode != OK) {
+		m_errorCode = batchRecord.errorCode;
+		m_errorMessage = batchRecord.errorMessage;
+		return false;
+	}
+
+	// Move parsed record content to the caller record.
+	record.takeFields(batchRecord.record);
+
+	return true;
+}
+
+/*
+ * Read all records from file passing them to handler.
+ */
+bool
+MarcIsoParallelReader::read(RecordHandler handler, void *userData,
+	bool ordered)
+{
+	// Pass records to handler in original order.
+	if (ordered) {
+		MarcRecord record;
+		while (next(record)) {
+			if (!handler(record, userData)) {
+				return true;
+			}
+		}
+		return m_errorCode == END_OF_FILE;
+	}
+
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Pass records left from next() to handler in original order.
+	Batch *currentBatch = &m_batches[m_currentBatch];
+	for (;;) {
+		while (currentBatch->recordPos < currentBatch->numRecords) {
+			size_t recordPos = currentBatch->recordPos++;
+			BatchRecord &batchRecord =
+				currentBatch->records[recordPos];
+			if (batchRecord.errorCode != OK) {
+				m_errorCode = batchRecord.errorCode;
+				m_errorMessage = batchRecord.errorMessage;
+				return false;
+			}
+			if (!handler(batchRecord.record, userData)) {
+				return true;
+			}
+		}
+
+		// Switch to batch parsed for next().
+		Batch *nextBatch = &m_batches[1 - m_currentBatch];
+		if (!nextBatch->running) {
+			break;
+		}
+		joinBatch(*nextBatch);
+		m_currentBatch = 1 - m_currentBatch;
+		currentBatch = nextBatch;
+	}
+
+	// Pass records to handler directly from worker threads, read next
+	// batch while records of current one are parsed.
+	Batch *batch = currentBatch;
+	Batch *nextBatch = &m_batches[1 - m_currentBatch];
+	if (!m_endOfFile) {
+		fillBatch(*batch);
+		startBatch(*batch, handler, userData);
+	}
+	while (batch->running) {
+		bool nextFilled = !m_endOfFile;
+		if (nextFilled) {
+			fillBatch(*nextBatch);
+		}
+		bool stopped = joinBatch(*batch);
+
+		// Stop at first invalid record of batch.
+		for (size_t i = 0; i < batch->numRecords; i++) {
+			if (batch->records[i].errorCode != OK) {
+				m_errorCode = batch->records[i].errorCode;
+				m_errorMessage =
+					batch->records[i].errorMessage;
+				stopped = true;
+				break;
+			}
+		}
+		batch->numRecords = 0;
+
+		// Leave records of next batch to next().
+		if (stopped) {
+			if (nextFilled) {
+				startBatch(*nextBatch);
+			}
+			m_currentBatch = batch == &m_batches[0] ? 0 : 1;
+			return m_errorCode == OK;
+		}
+
+		// Switch to next batch.
+		if (nextFilled) {
+			startBatch(*nextBatch, handler, userData);
+		}
+		std::swap(batch, nextBatch);
+	}
+
+	m_errorCode = END_OF_FILE;
+	return true;
+}
+
+/*
+ * Read raw records to batch.
+ */
+void
+MarcIsoParallelReader::fillBatch(Batch &batch)
+{
+	unsigned int batchSize = m_batchSize != 0 ? m_batchSize
+		: m_numThreads * DEFAULT_BATCH_SIZE_PER_THREAD;
+
+	batch.data.clear();
+	batch.numRecords = 0;
+	batch.recordPos = 0;
+	if (batch.records.size() < batchSize) {
+		batch.records.resize(batchSize);
+	}
+
+	// Read records until batch is full.
+	m_reader.setAutoCorrectionMode(m_autoCorrectionMode);
+	while (batch.numRecords < batchSize
+		&& batch.data.size() < MAX_BATCH_DATA_SIZE)
+	{
+		const char *recordBuf;
+		unsigned int recordLen;
+		bool result = m_reader.readRecord(recordBuf, recordLen);
+		if (!result && m_reader.getErrorCode() == END_OF_FILE) {
+			m_endOfFile = true;
+			break;
+		}
+
+		// Append record to batch.
+		BatchRecord &batchRecord = batch.records[batch.numRecords++];
+		batchRecord.offset = batch.data.size();
+		if (result) {
+			batchRecord.length = recordLen;
+			batchRecord.errorCode = OK;
+			batchRecord.errorMessage.erase();
+			batch.data.insert(batch.data.end(), recordBuf,
+				recordBuf + recordLen);
+		} else {
+			batchRecord.length = 0;
+			batchRecord.errorCode = m_reader.getErrorCode();
+			batchRecord.errorMessage = m_reader.getErrorMessage();
+		}
+	}
+}
+
+/*
+ * Start parsing of batch records.
+ */
+void
+MarcIsoParallelReader::startBatch(Batch &batch, RecordHandler handler,
+	void *userData)
+{
+	// Split batch to ranges for worker threads.
+	size_t numWorkers = m_numThreads;
+	if (numWorkers > batch.numRecords) {
+		numWorkers = batch.numRecords;
+	}
+
+	// Create parsers for new worker threads.
+	while (batch.workers.size() < numWorkers) {
+		Worker worker;
+		worker.parser = new MarcIsoReader();
+		worker.parser->open(NULL, m_inputEncoding == ""
+			? NULL : m_inputEncoding.c_str());
+		worker.threadStarted = false;
+		batch.workers.push_back(worker);
+	}
+
+	// Start worker threads.
+	for (size_t i = 0; i < numWorkers; i++) {
+		Worker &worker = batch.workers[i];
+		worker.parser->setAutoCorrectionMode(m_autoCorrectionMode);
+		worker.batch = &batch;
+		worker.firstRecord = batch.numRecords * i / numWorkers;
+		worker.lastRecord = batch.numRecords * (i + 1) / numWorkers;
+		worker.handler = handler;
+		worker.userData = userData;
+		worker.stopped = false;
+
+		if (numWorkers == 1) {
+			// Parse records in current thread.
+			worker.threadStarted = false;
+			parseRecords(&worker);
+		} else {
+			// Parse records in worker thread (or in current thread
+			// if thread can't be created).
+			worker.threadStarted = thread_create(worker.thread,
+				parseRecords, &worker);
+			if (!worker.threadStarted) {
+				parseRecords(&worker);
+			}
+		}
+	}
+	for (size_t i = numWorkers; i < batch.workers.size(); i++) {
+		batch.workers[i].batch = NULL;
+	}
+
+	batch.running = true;
+}
+
+/*
+ * Wait until batch records are parsed.
+ */
+bool
+MarcIsoParallelReader::joinBatch(Batch &batch)
+{
+	bool stopped = false;
+
+	if (!batch.running) {
+		return false;
+	}
+
+	// Wait for worker threads of batch.
+	for (size_t i = 0; i < batch.workers.size(); i++) {
+		Worker &worker = batch.workers[i];
+		if (worker.batch != &batch) {
+			continue;
+		}
+		if (worker.threadStarted) {
+			thread_join(worker.thread);
+			worker.threadStarted = false;
+		}
+		stopped |= worker.stopped;
+		worker.batch = NULL;
+	}
+
+	batch.running = false;
+
+	return stopped;
+}
+
+/*
+ * Parse range of batch records.
+ */
+void
+MarcIsoParallelReader::parseRecords(void *workerPtr)
+{
+	Worker *worker = (Worker *) workerPtr;
+	Batch *batch = worker->batch;
+
+	for (size_t i = worker->firstRecord; i < worker->lastRecord; i++) {
+		BatchRecord &batchRecord = batch->records[i];
+		if (batchRecord.errorCode != OK) {
+			continue;
+		}
+
+		// Parse record.
+		if (!worker->parser->parse(&batch->data[batchRecord.offset],
+			batchRecord.length, batchRecord.record))
+		{
+			batchRecord.errorCode = worker->parser->getErrorCode();
+			batchRecord.errorMessage =
+				worker->parser->getErrorMessage();
+			continue;
+		}
+
+		// Pass record to handler.
+		if (worker->handler != NULL && !worker->stopped) {
+			worker->stopped = !worker->handler(batchRecord.record,
+				worker->userData);
+		}
+	}
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCISO_PARALLEL_READER_H
+#define MARCRECORD_MARCISO_PARALLEL_READER_H
+
+#include <string>
+#include <vector>
+#include "marc_reader.h"
+#include "marciso_reader.h"
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+
+namespace marcrecord {
+
+/*
+ * ISO 2709 records reader parsing records in parallel threads.
+ *
+ * Input file is cut into batches of records, records of batch are parsed
+ * by worker threads while records of previous batch are returned to the
+ * caller. Threads are started for every batch, their start-up time is
+ * negligible compared to parsing of batch (256 records per thread).
+ */
+class MarcIsoParallelReader : public MarcReader {
+public:
+	// Record handler, returns false to stop reading.
+	typedef bool (*RecordHandler)(MarcRecord &record, void *userData);
+
+	// Record of batch.
+	struct BatchRecord {
+		// Offset of record data in batch buffer.
+		size_t offset;
+		// Length of record data.
+		unsigned int length;
+		// Code of record read or parse error.
+		ErrorCode errorCode;
+		// Message of record read or parse error.
+		std::string errorMessage;
+		// Parsed record.
+		MarcRecord record;
+	};
+	typedef struct BatchRecord BatchRecord;
+
+	struct Batch;
+
+	// Worker thread state.
+	struct Worker {
+		// Parser of worker.
+		MarcIsoReader *parser;
+		// Batch and range of records to parse.
+		struct Batch *batch;
+		size_t firstRecord;
+		size_t lastRecord;
+		// Record handler for unordered reading.
+		RecordHandler handler;
+		void *userData;
+		// Record handler requested stop.
+		bool stopped;
+		// Worker thread.
+		thread_t thread;
+		bool threadStarted;
+	};
+	typedef struct Worker Worker;
+
+	// Batch of records.
+	struct Batch {
+		// Raw data of records.
+		std::vector<char> data;
+		// Records of batch (list keeps capacity between batches).
+		std::vector<BatchRecord> records;
+		// Number of records in batch.
+		size_t numRecords;
+		// Position of next record to return.
+		size_t recordPos;
+		// Worker threads are started for batch.
+		bool running;
+		// Worker threads parsing batch.
+		std::vector<Worker> workers;
+	};
+	typedef struct Batch Batch;
+
+protected:
+	// Reader of raw records.
+	MarcIsoReader m_reader;
+	// End of input file reached.
+	bool m_endOfFile;
+	// Number of worker threads.
+	unsigned int m_numThreads;
+	// Maximum number of records in batch.
+	unsigned int m_batchSize;
+	// Batches of records (one is returned while other is parsed).
+	Batch m_batches[2];
+	// Index of batch being returned.
+	int m_currentBatch;
+
+private:
+	// Stop worker threads and clear state of opened file.
+	void reset(void);
+	// Read raw records to batch.
+	void fillBatch(Batch &batch);
+	// Start parsing of batch records.
+	void startBatch(Batch &batch, RecordHandler handler = NULL,
+		void *userData = NULL);
+	// Wait until batch records are parsed.
+	bool joinBatch(Batch &batch);
+	// Parse range of batch records.
+	static void parseRecords(void *worker);
+
+public:
+	// Constructor.
+	MarcIsoParallelReader(FILE *inputFile = NULL,
+		const char *inputEncoding = NULL, unsigned int numThreads = 0);
+	// Destructor.
+	~MarcIsoParallelReader();
+
+	// Set number of worker threads (0 means number of processors).
+	void setNumThreads(unsigned int numThreads = 0);
+	// Set maximum number of records in batch (0 means default).
+	void setBatchSize(unsigned int batchSize = 0);
+
+	// Open input file.
+	bool open(FILE *inputFile, const char *inputEncoding = NULL);
+	// Open input file by name and map it into memory.
+	bool openMapped(const char *inputFileName,
+		const char *inputEncoding = NULL);
+	// Close input file.
+	void close(void);
+	// Read next record from file in original order.
+	bool next(MarcRecord &record);
+	// Read all records from file passing them to handler (in unordered
+	// mode handler is called from worker threads and reading stops after
+	// batch containing invalid record, records read ahead by next() are
+	// passed first in original order from calling thread).
+	bool read(RecordHandler handler, void *userData = NULL,
+		bool ordered = true);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCISO_PARALLEL_READER_H
@@ -39,6 +39,12 @@ namespace marcrecord {
 #define ISO2709_FIELD_SEPARATOR		'\x1E'
 #define ISO2709_IDENTIFIER_DELIMITER	'\x1F'
 
+// Maximum length of record.
+#define ISO2709_MAX_RECORD_LENGTH	99999
+
+// Size of input file buffer.
+#define INPUT_BUFFER_SIZE		(256 * 1024)
+
 #pragma pack(1)
 
 /* Structure of record directory entry. */
@@ -66,6 +72,13 @@ MarcIsoReader::MarcIsoReader(FILE *inputFile, const char *inputEncoding)
 {
 	// Clear member variables.
 	m_iconvDesc = (iconv_t) -1;
+	m_mapData = NULL;
+	m_mapSize = 0;
+	m_mapPos = 0;
+	m_inputPos = 0;
+	m_inputLen = 0;
+	m_lazyMode = false;
+	m_openCount = 0;
 
 	if (inputFile) {
 		// Open input file.
@@ -95,16 +108,88 @@ MarcIsoReader::open(FILE *inputFile, const char *inputEncoding)
 	m_errorCode = OK;
 	m_errorMessage = "";
 
+	// Release memory-mapped input file.
+	if (m_mapData != NULL) {
+		unmap_file(m_mapData, m_mapSize);
+		m_mapData = NULL;
+		m_mapSize = 0;
+		m_mapPos = 0;
+	}
+
 	// Initialize input stream parameters.
 	m_inputFile = inputFile == NULL ? stdin : inputFile;
 	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+	m_inputPos = 0;
+	m_inputLen = 0;
+
+	// Initialize encoding conversion.
+	return initEncoding(inputEncoding);
+}
+
+/*
+ * Open input file by name and map it into memory.
+ */
+bool
+MarcIsoReader::openMapped(const char *inputFileName,
+	const char *inputEncoding)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Release previously memory-mapped input file.
+	if (m_mapData != NULL) {
+		unmap_file(m_mapData, m_mapSize);
+		m_mapData = NULL;
+		m_mapSize = 0;
+		m_mapPos = 0;
+	}
+
+	// Map input file into memory.
+	m_mapData = map_file(inputFileName, m_mapSize);
+	if (m_mapData == NULL) {
+		m_mapSize = 0;
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "can't map input file";
+		return false;
+	}
+	m_mapPos = 0;
+
+	// Initialize input stream parameters.
+	m_inputFile = NULL;
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+	m_inputPos = 0;
+	m_inputLen = 0;
 
 	// Initialize encoding conversion.
+	return initEncoding(inputEncoding);
+}
+
+/*
+ * Initialize encoding conversion.
+ */
+bool
+MarcIsoReader::initEncoding(const char *inputEncoding)
+{
+	// Invalidate records parsed in lazy mode from previous input.
+	m_openCount++;
+
+	// Finalize iconv of previous input.
+	if (m_iconvDesc != (iconv_t) -1) {
+		iconv_close(m_iconvDesc);
+		m_iconvDesc = (iconv_t) -1;
+	}
+
+	m_codec.clear();
+	m_charsetCodec.clear();
 	if (inputEncoding == NULL
 		|| strcmp(inputEncoding, "UTF-8") == 0
 		|| strcmp(inputEncoding, "utf-8") == 0)
 	{
 		m_iconvDesc = (iconv_t) -1;
+	} else if (m_charsetCodec.init(inputEncoding)) {
+		// Use built-in converter for MARC character set.
+		m_iconvDesc = (iconv_t) -1;
 	} else {
 		// Create iconv descriptor for input encoding conversion.
 		m_iconvDesc = iconv_open("UTF-8", inputEncoding);
@@ -118,6 +203,9 @@ MarcIsoReader::open(FILE *inputFile, const char *inputEncoding)
 			}
 			return false;
 		}
+
+		// Initialize converter for single-byte encoding.
+		m_codec.init(inputEncoding);
 	}
 
 	return true;
@@ -134,44 +222,111 @@ MarcIsoReader::close(void)
 		iconv_close(m_iconvDesc);
 	}
 
+	// Release memory-mapped input file.
+	if (m_mapData != NULL) {
+		unmap_file(m_mapData, m_mapSize);
+	}
+
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
 	m_inputFile = NULL;
 	m_inputEncoding = "";
 	m_iconvDesc = (iconv_t) -1;
+	m_codec.clear();
+	m_charsetCodec.clear();
+	m_mapData = NULL;
+	m_mapSize = 0;
+	m_mapPos = 0;
+	m_inputPos = 0;
+	m_inputLen = 0;
 	m_autoCorrectionMode = false;
+	m_lazyMode = false;
+	m_openCount++;
+}
+
+/*
+ * Set lazy mode.
+ */
+void
+MarcIsoReader::setLazyMode(bool lazyMode)
+{
+	m_lazyMode = lazyMode;
 }
 
 /*
- * Read next record from MARCXML file.
+ * Read next record from ISO 2709 file.
  */
 bool
 MarcIsoReader::next(MarcRecord &record)
 {
-	int symbol;
-	char recordBuf[100000];
+	const char *recordBuf;
+	unsigned int recordLen;
+
+	// Read record.
+	if (!readRecord(recordBuf, recordLen)) {
+		return false;
+	}
+
+	// Parse record.
+	return parse(recordBuf, recordLen, record);
+}
+
+/*
+ * Read next record from ISO 2709 file without decoding its content.
+ */
+bool
+MarcIsoReader::next(MarcRecordView &recordView)
+{
+	const char *recordBuf;
 	unsigned int recordLen;
 
+	// Read record.
+	if (!readRecord(recordBuf, recordLen)) {
+		recordView.clear();
+		return false;
+	}
+
+	// Decode record leader and directory.
+	if (!recordView.parse(recordBuf, recordLen)) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "invalid record leader or directory";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Read raw record data from input file.
+ */
+bool
+MarcIsoReader::readRecord(const char *&recordBuf, unsigned int &recordLen)
+{
+	// Read record from memory-mapped input file.
+	if (m_mapData != NULL) {
+		return readMappedRecord(recordBuf, recordLen);
+	}
+
 	// Clear error code and message.
 	m_errorCode = OK;
 	m_errorMessage = "";
 
 	if (!m_autoCorrectionMode) {
 		// Read record length.
-		if (fread(recordBuf, 1, 5, m_inputFile) != 5) {
+		if (fillInput(5) < 5) {
+			m_inputPos = m_inputLen;
 			m_errorCode = END_OF_FILE;
 			return false;
 		}
 
 		// Parse record length.
-		if (!is_numeric(recordBuf, 5)
-			|| sscanf(recordBuf, "%5u", &recordLen) != 1)
+		if (!decode_number(&m_inputBuf[m_inputPos], 5, recordLen)
+			|| recordLen < 5)
 		{
 			// Skip until record separator.
-			do {
-				symbol = fgetc(m_inputFile);
-			} while (symbol >= 0 && symbol != ISO2709_RECORD_SEPARATOR);
+			m_inputPos += 5;
+			skipRecord();
 
 			m_errorCode = ERROR_INVALID_RECORD;
 			m_errorMessage = "invalid record length";
@@ -179,46 +334,234 @@ MarcIsoReader::next(MarcRecord &record)
 		}
 
 		// Read record.
-		if (fread(recordBuf + 5, 1, recordLen - 5, m_inputFile)
-			!= recordLen - 5)
-		{
-			// Skip until record separator.
-			do {
-				symbol = fgetc(m_inputFile);
-			} while (!feof(m_inputFile) && symbol != ISO2709_RECORD_SEPARATOR);
+		if (fillInput(recordLen) < recordLen) {
+			// Skip rest of input file.
+			m_inputPos = m_inputLen;
 
 			m_errorCode = ERROR_INVALID_RECORD;
 			m_errorMessage =
 				"invalid record length or record data incomplete";
 			return false;
 		}
-	} else {
-		// Read record until record separator.
-		char* recordBufPtr = recordBuf;
-		recordLen = 0;
-		do {
-			symbol = fgetc(m_inputFile);
-			if (!feof(m_inputFile)) {
-				*recordBufPtr = static_cast<char>(symbol);
-				recordBufPtr++;
-				recordLen++;
+
+		// Use input buffer as record buffer.
+		recordBuf = &m_inputBuf[m_inputPos];
+		m_inputPos += recordLen;
+		return true;
+	}
+
+	// Find record separator.
+	const char *separator = NULL;
+	size_t scanLen = 0;
+	while (separator == NULL) {
+		size_t dataLen = fillInput(scanLen + 1);
+		if (dataLen <= scanLen) {
+			m_inputPos = m_inputLen;
+			m_errorCode = END_OF_FILE;
+			return false;
+		}
+
+		separator = (const char *) memchr(
+			&m_inputBuf[m_inputPos + scanLen],
+			ISO2709_RECORD_SEPARATOR, dataLen - scanLen);
+		scanLen = dataLen;
+
+		// Skip record exceeding ISO 2709 limit.
+		if (separator == NULL && scanLen > ISO2709_MAX_RECORD_LENGTH) {
+			m_inputPos += scanLen;
+			if (!skipRecord()) {
+				m_errorCode = END_OF_FILE;
+				return false;
 			}
-		} while (!feof(m_inputFile) && symbol != ISO2709_RECORD_SEPARATOR);
 
-		if (feof(m_inputFile)) {
+			m_errorCode = ERROR_INVALID_RECORD;
+			m_errorMessage = "record length exceed ISO2709 limit";
+			return false;
+		}
+	}
+	char *recordData = &m_inputBuf[m_inputPos];
+	recordLen = (unsigned int) (separator - recordData) + 1;
+	m_inputPos += recordLen;
+	if (recordLen > ISO2709_MAX_RECORD_LENGTH) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "record length exceed ISO2709 limit";
+		return false;
+	}
+
+	// Use copy of record if it is too short to hold record length.
+	if (recordLen < 5) {
+		m_recordBuf.assign(recordData, recordData + recordLen);
+		m_recordBuf.resize(5);
+		recordData = &m_recordBuf[0];
+	}
+
+	// Replace record length.
+	char lengthBuf[6];
+	sprintf(lengthBuf, "%05u", recordLen);
+	memcpy(recordData, lengthBuf, 5);
+
+	recordBuf = recordData;
+	return true;
+}
+
+/*
+ * Make at least specified number of bytes available in input buffer.
+ */
+size_t
+MarcIsoReader::fillInput(size_t size)
+{
+	size_t dataLen = m_inputLen - m_inputPos;
+	if (dataLen >= size) {
+		return dataLen;
+	}
+
+	// Move unread data to the beginning of input buffer.
+	if (m_inputPos > 0) {
+		memmove(&m_inputBuf[0], &m_inputBuf[m_inputPos], dataLen);
+		m_inputPos = 0;
+		m_inputLen = dataLen;
+	}
+
+	// Allocate input buffer.
+	if (m_inputBuf.size() < INPUT_BUFFER_SIZE) {
+		m_inputBuf.resize(INPUT_BUFFER_SIZE);
+	}
+	if (m_inputBuf.size() < size) {
+		m_inputBuf.resize(size);
+	}
+
+	// Read input file until requested size is available.
+	while (m_inputLen < size) {
+		size_t readLen = fread(&m_inputBuf[m_inputLen], 1,
+			m_inputBuf.size() - m_inputLen, m_inputFile);
+		if (readLen == 0) {
+			break;
+		}
+		m_inputLen += readLen;
+	}
+
+	return m_inputLen - m_inputPos;
+}
+
+/*
+ * Skip input data until record separator.
+ */
+bool
+MarcIsoReader::skipRecord(void)
+{
+	while (fillInput(1) > 0) {
+		const char *inputData = &m_inputBuf[m_inputPos];
+		const char *separator = (const char *) memchr(inputData,
+			ISO2709_RECORD_SEPARATOR, m_inputLen - m_inputPos);
+		if (separator != NULL) {
+			m_inputPos += (size_t) (separator - inputData) + 1;
+			return true;
+		}
+		m_inputPos = m_inputLen;
+	}
+
+	return false;
+}
+
+/*
+ * Read raw record data from memory-mapped input file.
+ */
+bool
+MarcIsoReader::readMappedRecord(const char *&recordBuf,
+	unsigned int &recordLen)
+{
+	const char *recordData = m_mapData + m_mapPos;
+	size_t dataLen = m_mapSize - m_mapPos;
+
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	if (!m_autoCorrectionMode) {
+		// Check presence of record length.
+		if (dataLen < 5) {
+			m_mapPos = m_mapSize;
 			m_errorCode = END_OF_FILE;
 			return false;
 		}
- 		if (recordLen == 0) {
+
+		// Parse record length.
+		if (!decode_number(recordData, 5, recordLen)) {
+			// Skip until record separator.
+			const char *separator = (const char *) memchr(
+				recordData + 5, ISO2709_RECORD_SEPARATOR,
+				dataLen - 5);
+			m_mapPos = separator == NULL ? m_mapSize
+				: (size_t) (separator - m_mapData) + 1;
+
 			m_errorCode = ERROR_INVALID_RECORD;
 			m_errorMessage = "invalid record length";
 			return false;
- 		}
+		}
+
+		// Check that whole record is present in file.
+		if (recordLen < 5 || recordLen > dataLen) {
+			m_mapPos = m_mapSize;
+
+			m_errorCode = ERROR_INVALID_RECORD;
+			m_errorMessage =
+				"invalid record length or record data incomplete";
+			return false;
+		}
+		m_mapPos += recordLen;
 
-		// Replace record length.
-		char lengthBuf[6];
-		sprintf(lengthBuf, "%05d", recordLen);
-		memcpy(recordBuf, lengthBuf, 5);
+		// Use mapped file data as record buffer.
+		recordBuf = recordData;
+		return true;
+	}
+
+	// Find record separator.
+	const char *separator = (const char *) memchr(recordData,
+		ISO2709_RECORD_SEPARATOR, dataLen);
+	if (separator == NULL) {
+		m_mapPos = m_mapSize;
+		m_errorCode = END_OF_FILE;
+		return false;
+	}
+	recordLen = (unsigned int) (separator - recordData) + 1;
+	m_mapPos += recordLen;
+	if (recordLen > ISO2709_MAX_RECORD_LENGTH) {
+		m_errorCode = ERROR_INVALID_RECORD;
+		m_errorMessage = "record length exceed ISO2709 limit";
+		return false;
+	}
+
+	// Use mapped file data as record buffer if record length is correct.
+	char lengthBuf[6];
+	sprintf(lengthBuf, "%05u", recordLen);
+	if (recordLen >= 5 && memcmp(recordData, lengthBuf, 5) == 0) {
+		recordBuf = recordData;
+		return true;
+	}
+
+	// Replace record length in copy of record.
+	m_recordBuf.assign(recordData, recordData + recordLen);
+	if (m_recordBuf.size() < 5) {
+		m_recordBuf.resize(5);
+	}
+	memcpy(&m_recordBuf[0], lengthBuf, 5);
+
+	recordBuf = &m_recordBuf[0];
+	return true;
+}
+
+/*
+ * Read next record from ISO 2709 file to record with contiguous storage.
+ */
+bool
+MarcIsoReader::next(FlatMarcRecord &record)
+{
+	const char *recordBuf;
+	unsigned int recordLen;
+
+	// Read record.
+	if (!readRecord(recordBuf, recordLen)) {
+		return false;
 	}
 
 	// Parse record.
@@ -231,6 +574,36 @@ MarcIsoReader::next(MarcRecord &record)
 bool
 MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 	MarcRecord &record)
+{
+	if (!parseRecord(recordBuf, recordBufLen, record)) {
+		return false;
+	}
+
+	// Keep copy of record data for decoding fields on first access.
+	if (m_lazyMode) {
+		record.m_rawData.assign(recordBuf, recordBuf + recordBufLen);
+		record.m_lazyReader = this;
+		record.m_lazyOpenCount = m_openCount;
+		record.m_lazyAutoCorrection = m_autoCorrectionMode;
+	}
+
+	return true;
+}
+
+bool
+MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
+	FlatMarcRecord &record)
+{
+	return parseRecord(recordBuf, recordBufLen, record);
+}
+
+/*
+ * Parse record from ISO 2709 buffer to record of specified type.
+ */
+template <class RecordType>
+bool
+MarcIsoReader::parseRecord(const char *recordBuf, unsigned int recordBufLen,
+	RecordType &record)
 {
 	// Clear error code and message.
 	m_errorCode = OK;
@@ -242,8 +615,7 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 	try {
 		// Check record length.
 		unsigned int recordLen;
-		if (!is_numeric(recordBuf, 5)
-			|| sscanf(recordBuf, "%5u", &recordLen) != 1
+		if (!decode_number(recordBuf, 5, recordLen)
 			|| recordLen != recordBufLen
 			|| recordLen < sizeof(MarcRecord::Leader))
 		{
@@ -273,9 +645,8 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 		// Get base address of data.
 		unsigned int baseAddress;
 		if (!m_autoCorrectionMode) {
-			if (!is_numeric(record.m_leader.baseAddress, 5)
-				|| sscanf(record.m_leader.baseAddress, "%05u",
-					&baseAddress) != 1
+			if (!decode_number(record.m_leader.baseAddress, 5,
+					baseAddress)
 				|| recordLen < baseAddress)
 			{
 				m_errorCode = ERROR_INVALID_RECORD;
@@ -283,18 +654,16 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 				throw m_errorCode;
 			}
 		} else {
-			baseAddress = 24;
-			while (baseAddress < recordLen -1
-				&& recordBuf[baseAddress] != ISO2709_FIELD_SEPARATOR)
-			{
-				baseAddress++;
-			}
-			if (recordBuf[baseAddress] != ISO2709_FIELD_SEPARATOR) {
+			const char *separator = (const char *) memchr(
+				recordBuf + sizeof(MarcRecord::Leader),
+				ISO2709_FIELD_SEPARATOR,
+				recordLen - sizeof(MarcRecord::Leader));
+			if (separator == NULL) {
 				m_errorCode = ERROR_INVALID_RECORD;
 				m_errorMessage = "base address of data cannot be found";
 				throw m_errorCode;
 			}
-			baseAddress++;
+			baseAddress = (unsigned int) (separator - recordBuf) + 1;
 		}
 
 		// Get number of fields.
@@ -316,12 +685,17 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 		unsigned int recordDataPos = baseAddress;
 		int fieldNo = 0;
 		for (; fieldNo < numFields; fieldNo++, directoryEntry++) {
-			std::string fieldTag(directoryEntry->fieldTag, 0, 3);
+			const char *fieldTag = directoryEntry->fieldTag;
 			unsigned int fieldLength, fieldStartPos;
 			if (!m_autoCorrectionMode) {
-				// Check directory entry.
-				if (!is_numeric((const char *) directoryEntry,
-					sizeof(RecordDirectoryEntry)))
+				// Check and parse directory entry.
+				unsigned int tagNumber;
+				if (!decode_number(fieldTag, 3, tagNumber)
+					|| !decode_number(directoryEntry->fieldLength,
+						4, fieldLength)
+					|| !decode_number(
+						directoryEntry->fieldStartingPosition,
+						5, fieldStartPos))
 				{
 					std::string errorPos;
 					snprintf(errorPos, 11, "%d",
@@ -332,32 +706,19 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 						+ errorPos;
 					throw m_errorCode;
 				}
-
-				// Parse directory entry.
-				if (sscanf(directoryEntry->fieldLength, "%4u%5u",
-					&fieldLength, &fieldStartPos) != 2)
-				{
-					std::string errorPos;
-					snprintf(errorPos, 11, "%d",
-						(char *) directoryEntry->fieldLength
-						- recordBuf);
-
-					m_errorCode = ERROR_INVALID_RECORD;
-					m_errorMessage = 
-						"invalid base address of data at "
-						+ errorPos;
-					throw m_errorCode;
-				}
 			} else {
 				fieldStartPos = recordDataPos - baseAddress;
-				while (recordDataPos < recordLen -1
-					&& recordBuf[recordDataPos] != ISO2709_FIELD_SEPARATOR)
-				{
-					recordDataPos++;
+				if (recordDataPos >= recordLen) {
+					break;
 				}
-				if (recordBuf[recordDataPos] != ISO2709_FIELD_SEPARATOR) {
+				const char *separator = (const char *) memchr(
+					recordBuf + recordDataPos,
+					ISO2709_FIELD_SEPARATOR,
+					recordLen - recordDataPos);
+				if (separator == NULL) {
 					break;
 				}
+				recordDataPos = (unsigned int) (separator - recordBuf);
 				fieldLength = recordDataPos - baseAddress - fieldStartPos + 1;
 				recordDataPos++;
 			}
@@ -366,7 +727,8 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 			unsigned int fieldEndPos =
 			       baseAddress + fieldStartPos + fieldLength;
 			if (fieldEndPos > recordLen
-				|| (fieldTag < "010" && fieldLength < 2))
+				|| (memcmp(fieldTag, "010", 3) < 0
+					&& fieldLength < 2))
 			{
 				std::string errorPos;
 				if (!m_autoCorrectionMode) {
@@ -385,7 +747,7 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 			}
 
 			// Check data field length.
-			if (fieldTag < "010" && fieldLength < 2) {
+			if (memcmp(fieldTag, "010", 3) < 0 && fieldLength < 2) {
 				std::string errorPos;
 				snprintf(errorPos, 11, "%d",
 					(char *) directoryEntry->fieldLength
@@ -397,12 +759,9 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 				throw m_errorCode;
 			}
 
-			// Parse field.
-			MarcRecord::Field field = parseField(fieldTag,
-				recordData + fieldStartPos, fieldLength,
-				baseAddress + fieldStartPos);
-			// Append field to list.
-			record.m_fieldList.push_back(field);
+			// Parse field and append it to record.
+			parseField(record, fieldTag, recordData + fieldStartPos,
+				fieldLength, baseAddress + fieldStartPos);
 		}
 	} catch (ErrorCode errorCode) {
 		record.clear();
@@ -413,150 +772,292 @@ MarcIsoReader::parse(const char *recordBuf, unsigned int recordBufLen,
 }
 
 /*
- * Parse field from ISO 2709 buffer.
+ * Parse field from ISO 2709 buffer and append it to record.
  */
-MarcRecord::Field
-MarcIsoReader::parseField(const std::string &fieldTag, const char *fieldData,
-	unsigned int fieldLength, unsigned int fieldAbsoluteStartPos)
+template <class RecordType>
+void
+MarcIsoReader::parseField(RecordType &record, const char *fieldTag,
+	const char *fieldData, unsigned int fieldLength,
+	unsigned int fieldAbsoluteStartPos)
 {
-	MarcRecord::Field field;
-
 	// Adjust field length.
-	if (fieldData[fieldLength - 1] == '\x1E') {
+	if (fieldData[fieldLength - 1] == ISO2709_FIELD_SEPARATOR) {
 		fieldLength--;
 	}
 
 	// Copy field tag.
-	field.m_tag = fieldTag;
+	char tagData[3];
+	memcpy(tagData, fieldTag, sizeof(tagData));
 
 	// Replace incorrect characters in field tag to '?'.
 	if (m_autoCorrectionMode) {
-		for (std::string::iterator it = field.m_tag.begin();
-			it != field.m_tag.end(); it++)
-		{
-			if (*it < '0' || *it > '9') {
-				*it = '?';
+		for (size_t i = 0; i < sizeof(tagData); i++) {
+			if (tagData[i] < '0' || tagData[i] > '9') {
+				tagData[i] = '?';
 			}
 		}
 	}
+	Tag tag(tagData, sizeof(tagData));
 
-	if (fieldTag < "010") {
-		// Parse control field.
-		field.m_type = MarcRecord::Field::CONTROLFIELD;
-		if (m_iconvDesc == (iconv_t) -1) {
-			field.m_data.assign(fieldData, fieldLength);
-		} else {
-			if (!iconv(m_iconvDesc, fieldData, fieldLength,
-				field.m_data))
-			{
-				std::string errorPos;
-				snprintf(errorPos, 11, "%d",
-					fieldAbsoluteStartPos);
+	// Defer parsing of field contents in lazy mode.
+	if (m_lazyMode && appendRawField(record, tag,
+		memcmp(fieldTag, "010", 3) < 0,
+		fieldAbsoluteStartPos, fieldLength))
+	{
+		return;
+	}
 
-				m_errorCode = ERROR_ICONV;
-				m_errorMessage = "encoding conversion failed "
-					"at " + errorPos;
-				throw m_errorCode;
-			}
-		}
+	if (memcmp(fieldTag, "010", 3) < 0) {
+		// Parse control field.
+		parseControlData(fieldData, fieldLength,
+			fieldAbsoluteStartPos, m_fieldData);
+		record.addControlField(tag, m_fieldData);
 	} else {
 		// Parse data field.
-		field.m_type = MarcRecord::Field::DATAFIELD;
-		field.m_ind1 = fieldData[0];
-		field.m_ind2 = fieldData[1];
+		typename RecordType::FieldIt fieldIt =
+			record.addDataField(tag, parseIndicator(fieldData[0]),
+				parseIndicator(fieldData[1]));
+		parseSubfields(record, fieldIt, fieldData, fieldLength);
+	}
+}
 
-		// Replace invalid indicators to character '?'.
-		if (m_autoCorrectionMode) {
-			if ((field.m_ind1 != ' ') && (field.m_ind1 != '|')
-				&& (field.m_ind1 < '0' || field.m_ind1 > '9')
-				&& (field.m_ind1 < 'a' || field.m_ind1 > 'z'))
-			{
-				field.m_ind1 = '?';
-			}
+/*
+ * Parse data of control field.
+ */
+void
+MarcIsoReader::parseControlData(const char *fieldData,
+	unsigned int fieldLength, unsigned int fieldAbsoluteStartPos,
+	std::string &data)
+{
+	if (m_iconvDesc == (iconv_t) -1 && !m_charsetCodec.isValid()) {
+		data.assign(fieldData, fieldLength);
+	} else {
+		if (!decodeData(fieldData, fieldLength, data)) {
+			std::string errorPos;
+			snprintf(errorPos, 11, "%d", fieldAbsoluteStartPos);
 
-			if ((field.m_ind2 != ' ') && (field.m_ind2 != '|')
-				&& (field.m_ind2 < '0' || field.m_ind2 > '9')
-				&& (field.m_ind2 < 'a' || field.m_ind2 > 'z'))
-			{
-				field.m_ind2 = '?';
-			}
+			m_errorCode = ERROR_ICONV;
+			m_errorMessage = "encoding conversion failed at "
+				+ errorPos;
+			throw m_errorCode;
 		}
+	}
+}
 
-		// Parse list of subfields.
-		unsigned int subfieldStartPos = 0;
-		unsigned int symbolPos;
-		for (symbolPos = 2; symbolPos <= fieldLength; symbolPos++) {
-			// Skip symbols of subfield data.
-			if (fieldData[symbolPos] != '\x1F'
-				&& symbolPos != fieldLength)
-			{
-				continue;
-			}
+/*
+ * Parse indicator of data field.
+ */
+char
+MarcIsoReader::parseIndicator(char ind)
+{
+	// Replace invalid indicator to character '?'.
+	if (m_autoCorrectionMode
+		&& (ind != ' ') && (ind != '|')
+		&& (ind < '0' || ind > '9')
+		&& (ind < 'a' || ind > 'z'))
+	{
+		return '?';
+	}
 
-			if (symbolPos > 2) {
-				// Parse regular subfield.
-				MarcRecord::Subfield subfield;
-				subfield = parseSubfield(fieldData,
-					subfieldStartPos, symbolPos);
-				field.m_subfieldList.push_back(subfield);
-			}
+	return ind;
+}
+
+/*
+ * Parse list of subfields and append them to data field.
+ */
+template <class RecordType>
+void
+MarcIsoReader::parseSubfields(RecordType &record,
+	typename RecordType::FieldIt fieldIt, const char *fieldData,
+	unsigned int fieldLength)
+{
+	unsigned int subfieldStartPos = 0;
+	unsigned int symbolPos;
+	for (symbolPos = 2; symbolPos <= fieldLength; symbolPos++) {
+		// Skip symbols of subfield data.
+		const char *delimiter = (const char *) memchr(
+			fieldData + symbolPos,
+			ISO2709_IDENTIFIER_DELIMITER,
+			fieldLength - symbolPos);
+		symbolPos = delimiter == NULL ? fieldLength
+			: (unsigned int) (delimiter - fieldData);
 
-			subfieldStartPos = symbolPos;
+		if (symbolPos > 2) {
+			// Parse regular subfield.
+			char subfieldId;
+			parseSubfield(fieldData, subfieldStartPos,
+				symbolPos, subfieldId, m_fieldData);
+			appendSubfield(record, fieldIt, subfieldId,
+				m_fieldData);
 		}
-	}
 
-	return field;
+		subfieldStartPos = symbolPos;
+	}
 }
 
 /*
  * Parse subfield.
  */
-MarcRecord::Subfield
+void
 MarcIsoReader::parseSubfield(const char *fieldData,
-	unsigned int subfieldStartPos, unsigned int subfieldEndPos)
+	unsigned int subfieldStartPos, unsigned int subfieldEndPos,
+	char &subfieldId, std::string &subfieldData)
 {
-	// Parse regular subfield.
-	MarcRecord::Subfield subfield;
-	subfield.clear();
-
 	// Copy subfield identifier.
-	subfield.m_id = fieldData[subfieldStartPos + 1];
+	subfieldId = fieldData[subfieldStartPos + 1];
 	// Replace invalid subfield identifier.
 	if (m_autoCorrectionMode
-		&& (subfield.m_id < '0' || subfield.m_id > '9')
-		&& (subfield.m_id < 'a' || subfield.m_id > 'z'))
+		&& (subfieldId < '0' || subfieldId > '9')
+		&& (subfieldId < 'a' || subfieldId > 'z'))
 	{
-		subfield.m_id = '?';
+		subfieldId = '?';
 	}
 
 	// Check subfield length.
 	if (subfieldEndPos - subfieldStartPos < 2) {
 		if (m_autoCorrectionMode) {
-			subfield.m_data = "?";
-			return subfield;
+			subfieldData = "?";
+			return;
 		}
 		m_errorCode = ERROR_INVALID_RECORD;
 		m_errorMessage = "invalid subfield";
 		throw m_errorCode;
 	}
 
-	if (m_iconvDesc == (iconv_t) -1) {
+	if (m_iconvDesc == (iconv_t) -1 && !m_charsetCodec.isValid()) {
 		// Copy subfield data.
-		subfield.m_data.assign(
+		subfieldData.assign(
 			fieldData + subfieldStartPos + 2,
 			subfieldEndPos - subfieldStartPos - 2);
 	} else {
 		// Copy subfield data with encoding conversion.
-		if (!iconv(m_iconvDesc,
-			fieldData + subfieldStartPos + 2,
-			subfieldEndPos - subfieldStartPos - 2,
-			subfield.m_data))
-		{
+		const char *data = fieldData + subfieldStartPos + 2;
+		size_t dataLen = subfieldEndPos - subfieldStartPos - 2;
+		if (!decodeData(data, dataLen, subfieldData)) {
 			m_errorCode = ERROR_ICONV;
 			m_errorMessage = "encoding conversion failed";
 			throw m_errorCode;
 		}
 	}
+}
 
-	return subfield;
+/*
+ * Convert data from input encoding to UTF-8.
+ */
+bool
+MarcIsoReader::decodeData(const char *data, size_t dataLen,
+	std::string &dest)
+{
+	// Convert data with built-in converters, use iconv if they fail.
+	if (m_charsetCodec.isValid()) {
+		return m_charsetCodec.decode(data, dataLen, dest);
+	}
+
+	return m_codec.decode(data, dataLen, dest)
+		|| iconv(m_iconvDesc, data, dataLen, dest);
+}
+
+/*
+ * Append field with undecoded contents to record.
+ */
+bool
+MarcIsoReader::appendRawField(MarcRecord &record, const Tag &tag,
+	bool controlField, unsigned int fieldAbsoluteStartPos,
+	unsigned int fieldLength)
+{
+	MarcRecord::FieldIt fieldIt = controlField
+		? record.addControlField(tag) : record.addDataField(tag);
+	fieldIt->m_lazy = true;
+	fieldIt->m_rawPos = fieldAbsoluteStartPos;
+	fieldIt->m_rawLength = fieldLength;
+
+	return true;
+}
+
+bool
+MarcIsoReader::appendRawField(FlatMarcRecord &record, const Tag &tag,
+	bool controlField, unsigned int fieldAbsoluteStartPos,
+	unsigned int fieldLength)
+{
+	// Record with contiguous storage is always decoded immediately.
+	(void) record;
+	(void) tag;
+	(void) controlField;
+	(void) fieldAbsoluteStartPos;
+	(void) fieldLength;
+
+	return false;
+}
+
+/*
+ * Decode contents of field parsed in lazy mode.
+ */
+bool
+MarcIsoReader::decodeField(MarcRecord &record, MarcRecord::FieldIt fieldIt)
+{
+	const char *fieldData = &record.m_rawData[fieldIt->m_rawPos];
+	unsigned int fieldLength = fieldIt->m_rawLength;
+	fieldIt->m_lazy = false;
+
+	// Check that input of record is still open.
+	if (record.m_lazyOpenCount != m_openCount) {
+		if (record.m_decodeErrorMessage.empty()) {
+			record.m_decodeErrorMessage =
+				"input of record parsed in lazy mode is closed";
+		}
+		return false;
+	}
+
+	// Keep reader error, decode field in mode used for parsing record.
+	ErrorCode errorCode = m_errorCode;
+	std::string errorMessage;
+	errorMessage.swap(m_errorMessage);
+	bool autoCorrectionMode = m_autoCorrectionMode;
+	m_autoCorrectionMode = record.m_lazyAutoCorrection;
+
+	bool result = true;
+	try {
+		if (fieldIt->isControlField()) {
+			// Parse control field.
+			parseControlData(fieldData, fieldLength,
+				fieldIt->m_rawPos, fieldIt->m_data);
+		} else {
+			// Parse data field.
+			fieldIt->m_ind1 = parseIndicator(fieldData[0]);
+			fieldIt->m_ind2 = parseIndicator(fieldData[1]);
+			parseSubfields(record, fieldIt, fieldData, fieldLength);
+		}
+	} catch (ErrorCode) {
+		// Keep first decoding error in record.
+		if (record.m_decodeErrorMessage.empty()) {
+			record.m_decodeErrorMessage = m_errorMessage;
+		}
+		result = false;
+	}
+
+	// Restore reader state.
+	m_errorCode = errorCode;
+	m_errorMessage.swap(errorMessage);
+	m_autoCorrectionMode = autoCorrectionMode;
+
+	return result;
+}
+
+/*
+ * Append subfield to data field of record.
+ */
+void
+MarcIsoReader::appendSubfield(MarcRecord &record, MarcRecord::FieldIt fieldIt,
+	char subfieldId, const std::string &subfieldData)
+{
+	(void) record;
+	fieldIt->addSubfield(subfieldId, subfieldData);
+}
+
+void
+MarcIsoReader::appendSubfield(FlatMarcRecord &record,
+	FlatMarcRecord::FieldIt fieldIt, char subfieldId,
+	const std::string &subfieldData)
+{
+	record.addSubfield(fieldIt, subfieldId, subfieldData);
 }
@@ -31,8 +31,13 @@
 
 #include <iconv.h>
 #include <string>
+#include <vector>
+#include "flat_marcrecord.h"
 #include "marc_reader.h"
+#include "marcrecord_charset.h"
+#include "marcrecord_codec.h"
 #include "marcrecord.h"
+#include "marcrecord_view.h"
 
 namespace marcrecord {
 
@@ -40,18 +45,96 @@ namespace marcrecord {
  * ISO 2709 records reader.
  */
 class MarcIsoReader : public MarcReader {
+	// Parallel ISO 2709 reader class.
+	friend class MarcIsoParallelReader;
+	// MARC record class.
+	friend class MarcRecord;
+
 protected:
 	// Iconv descriptor for input encoding.
 	iconv_t m_iconvDesc;
+	// Converter for single-byte input encoding.
+	SingleByteCodec m_codec;
+	// Converter for MARC character set of input.
+	MarcCharsetCodec m_charsetCodec;
+
+	// Memory-mapped input file data.
+	const char *m_mapData;
+	// Size of memory-mapped input file.
+	size_t m_mapSize;
+	// Position of next record in memory-mapped input file.
+	size_t m_mapPos;
+
+	// Input file buffer.
+	std::vector<char> m_inputBuf;
+	// Position of unread data in input file buffer.
+	size_t m_inputPos;
+	// Length of data in input file buffer.
+	size_t m_inputLen;
+
+	// Record buffer.
+	std::vector<char> m_recordBuf;
+	// Buffer of decoded field or subfield data.
+	std::string m_fieldData;
+
+	// Lazy mode flag.
+	bool m_lazyMode;
+	// Number of times input was opened or closed (identifies input
+	// of records parsed in lazy mode).
+	unsigned int m_openCount;
 
 private:
-	// Parse field from ISO 2709 buffer.
-	inline MarcRecord::Field parseField(const std::string &fieldTag,
+	// Initialize encoding conversion.
+	bool initEncoding(const char *inputEncoding);
+	// Read raw record data from input file.
+	bool readRecord(const char *&recordBuf, unsigned int &recordLen);
+	// Read raw record data from memory-mapped input file.
+	bool readMappedRecord(const char *&recordBuf, unsigned int &recordLen);
+	// Make at least specified number of bytes available in input buffer.
+	size_t fillInput(size_t size);
+	// Skip input data until record separator.
+	bool skipRecord(void);
+	// Parse record from ISO 2709 buffer to record of specified type.
+	template <class RecordType>
+	bool parseRecord(const char *recordBuf, unsigned int recordBufLen,
+		RecordType &record);
+	// Parse field from ISO 2709 buffer and append it to record.
+	template <class RecordType>
+	inline void parseField(RecordType &record, const char *fieldTag,
 		const char *fieldData, unsigned int fieldLength,
 		unsigned int fieldAbsoluteStartPos);
+	// Parse data of control field.
+	void parseControlData(const char *fieldData, unsigned int fieldLength,
+		unsigned int fieldAbsoluteStartPos, std::string &data);
+	// Parse indicator of data field.
+	char parseIndicator(char ind);
+	// Parse list of subfields and append them to data field.
+	template <class RecordType>
+	void parseSubfields(RecordType &record,
+		typename RecordType::FieldIt fieldIt, const char *fieldData,
+		unsigned int fieldLength);
 	// Parse subfield.
-	MarcRecord::Subfield parseSubfield(const char *fieldData,
-		unsigned int subfieldStartPos, unsigned int subfieldEndPos);
+	void parseSubfield(const char *fieldData,
+		unsigned int subfieldStartPos, unsigned int subfieldEndPos,
+		char &subfieldId, std::string &subfieldData);
+	// Convert data from input encoding to UTF-8.
+	bool decodeData(const char *data, size_t dataLen, std::string &dest);
+	// Append subfield to data field of record.
+	static void appendSubfield(MarcRecord &record,
+		MarcRecord::FieldIt fieldIt, char subfieldId,
+		const std::string &subfieldData);
+	static void appendSubfield(FlatMarcRecord &record,
+		FlatMarcRecord::FieldIt fieldIt, char subfieldId,
+		const std::string &subfieldData);
+	// Append field with undecoded contents to record.
+	bool appendRawField(MarcRecord &record, const Tag &tag,
+		bool controlField, unsigned int fieldAbsoluteStartPos,
+		unsigned int fieldLength);
+	bool appendRawField(FlatMarcRecord &record, const Tag &tag,
+		bool controlField, unsigned int fieldAbsoluteStartPos,
+		unsigned int fieldLength);
+	// Decode contents of field parsed in lazy mode.
+	bool decodeField(MarcRecord &record, MarcRecord::FieldIt fieldIt);
 
 public:
 	// Constructor.
@@ -62,14 +145,30 @@ public:
 
 	// Open input file.
 	bool open(FILE *inputFile, const char *inputEncoding = NULL);
+	// Open input file by name and map it into memory.
+	bool openMapped(const char *inputFileName,
+		const char *inputEncoding = NULL);
 	// Close input file.
 	void close(void);
+
+	// Set lazy mode (contents of fields are decoded when fields are
+	// returned by record methods, record must not outlive reader).
+	// Fields decoded after reader is reopened or closed and undecoded
+	// fields (reached by incrementing iterator) added to other record
+	// are left empty with decoding error in record.
+	void setLazyMode(bool lazyMode = true);
 	// Read next record from file.
 	bool next(MarcRecord &record);
+	// Read next record from file without decoding its content.
+	bool next(MarcRecordView &recordView);
+	// Read next record from file to record with contiguous storage.
+	bool next(FlatMarcRecord &record);
 
 	// Parse record from ISO 2709 buffer.
 	bool parse(const char *recordBuf, unsigned int recordBufLen,
 		MarcRecord &record);
+	bool parse(const char *recordBuf, unsigned int recordBufLen,
+		FlatMarcRecord &record);
 };
 
 } // namespace marcrecord
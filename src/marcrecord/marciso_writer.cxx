@@ -26,6 +26,7 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <cerrno>
 #include <cstdio>
 #include <cstring>
@@ -39,6 +40,11 @@ namespace marcrecord {
 #define ISO2709_FIELD_SEPARATOR		'\x1E'
 #define ISO2709_IDENTIFIER_DELIMITER	'\x1F'
 
+// Maximum length of record.
+#define ISO2709_MAX_RECORD_LENGTH	99999
+// Maximum length of field.
+#define ISO2709_MAX_FIELD_LENGTH	9999
+
 #pragma pack(1)
 
 /*
@@ -93,20 +99,23 @@ MarcIsoWriter::~MarcIsoWriter()
 bool
 MarcIsoWriter::open(FILE *outputFile, const char *outputEncoding)
 {
-	// Clear error code and message.
-	m_errorCode = OK;
-	m_errorMessage = "";
+	// Close previous output file, writing its buffered data.
+	close();
 
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
 	m_outputEncoding = outputEncoding == NULL ? "" : outputEncoding;
 
 	// Initialize encoding conversion.
+	m_charsetCodec.clear();
 	if (outputEncoding == NULL
 		|| strcmp(outputEncoding, "UTF-8") == 0
 		|| strcmp(outputEncoding, "utf-8") == 0)
 	{
 		m_iconvDesc = (iconv_t) -1;
+	} else if (m_charsetCodec.init(outputEncoding)) {
+		// Use built-in converter for MARC character set.
+		m_iconvDesc = (iconv_t) -1;
 	} else {
 		// Create iconv descriptor for output encoding conversion.
 		m_iconvDesc = iconv_open(outputEncoding, "UTF-8");
@@ -120,17 +129,60 @@ MarcIsoWriter::open(FILE *outputFile, const char *outputEncoding)
 			}
 			return false;
 		}
+
+		// Initialize converter for single-byte encoding.
+		m_codec.init(outputEncoding);
 	}
 
+	// Check if output encoding keeps ASCII separators and identifiers.
+	m_batchConvert = m_iconvDesc != (iconv_t) -1
+		&& isAsciiCompatible(outputEncoding);
+
 	return true;
 }
 
+/*
+ * Check if encoding represents ASCII characters as is.
+ */
+bool
+MarcIsoWriter::isAsciiCompatible(const char *encoding)
+{
+	iconv_t iconvDesc = iconv_open(encoding, "UTF-8");
+	if (iconvDesc == (iconv_t) -1) {
+		return false;
+	}
+
+	// Convert sample of separators, identifiers and indicators.
+	char sample[] = "\x1E\x1F" "a01 #|";
+	char buf[32];
+#ifndef ICONV_CONST_CHAR
+	char *src = sample;
+#else
+	const char *src = sample;
+#endif
+	char *dest = buf;
+	size_t srcLen = sizeof(sample) - 1;
+	size_t destLen = sizeof(buf);
+	bool result = ::iconv(iconvDesc, &src, &srcLen, &dest, &destLen)
+		!= (size_t) -1
+		&& (size_t) (dest - buf) == sizeof(sample) - 1
+		&& memcmp(buf, sample, sizeof(sample) - 1) == 0;
+
+	// Finalize iconv.
+	iconv_close(iconvDesc);
+
+	return result;
+}
+
 /*
  * Close output file.
  */
 void
 MarcIsoWriter::close(void)
 {
+	// Write buffered data.
+	flushBuffer();
+
 	// Finalize iconv.
 	if (m_iconvDesc != (iconv_t) -1) {
 		iconv_close(m_iconvDesc);
@@ -142,6 +194,9 @@ MarcIsoWriter::close(void)
 	m_outputFile = NULL;
 	m_outputEncoding = "";
 	m_iconvDesc = (iconv_t) -1;
+	m_codec.clear();
+	m_charsetCodec.clear();
+	m_batchConvert = false;
 }
 
 /*
@@ -150,35 +205,151 @@ MarcIsoWriter::close(void)
 bool
 MarcIsoWriter::write(MarcRecord &record)
 {
-	char recordBuf[100000];
+	// Decode fields parsed in lazy mode.
+	record.decodeFields();
+
+	return writeRecord(record, record.m_fieldList.size());
+}
+
+/*
+ * Write record with contiguous storage to ISO 2709 file.
+ */
+bool
+MarcIsoWriter::write(FlatMarcRecord &record)
+{
+	// Count fields of record.
+	size_t fieldCount = 0;
+	for (FlatMarcRecord::FieldIt fieldIt = record.m_firstField;
+		fieldIt != FlatMarcRecord::NULL_HANDLE;
+		fieldIt = record.m_fieldList[fieldIt].nextField)
+	{
+		fieldCount++;
+	}
+
+	return writeRecord(record, fieldCount);
+}
+
+/*
+ * Write record of specified type to ISO 2709 file.
+ */
+template <class RecordType>
+bool
+MarcIsoWriter::writeRecord(RecordType &record, size_t fieldCount)
+{
+	char numberBuf[13];
 
-	// Copy record leader to buffer.
-	memcpy(recordBuf, (char *) &record.m_leader,
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Calculate base address of data.
+	size_t baseAddress = sizeof(MarcRecord::Leader)
+		+ fieldCount * sizeof(RecordDirectoryEntry) + 1;
+	if (baseAddress > ISO2709_MAX_RECORD_LENGTH) {
+		m_errorCode = ERROR_DATASIZE;
+		m_errorMessage = "record size exceed ISO2709 limit";
+		return false;
+	}
+
+	// Copy record leader and base address of data to record buffer.
+	m_recordBuf.resize(baseAddress);
+	memcpy(&m_recordBuf[0], (char *) &record.getLeader(),
 		sizeof(MarcRecord::Leader));
+	sprintf(numberBuf, "%05u", (unsigned int) baseAddress);
+	memcpy(&m_recordBuf[12], numberBuf, 5);
+
+	// Convert data of all fields at once, convert every control field
+	// and subfield separately if it fails.
+	bool converted = false;
+	if (m_batchConvert) {
+		appendFields(record, false);
+		converted = convertFields(baseAddress);
+		if (!converted) {
+			m_recordBuf.resize(baseAddress);
+		}
+	}
+	if (!converted && !appendFields(record, m_iconvDesc != (iconv_t) -1
+		|| m_charsetCodec.isValid()))
+	{
+		return false;
+	}
+
+	// Iterate all fields.
+	size_t directoryPos = sizeof(MarcRecord::Leader);
+	size_t fieldStartPos = baseAddress;
+	std::vector<size_t>::iterator fieldEndIt = m_fieldEndPos.begin();
+	for (std::vector<Tag>::iterator tagIt = m_fieldTags.begin();
+		tagIt != m_fieldTags.end(); tagIt++, fieldEndIt++)
+	{
+		// Check field length and starting position.
+		size_t fieldLength = *fieldEndIt - fieldStartPos;
+		size_t fieldOffset = fieldStartPos - baseAddress;
+		if (fieldLength > ISO2709_MAX_FIELD_LENGTH) {
+			m_errorCode = ERROR_DATASIZE;
+			m_errorMessage = "field size exceed ISO2709 limit";
+			return false;
+		}
+		if (fieldOffset > ISO2709_MAX_RECORD_LENGTH) {
+			m_errorCode = ERROR_DATASIZE;
+			m_errorMessage = "record size exceed ISO2709 limit";
+			return false;
+		}
+
+		// Fill directory entry.
+		sprintf(numberBuf, "%.3s%04u%05u", tagIt->c_str(),
+			(unsigned int) fieldLength, (unsigned int) fieldOffset);
+		memcpy(&m_recordBuf[directoryPos], numberBuf,
+			sizeof(RecordDirectoryEntry));
+		directoryPos += sizeof(RecordDirectoryEntry);
+		fieldStartPos = *fieldEndIt;
+	}
+
+	// Set field separator at the end of directory.
+	m_recordBuf[directoryPos] = ISO2709_FIELD_SEPARATOR;
+	// Set record separator at the end of record.
+	m_recordBuf.push_back(ISO2709_RECORD_SEPARATOR);
+
+	// Check record length and copy it to record buffer.
+	size_t recordLength = m_recordBuf.size();
+	if (recordLength > ISO2709_MAX_RECORD_LENGTH) {
+		m_errorCode = ERROR_DATASIZE;
+		m_errorMessage = "record size exceed ISO2709 limit";
+		return false;
+	}
+	sprintf(numberBuf, "%05u", (unsigned int) recordLength);
+	memcpy(&m_recordBuf[0], numberBuf, 5);
+
+	// Write record buffer to file.
+	if (!writeData(&m_recordBuf[0], recordLength)) {
+		return false;
+	}
+
+	return true;
+}
 
-	// Calculate base address of data and copy it to record buffer.
-	unsigned int baseAddress = sizeof(MarcRecord::Leader)
-		+ record.m_fieldList.size()
-		* sizeof(RecordDirectoryEntry) + 1;
-	char baseAddressBuf[6];
-	sprintf(baseAddressBuf, "%05d", baseAddress);
-	memcpy(recordBuf + 12, baseAddressBuf, 5);
+/*
+ * Append data of all fields to the record buffer.
+ */
+bool
+MarcIsoWriter::appendFields(MarcRecord &record, bool convert)
+{
+	m_fieldEndPos.clear();
+	m_fieldTags.clear();
 
 	// Iterate all fields.
-	char *directoryData = recordBuf + sizeof(MarcRecord::Leader);
-	char *fieldData = recordBuf + baseAddress;
 	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
 		fieldIt != record.m_fieldList.end(); fieldIt++)
 	{
-		int fieldLength = 0;
-		if (fieldIt->m_tag < "010") {
-			fieldLength = appendControlField(fieldData, fieldIt);
-			fieldData += fieldLength;
+		if (fieldIt->m_tag.isControlTag()) {
+			if (!appendData(fieldIt->m_data.data(),
+				fieldIt->m_data.size(), convert))
+			{
+				return false;
+			}
 		} else {
 			// Copy indicators of data field to buffer.
-			*(fieldData++) = fieldIt->m_ind1;
-			*(fieldData++) = fieldIt->m_ind2;
-			fieldLength += 2;
+			m_recordBuf.push_back(fieldIt->m_ind1);
+			m_recordBuf.push_back(fieldIt->m_ind2);
 
 			// Iterate all subfields.
 			MarcRecord::SubfieldIt subfieldIt =
@@ -186,125 +357,196 @@ MarcIsoWriter::write(MarcRecord &record)
 			for (; subfieldIt != fieldIt->m_subfieldList.end();
 				subfieldIt++)
 			{
-				int subfieldLength =
-					appendSubfield(fieldData, subfieldIt);
-				fieldData += subfieldLength;
-				fieldLength += subfieldLength;
+				m_recordBuf.push_back(
+					ISO2709_IDENTIFIER_DELIMITER);
+				m_recordBuf.push_back(subfieldIt->m_id);
+				if (!appendData(subfieldIt->m_data.data(),
+					subfieldIt->m_data.size(), convert))
+				{
+					return false;
+				}
 			}
 		}
 
 		// Set field separator at the end of field.
-		*(fieldData++) = ISO2709_FIELD_SEPARATOR;
-		fieldLength++;
-
-		/*
-		 * Fill directory entry (it is safe to do this way because
-		 * null character will be overwritten in next iteration and
-		 * right after the cycle).
-		 */
-		int fieldOffset = (int) (fieldData - recordBuf) - baseAddress
-			- fieldLength;
-		sprintf(directoryData, "%.3s%04d%05d",
-			fieldIt->m_tag.c_str(), fieldLength, fieldOffset);
-		directoryData += sizeof(RecordDirectoryEntry);
+		m_recordBuf.push_back(ISO2709_FIELD_SEPARATOR);
+		m_fieldEndPos.push_back(m_recordBuf.size());
+		m_fieldTags.push_back(fieldIt->m_tag);
 	}
 
-	// Set field separator at the end of directory.
-	directoryData[0] = ISO2709_FIELD_SEPARATOR;
-	// Set record separator at the end of record.
-	*(fieldData++) = ISO2709_RECORD_SEPARATOR;
+	return true;
+}
 
-	// Calculate directory length and copy it to record buffer.
-	int recordLength = (int) (fieldData - recordBuf);
-	char recordLengthBuf[6];
-	sprintf(recordLengthBuf, "%05d", recordLength);
-	memcpy(recordBuf, recordLengthBuf, 5);
+bool
+MarcIsoWriter::appendFields(FlatMarcRecord &record, bool convert)
+{
+	m_fieldEndPos.clear();
+	m_fieldTags.clear();
 
-	// Write record buffer to file.
-	if (fwrite(recordBuf, recordLength, 1, m_outputFile) != 1) {
-		m_errorCode = ERROR_IO;
-		m_errorMessage = "i/o operation failed";
-		return false;
+	// Iterate all fields.
+	const char *data = record.m_data.data();
+	for (FlatMarcRecord::FieldIt fieldIt = record.m_firstField;
+		fieldIt != FlatMarcRecord::NULL_HANDLE;
+		fieldIt = record.m_fieldList[fieldIt].nextField)
+	{
+		FlatMarcRecord::FieldEntry &field =
+			record.m_fieldList[fieldIt];
+		if (field.tag.isControlTag()) {
+			if (!appendData(data + field.dataPos, field.dataLen,
+				convert))
+			{
+				return false;
+			}
+		} else {
+			// Copy indicators of data field to buffer.
+			m_recordBuf.push_back(field.ind1);
+			m_recordBuf.push_back(field.ind2);
+
+			// Iterate all subfields.
+			FlatMarcRecord::SubfieldIt subfieldIt =
+				field.firstSubfield;
+			while (subfieldIt != FlatMarcRecord::NULL_HANDLE) {
+				FlatMarcRecord::SubfieldEntry &subfield =
+					record.m_subfieldList[subfieldIt];
+				m_recordBuf.push_back(
+					ISO2709_IDENTIFIER_DELIMITER);
+				m_recordBuf.push_back(subfield.id);
+				if (!appendData(data + subfield.dataPos,
+					subfield.dataLen, convert))
+				{
+					return false;
+				}
+				subfieldIt = subfield.nextSubfield;
+			}
+		}
+
+		// Set field separator at the end of field.
+		m_recordBuf.push_back(ISO2709_FIELD_SEPARATOR);
+		m_fieldEndPos.push_back(m_recordBuf.size());
+		m_fieldTags.push_back(field.tag);
 	}
 
 	return true;
 }
 
 /*
- * Append control field data to the write buffer.
+ * Convert data of all fields in record buffer to output encoding.
  */
-int
-MarcIsoWriter::appendControlField(char *fieldData,
-	MarcRecord::FieldIt &fieldIt)
+bool
+MarcIsoWriter::convertFields(size_t baseAddress)
 {
-	int fieldLength;
+	// Check that field separators appear only at the end of fields.
+	if ((size_t) std::count(m_recordBuf.begin() + baseAddress,
+		m_recordBuf.end(), ISO2709_FIELD_SEPARATOR)
+		!= m_fieldEndPos.size())
+	{
+		return false;
+	}
 
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Copy control field to buffer.
-		fieldLength = fieldIt->m_data.size();
-		if (fieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
-		}
-		memcpy(fieldData, fieldIt->m_data.c_str(), fieldLength);
+	// Convert field data with separators in one pass.
+	const char *data = &m_recordBuf[0] + baseAddress;
+	size_t dataLen = m_recordBuf.size() - baseAddress;
+	if (m_codec.encode(data, dataLen, m_iconvBuf)) {
+		data = m_iconvBuf.data();
+		dataLen = m_iconvBuf.size();
 	} else {
-		// Copy control field to buffer with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, fieldIt->m_data, iconvBuf)) {
-			m_errorCode = ERROR_ICONV;
-			m_errorMessage = "encoding conversion failed";
+		if (!convertData(baseAddress)) {
 			return false;
 		}
-		fieldLength = iconvBuf.size();
-		if (fieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
+		data = &m_convertBuf[0];
+		dataLen = m_convertLen;
+	}
+
+	// Find ends of fields in converted data.
+	std::vector<size_t>::iterator fieldEndIt = m_fieldEndPos.begin();
+	for (size_t pos = 0; pos < dataLen; pos++) {
+		if (data[pos] == ISO2709_FIELD_SEPARATOR) {
+			if (fieldEndIt == m_fieldEndPos.end()) {
+				return false;
+			}
+			*fieldEndIt++ = baseAddress + pos + 1;
 		}
-		memcpy(fieldData, iconvBuf.c_str(), fieldLength);
 	}
+	if (fieldEndIt != m_fieldEndPos.end()) {
+		return false;
+	}
+
+	// Replace field data with converted data.
+	m_recordBuf.resize(baseAddress);
+	m_recordBuf.insert(m_recordBuf.end(), data, data + dataLen);
 
-	return fieldLength;
+	return true;
 }
 
 /*
- * Append subfield data to the write buffer.
+ * Convert data of fields in record buffer with iconv.
  */
-int
-MarcIsoWriter::appendSubfield(char *fieldData,
-	MarcRecord::SubfieldIt &subfieldIt)
+bool
+MarcIsoWriter::convertData(size_t baseAddress)
 {
-	int subfieldLength;
-
-	*(fieldData) = ISO2709_IDENTIFIER_DELIMITER;
-	*(fieldData + 1) = subfieldIt->m_id;
-	if (m_iconvDesc == (iconv_t) -1) {
-		// Copy subfield to buffer.
-		subfieldLength = subfieldIt->m_data.size();
-		if (subfieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
+	size_t srcLen = m_recordBuf.size() - baseAddress;
+	if (m_convertBuf.size() < srcLen * 2 + 16) {
+		m_convertBuf.resize(srcLen * 2 + 16);
+	}
+#ifndef ICONV_CONST_CHAR
+	char *src = &m_recordBuf[0] + baseAddress;
+#else
+	const char *src = &m_recordBuf[0] + baseAddress;
+#endif
+	m_convertLen = 0;
+	while (srcLen > 0) {
+		char *dest = &m_convertBuf[m_convertLen];
+		size_t destLen = m_convertBuf.size() - m_convertLen;
+		size_t result = ::iconv(m_iconvDesc, &src, &srcLen,
+			&dest, &destLen);
+		m_convertLen = m_convertBuf.size() - destLen;
+		if (result == (size_t) -1) {
+			if (errno != E2BIG) {
+				// Reset conversion state.
+				::iconv(m_iconvDesc, NULL, NULL, NULL, NULL);
+				return false;
+			}
+			m_convertBuf.resize(m_convertBuf.size() * 2);
 		}
-		memcpy(fieldData + 2, subfieldIt->m_data.c_str(),
-			subfieldLength);
+	}
+
+	return true;
+}
+
+/*
+ * Append control field or subfield data to the record buffer.
+ */
+bool
+MarcIsoWriter::appendData(const char *data, size_t dataLen, bool convert)
+{
+	if (!convert) {
+		// Copy data to buffer.
+		m_recordBuf.insert(m_recordBuf.end(), data, data + dataLen);
 	} else {
-		// Copy subfield to buffer with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, subfieldIt->m_data, iconvBuf)) {
+		// Copy data to buffer with encoding conversion.
+		if (!encodeData(data, dataLen)) {
 			m_errorCode = ERROR_ICONV;
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		subfieldLength = iconvBuf.size();
-		if (subfieldLength > 10000) {
-			m_errorCode = ERROR_DATASIZE;
-			m_errorMessage = "field size exceed ISO2709 limit";
-			return false;
-		}
-		memcpy(fieldData + 2, iconvBuf.c_str(), subfieldLength);
+		m_recordBuf.insert(m_recordBuf.end(), m_iconvBuf.begin(),
+			m_iconvBuf.end());
+	}
+
+	return true;
+}
+
+/*
+ * Convert data from UTF-8 to output encoding into conversion buffer.
+ */
+bool
+MarcIsoWriter::encodeData(const char *data, size_t dataLen)
+{
+	// Convert data with built-in converters, use iconv if they fail.
+	if (m_charsetCodec.isValid()) {
+		return m_charsetCodec.encode(data, dataLen, m_iconvBuf);
 	}
 
-	return subfieldLength + 2;
+	return m_codec.encode(data, dataLen, m_iconvBuf)
+		|| iconv(m_iconvDesc, data, dataLen, m_iconvBuf);
 }
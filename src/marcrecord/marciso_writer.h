@@ -31,8 +31,12 @@
 
 #include <iconv.h>
 #include <string>
+#include <vector>
+#include "flat_marcrecord.h"
 #include "marc_writer.h"
 #include "marcrecord.h"
+#include "marcrecord_charset.h"
+#include "marcrecord_codec.h"
 
 namespace marcrecord {
 
@@ -43,13 +47,43 @@ class MarcIsoWriter : public MarcWriter {
 protected:
 	// Iconv descriptor for output encoding.
 	iconv_t m_iconvDesc;
+	// Flag of conversion of all fields of record at once.
+	bool m_batchConvert;
+	// Converter for single-byte output encoding.
+	SingleByteCodec m_codec;
+	// Converter for MARC character set of output.
+	MarcCharsetCodec m_charsetCodec;
+
+	// Record buffer.
+	std::vector<char> m_recordBuf;
+	// Buffer of encoding conversion.
+	std::string m_iconvBuf;
+	// Buffer of record data in output encoding.
+	std::vector<char> m_convertBuf;
+	// Length of data in buffer of record data in output encoding.
+	size_t m_convertLen;
+	// End positions of fields in record buffer.
+	std::vector<size_t> m_fieldEndPos;
+	// Tags of fields in record buffer.
+	std::vector<Tag> m_fieldTags;
 
 private:
-	// Append control field data to the write buffer.
-	int appendControlField(char *fieldData, MarcRecord::FieldIt &fieldIt);
-	// Append subfield data to the write buffer.
-	int appendSubfield(char *fieldData,
-		MarcRecord::SubfieldIt &subfieldIt);
+	// Check if encoding represents ASCII characters as is.
+	static bool isAsciiCompatible(const char *encoding);
+	// Write record of specified type to output file.
+	template <class RecordType>
+	bool writeRecord(RecordType &record, size_t fieldCount);
+	// Append data of all fields to the record buffer.
+	bool appendFields(MarcRecord &record, bool convert);
+	bool appendFields(FlatMarcRecord &record, bool convert);
+	// Append control field or subfield data to the record buffer.
+	bool appendData(const char *data, size_t dataLen, bool convert);
+	// Convert data of all fields in record buffer to output encoding.
+	bool convertFields(size_t baseAddress);
+	// Convert data of fields in record buffer with iconv.
+	bool convertData(size_t baseAddress);
+	// Convert data from UTF-8 to output encoding into conversion buffer.
+	bool encodeData(const char *data, size_t dataLen);
 
 public:
 	// Constructor.
@@ -64,6 +98,7 @@ public:
 	void close(void);
 	// Write record to output file.
 	bool write(MarcRecord &record);
+	bool write(FlatMarcRecord &record);
 };
 
 } // namespace marcrecord
@@ -26,10 +26,12 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include "marciso_reader.h"
 #include "marcrecord.h"
 #include "marcrecord_tools.h"
 
@@ -41,15 +43,28 @@ using namespace marcrecord;
 MarcRecord::MarcRecord()
 {
 	m_formatVariant = UNIMARC;
+	m_tagIndexMode = false;
 	clear();
 }
 
 MarcRecord::MarcRecord(FormatVariant formatVariant)
 {
 	setFormatVariant(formatVariant);
+	m_tagIndexMode = false;
 	clear();
 }
 
+MarcRecord::MarcRecord(const MarcRecord &record)
+	: m_formatVariant(record.m_formatVariant), m_leader(record.m_leader),
+	m_fieldList(record.m_fieldList), m_rawData(record.m_rawData),
+	m_lazyReader(record.m_lazyReader),
+	m_lazyOpenCount(record.m_lazyOpenCount),
+	m_lazyAutoCorrection(record.m_lazyAutoCorrection),
+	m_decodeErrorMessage(record.m_decodeErrorMessage),
+	m_tagIndexMode(record.m_tagIndexMode), m_tagIndexValid(false)
+{
+}
+
 /*
  * Destructor.
  */
@@ -57,14 +72,52 @@ MarcRecord::~MarcRecord()
 {
 }
 
+/*
+ * Assignment operator.
+ */
+MarcRecord &
+MarcRecord::operator=(const MarcRecord &record)
+{
+	if (this != &record) {
+		m_formatVariant = record.m_formatVariant;
+		m_leader = record.m_leader;
+		m_rawData = record.m_rawData;
+		m_lazyReader = record.m_lazyReader;
+		m_lazyOpenCount = record.m_lazyOpenCount;
+		m_lazyAutoCorrection = record.m_lazyAutoCorrection;
+		m_decodeErrorMessage = record.m_decodeErrorMessage;
+		m_tagIndexMode = record.m_tagIndexMode;
+		m_tagIndexValid = false;
+
+		// Copy fields reusing removed fields.
+		m_spareFieldList.splice(m_spareFieldList.end(), m_fieldList);
+		for (FieldList::const_iterator fieldIt =
+			record.m_fieldList.begin();
+			fieldIt != record.m_fieldList.end(); fieldIt++)
+		{
+			*allocField(m_fieldList.end()) = *fieldIt;
+		}
+	}
+
+	return *this;
+}
+
 /*
  * Clear record.
  */
 void
 MarcRecord::clear(void)
 {
-	// Clear field list.
-	m_fieldList.clear();
+	// Keep fields for reuse by following additions.
+	m_spareFieldList.splice(m_spareFieldList.end(), m_fieldList);
+
+	// Drop undecoded record data keeping its storage.
+	m_rawData.clear();
+	m_lazyReader = NULL;
+	m_lazyOpenCount = 0;
+	m_lazyAutoCorrection = false;
+	m_decodeErrorMessage.erase();
+	m_tagIndexValid = false;
 
 	// Reset record leader.
 	memset(m_leader.recordLength, ' ', sizeof(m_leader.recordLength));
@@ -85,6 +138,47 @@ MarcRecord::clear(void)
 	m_leader.undefined3 = ' ';
 }
 
+/*
+ * Swap content of records.
+ */
+void
+MarcRecord::swap(MarcRecord &record)
+{
+	std::swap(m_formatVariant, record.m_formatVariant);
+	std::swap(m_leader, record.m_leader);
+	m_fieldList.swap(record.m_fieldList);
+	m_spareFieldList.swap(record.m_spareFieldList);
+	m_rawData.swap(record.m_rawData);
+	std::swap(m_lazyReader, record.m_lazyReader);
+	std::swap(m_lazyOpenCount, record.m_lazyOpenCount);
+	std::swap(m_lazyAutoCorrection, record.m_lazyAutoCorrection);
+	m_decodeErrorMessage.swap(record.m_decodeErrorMessage);
+	std::swap(m_tagIndexMode, record.m_tagIndexMode);
+	std::swap(m_tagIndexValid, record.m_tagIndexValid);
+	m_tagIndex.swap(record.m_tagIndex);
+	m_tagIndexPos.swap(record.m_tagIndexPos);
+}
+
+/*
+ * Reset record and take leader and fields of parsed record.
+ */
+void
+MarcRecord::takeFields(MarcRecord &record)
+{
+	// Drop undecoded record data keeping its storage.
+	m_rawData.clear();
+	m_lazyReader = NULL;
+	m_lazyOpenCount = 0;
+	m_lazyAutoCorrection = false;
+	m_decodeErrorMessage.erase();
+	m_tagIndexValid = false;
+
+	// Take leader and fields (old fields are left to parsed record
+	// for reuse).
+	m_leader = record.m_leader;
+	m_fieldList.swap(record.m_fieldList);
+}
+
 /*
  * Get record format variant.
  */
@@ -128,6 +222,25 @@ MarcRecord::setLeader(const std::string &leaderData)
 		std::min(sizeof(Leader), leaderData.size()));
 }
 
+/*
+ * Set tag index mode.
+ */
+void
+MarcRecord::setTagIndexMode(bool tagIndexMode)
+{
+	m_tagIndexMode = tagIndexMode;
+	m_tagIndexValid = false;
+}
+
+/*
+ * Get message of error of decoding fields parsed in lazy mode.
+ */
+std::string &
+MarcRecord::getDecodeErrorMessage(void)
+{
+	return m_decodeErrorMessage;
+}
+
 /*
  * Get list of fields.
  */
@@ -137,11 +250,22 @@ MarcRecord::getFields(const std::string &fieldTag)
 	FieldRefList resultFieldList;
 	FieldIt fieldIt;
 
+	// Get fields from tag index.
+	unsigned int startPos, endPos;
+	if (findTagIndex(fieldTag, startPos, endPos)) {
+		for (; startPos < endPos; startPos++) {
+			decodeField(m_tagIndex[startPos]);
+			resultFieldList.push_back(m_tagIndex[startPos]);
+		}
+		return resultFieldList;
+	}
+
 	// Check fields in list.
 	for (fieldIt = m_fieldList.begin(); fieldIt != m_fieldList.end();
 		fieldIt++)
 	{
-		if (fieldTag == "" || fieldTag == fieldIt->m_tag) {
+		if (fieldTag == "" || fieldIt->m_tag == fieldTag) {
+			decodeField(fieldIt);
 			resultFieldList.push_back(fieldIt);
 		}
 	}
@@ -157,11 +281,43 @@ MarcRecord::getField(const std::string &fieldTag)
 {
 	FieldIt fieldIt;
 
+	// Get field from tag index.
+	unsigned int startPos, endPos;
+	if (findTagIndex(fieldTag, startPos, endPos)) {
+		if (startPos == endPos) {
+			return m_fieldList.end();
+		}
+		decodeField(m_tagIndex[startPos]);
+		return m_tagIndex[startPos];
+	}
+
 	// Check fields in list.
 	for (fieldIt = m_fieldList.begin(); fieldIt != m_fieldList.end();
 		fieldIt++)
 	{
-		if (fieldTag == "" || fieldTag == fieldIt->m_tag) {
+		if (fieldTag == "" || fieldIt->m_tag == fieldTag) {
+			decodeField(fieldIt);
+			return fieldIt;
+		}
+	}
+
+	return m_fieldList.end();
+}
+
+/*
+ * Get next field with specified tag after specified field.
+ */
+MarcRecord::FieldIt
+MarcRecord::nextField(FieldIt fieldIt, const std::string &fieldTag)
+{
+	if (fieldIt == m_fieldList.end()) {
+		return fieldIt;
+	}
+
+	// Check following fields in list.
+	for (fieldIt++; fieldIt != m_fieldList.end(); fieldIt++) {
+		if (fieldTag == "" || fieldIt->m_tag == fieldTag) {
+			decodeField(fieldIt);
 			return fieldIt;
 		}
 	}
@@ -176,27 +332,33 @@ MarcRecord::FieldIt
 MarcRecord::addField(const Field &field)
 {
 	// Append field to the list.
-	FieldIt fieldIt = m_fieldList.insert(m_fieldList.end(), field);
+	FieldIt fieldIt = allocField(m_fieldList.end());
+	*fieldIt = field;
+	dropLazyField(fieldIt);
 	return fieldIt;
 }
 
 MarcRecord::FieldIt
-MarcRecord::addControlField(const std::string &fieldTag,
+MarcRecord::addControlField(const Tag &fieldTag,
 	const std::string &fieldData)
 {
 	// Append field to the list.
-	FieldIt fieldIt = m_fieldList.insert(m_fieldList.end(),
-		Field(fieldTag, fieldData));
+	FieldIt fieldIt = allocField(m_fieldList.end());
+	fieldIt->m_tag = fieldTag;
+	fieldIt->m_data = fieldData;
 	return fieldIt;
 }
 
 MarcRecord::FieldIt
-MarcRecord::addDataField(const std::string &fieldTag,
+MarcRecord::addDataField(const Tag &fieldTag,
 	char fieldInd1, char fieldInd2)
 {
 	// Append field to the list.
-	FieldIt fieldIt = m_fieldList.insert(m_fieldList.end(),
-		Field(fieldTag, fieldInd1, fieldInd2));
+	FieldIt fieldIt = allocField(m_fieldList.end());
+	fieldIt->m_type = Field::DATAFIELD;
+	fieldIt->m_tag = fieldTag;
+	fieldIt->m_ind1 = fieldInd1;
+	fieldIt->m_ind2 = fieldInd2;
 	return fieldIt;
 }
 
@@ -207,27 +369,33 @@ MarcRecord::FieldIt
 MarcRecord::addFieldBefore(FieldIt nextFieldIt, const Field &field)
 {
 	// Append field to the list.
-	FieldIt fieldIt = m_fieldList.insert(nextFieldIt, field);
+	FieldIt fieldIt = allocField(nextFieldIt);
+	*fieldIt = field;
+	dropLazyField(fieldIt);
 	return fieldIt;
 }
 
 MarcRecord::FieldIt
 MarcRecord::addControlFieldBefore(FieldIt nextFieldIt,
-	const std::string &fieldTag, const std::string &fieldData)
+	const Tag &fieldTag, const std::string &fieldData)
 {
 	// Append field to the list.
-	FieldIt fieldIt = m_fieldList.insert(nextFieldIt,
-		Field(fieldTag, fieldData));
+	FieldIt fieldIt = allocField(nextFieldIt);
+	fieldIt->m_tag = fieldTag;
+	fieldIt->m_data = fieldData;
 	return fieldIt;
 }
 
 MarcRecord::FieldIt
 MarcRecord::addDataFieldBefore(FieldIt nextFieldIt,
-	const std::string &fieldTag, char fieldInd1, char fieldInd2)
+	const Tag &fieldTag, char fieldInd1, char fieldInd2)
 {
 	// Append field to the list.
-	FieldIt fieldIt = m_fieldList.insert(nextFieldIt,
-		Field(fieldTag, fieldInd1, fieldInd2));
+	FieldIt fieldIt = allocField(nextFieldIt);
+	fieldIt->m_type = Field::DATAFIELD;
+	fieldIt->m_tag = fieldTag;
+	fieldIt->m_ind1 = fieldInd1;
+	fieldIt->m_ind2 = fieldInd2;
 	return fieldIt;
 }
 
@@ -237,8 +405,9 @@ MarcRecord::addDataFieldBefore(FieldIt nextFieldIt,
 void
 MarcRecord::removeField(FieldIt fieldIt)
 {
-	// Remove field from the list.
-	m_fieldList.erase(fieldIt);
+	// Move field to the list of removed fields.
+	m_spareFieldList.splice(m_spareFieldList.end(), m_fieldList, fieldIt);
+	m_tagIndexValid = false;
 }
 
 /*
@@ -253,6 +422,7 @@ MarcRecord::toString(void)
 	textRecord += "]";
 
 	// Iterate all fields.
+	decodeFields();
 	for (MarcRecord::FieldIt fieldIt = m_fieldList.begin();
 		fieldIt != m_fieldList.end(); fieldIt++)
 	{
@@ -262,3 +432,134 @@ MarcRecord::toString(void)
 
 	return textRecord;
 }
+
+/*
+ * Insert field before specified field reusing removed field.
+ */
+MarcRecord::FieldIt
+MarcRecord::allocField(FieldIt nextFieldIt)
+{
+	m_tagIndexValid = false;
+	if (m_spareFieldList.empty()) {
+		return m_fieldList.insert(nextFieldIt, Field());
+	}
+
+	// Move removed field to the list and clear it keeping its storage.
+	FieldIt fieldIt = m_spareFieldList.begin();
+	m_fieldList.splice(nextFieldIt, m_spareFieldList, fieldIt);
+	fieldIt->clear();
+
+	return fieldIt;
+}
+
+/*
+ * Decode contents of field parsed in lazy mode.
+ */
+void
+MarcRecord::decodeField(FieldIt fieldIt)
+{
+	if (fieldIt->m_lazy && m_lazyReader != NULL) {
+		m_lazyReader->decodeField(*this, fieldIt);
+	}
+}
+
+/*
+ * Clear state of undecoded field added from other record.
+ */
+void
+MarcRecord::dropLazyField(FieldIt fieldIt)
+{
+	if (!fieldIt->m_lazy) {
+		return;
+	}
+
+	// Contents of field are in data of other record, field is left empty.
+	fieldIt->m_lazy = false;
+	fieldIt->m_rawPos = 0;
+	fieldIt->m_rawLength = 0;
+	if (m_decodeErrorMessage.empty()) {
+		m_decodeErrorMessage =
+			"field parsed in lazy mode is added undecoded";
+	}
+}
+
+/*
+ * Decode contents of all fields parsed in lazy mode.
+ */
+void
+MarcRecord::decodeFields(void)
+{
+	if (m_lazyReader == NULL) {
+		return;
+	}
+
+	for (FieldIt fieldIt = m_fieldList.begin();
+		fieldIt != m_fieldList.end(); fieldIt++)
+	{
+		decodeField(fieldIt);
+	}
+}
+
+/*
+ * Build index of fields by numeric tag.
+ */
+void
+MarcRecord::buildTagIndex(void)
+{
+	unsigned int tagNo;
+
+	// Count fields with each tag.
+	m_tagIndexPos.assign(1002, 0);
+	for (FieldIt fieldIt = m_fieldList.begin();
+		fieldIt != m_fieldList.end(); fieldIt++)
+	{
+		if (decode_number(fieldIt->m_tag.c_str(), 3, tagNo))
+		{
+			m_tagIndexPos[tagNo + 2]++;
+		}
+	}
+
+	// Calculate starting positions of tags.
+	for (tagNo = 2; tagNo < 1002; tagNo++) {
+		m_tagIndexPos[tagNo] += m_tagIndexPos[tagNo - 1];
+	}
+
+	// Place fields to index keeping their order in record.
+	m_tagIndex.resize(m_tagIndexPos[1001]);
+	for (FieldIt fieldIt = m_fieldList.begin();
+		fieldIt != m_fieldList.end(); fieldIt++)
+	{
+		if (decode_number(fieldIt->m_tag.c_str(), 3, tagNo))
+		{
+			m_tagIndex[m_tagIndexPos[tagNo + 1]++] = fieldIt;
+		}
+	}
+
+	m_tagIndexValid = true;
+}
+
+/*
+ * Find range of fields with specified tag in tag index.
+ */
+bool
+MarcRecord::findTagIndex(const std::string &fieldTag, unsigned int &startPos,
+	unsigned int &endPos)
+{
+	unsigned int tagNo;
+
+	// Check that tag index can be used for tag.
+	if (!m_tagIndexMode || fieldTag.size() != 3
+		|| !decode_number(fieldTag.data(), 3, tagNo))
+	{
+		return false;
+	}
+
+	if (!m_tagIndexValid) {
+		buildTagIndex();
+	}
+
+	startPos = m_tagIndexPos[tagNo];
+	endPos = m_tagIndexPos[tagNo + 1];
+
+	return true;
+}
@@ -29,12 +29,91 @@
 #ifndef MARCRECORD_MARCRECORD_H
 #define MARCRECORD_MARCRECORD_H
 
+#include <cstring>
 #include <list>
 #include <string>
 #include <vector>
 
 namespace marcrecord {
 
+class MarcIsoReader;
+
+/*
+ * MARC field tag.
+ */
+class Tag {
+private:
+	// Tag characters padded by zeros (up to 3 characters).
+	char m_data[4];
+
+public:
+	// Constructors.
+	Tag();
+	Tag(const char *tag);
+	Tag(const char *tag, size_t tagLen);
+	Tag(const std::string &tag);
+
+	// Set tag (characters after third one are dropped).
+	void assign(const char *tag, size_t tagLen);
+	// Clear tag.
+	void clear(void);
+
+	// Get length of tag.
+	size_t size(void) const;
+	// Check that tag is empty.
+	bool empty(void) const;
+	// Get tag as std::string.
+	std::string str(void) const;
+
+	// Get tag as null-terminated string.
+	inline const char * c_str(void) const
+	{
+		return m_data;
+	}
+
+	// Return true if tag belongs to control field.
+	inline bool isControlTag(void) const
+	{
+		return memcmp(m_data, "010", 3) < 0;
+	}
+
+	// Comparison operators.
+	inline bool operator==(const Tag &tag) const
+	{
+		return memcmp(m_data, tag.m_data, sizeof(m_data)) == 0;
+	}
+
+	inline bool operator!=(const Tag &tag) const
+	{
+		return memcmp(m_data, tag.m_data, sizeof(m_data)) != 0;
+	}
+
+	inline bool operator<(const Tag &tag) const
+	{
+		return memcmp(m_data, tag.m_data, sizeof(m_data)) < 0;
+	}
+
+	inline bool operator==(const char *tag) const
+	{
+		return strcmp(m_data, tag) == 0;
+	}
+
+	inline bool operator!=(const char *tag) const
+	{
+		return strcmp(m_data, tag) != 0;
+	}
+
+	inline bool operator==(const std::string &tag) const
+	{
+		return strcmp(m_data, tag.c_str()) == 0;
+	}
+
+	inline bool operator!=(const std::string &tag) const
+	{
+		return !(*this == tag);
+	}
+};
+
 /*
  * MARC record class.
  */
@@ -106,14 +185,20 @@ public:
 	friend class MarcWriter;
 	// ISO 2709 reader class.
 	friend class MarcIsoReader;
+	// Parallel ISO 2709 reader class.
+	friend class MarcIsoParallelReader;
 	// ISO 2709 writer class.
 	friend class MarcIsoWriter;
 	// MARCXML reader class.
 	friend class MarcXmlReader;
+	// Parallel MARCXML reader class.
+	friend class MarcXmlParallelReader;
 	// MARCXML writer class.
 	friend class MarcXmlWriter;
 	// UNIMARCXML writer class.
 	friend class UnimarcXmlWriter;
+	// MARC record with contiguous storage.
+	friend class FlatMarcRecord;
 
 	// List of fields.
 	typedef std::list<Field> FieldList;
@@ -141,15 +226,64 @@ private:
 	Leader m_leader;
 	// List of fields.
 	FieldList m_fieldList;
+	// List of removed fields kept for reuse.
+	FieldList m_spareFieldList;
+
+	// Copy of ISO 2709 record data with undecoded field contents.
+	std::vector<char> m_rawData;
+	// Reader decoding field contents on first access.
+	MarcIsoReader *m_lazyReader;
+	// Open count and auto-correction mode of reader at parse time.
+	unsigned int m_lazyOpenCount;
+	bool m_lazyAutoCorrection;
+	// Message of first error of decoding field contents.
+	std::string m_decodeErrorMessage;
+
+	// Tag index mode flag.
+	bool m_tagIndexMode;
+	// Tag index is up to date.
+	bool m_tagIndexValid;
+	// Fields with numeric tags ordered by tag.
+	std::vector<FieldIt> m_tagIndex;
+	// Positions of fields with each numeric tag in tag index.
+	std::vector<unsigned int> m_tagIndexPos;
+
+	// Insert field before specified field reusing removed field.
+	FieldIt allocField(FieldIt nextFieldIt);
+	// Reset record and take leader and fields of parsed record.
+	void takeFields(MarcRecord &record);
+	// Decode contents of field parsed in lazy mode.
+	void decodeField(FieldIt fieldIt);
+	// Decode contents of all fields parsed in lazy mode.
+	void decodeFields(void);
+	// Clear state of undecoded field added from other record.
+	void dropLazyField(FieldIt fieldIt);
+	// Build index of fields by numeric tag.
+	void buildTagIndex(void);
+	// Find range of fields with specified tag in tag index.
+	bool findTagIndex(const std::string &fieldTag, unsigned int &startPos,
+		unsigned int &endPos);
 
 public:
 	// Constructors and destructor.
 	MarcRecord();
 	MarcRecord(FormatVariant formatVariant);
+	MarcRecord(const MarcRecord &record);
 	~MarcRecord();
 
+	// Assignment operator.
+	MarcRecord & operator=(const MarcRecord &record);
+
+#if __cplusplus >= 201103L
+	// Move constructor and assignment operator.
+	MarcRecord(MarcRecord &&record);
+	MarcRecord & operator=(MarcRecord &&record);
+#endif
+
 	// Clear record.
 	void clear(void);
+	// Swap content of records.
+	void swap(MarcRecord &record);
 
 	// Get record format variant.
 	FormatVariant getFormatVariant(void);
@@ -162,28 +296,44 @@ public:
 	void setLeader(const Leader &leader);
 	void setLeader(const std::string &leaderData = "");
 
+	// Set tag index mode (fields are looked up by tag using index,
+	// tags must be changed by removing and adding fields).
+	void setTagIndexMode(bool tagIndexMode = true);
+
+	// Get message of error of decoding fields parsed in lazy mode
+	// (empty if all accessed fields are decoded).
+	std::string & getDecodeErrorMessage(void);
+
 	// Get list of fields.
 	FieldRefList getFields(const std::string &fieldTag = "");
 	// Get field.
 	FieldIt getField(const std::string &fieldTag);
+	// Get next field with specified tag after specified field.
+	FieldIt nextField(FieldIt fieldIt, const std::string &fieldTag = "");
 
 	// Add field to the end of record.
 	FieldIt addField(const Field &field);
-	FieldIt addControlField(const std::string &fieldTag = "",
+	FieldIt addControlField(const Tag &fieldTag = Tag(),
 		const std::string &fieldData = "");
-	FieldIt addDataField(const std::string &fieldTag = "",
+	FieldIt addDataField(const Tag &fieldTag = Tag(),
 		char fieldInd1 = ' ', char fieldInd2 = ' ');
 	// Add field to the record before specified field.
 	FieldIt addFieldBefore(FieldIt nextFieldIt, const Field &field);
 	FieldIt addControlFieldBefore(FieldIt nextFieldIt,
-		const std::string &fieldTag = "",
+		const Tag &fieldTag = Tag(),
 		const std::string &fieldData = "");
 	FieldIt addDataFieldBefore(FieldIt nextFieldIt,
-		const std::string &fieldTag = "",
+		const Tag &fieldTag = Tag(),
 		char fieldInd1 = ' ', char fieldInd2 = ' ');
 	// Remove field from the record.
 	void removeField(FieldIt fieldIt);
 
+#if __cplusplus >= 201103L
+	// Add field moving its content.
+	FieldIt addField(Field &&field);
+	FieldIt addFieldBefore(FieldIt nextFieldIt, Field &&field);
+#endif
+
 	// Format record to string for printing.
 	std::string toString(void);
 
@@ -210,7 +360,7 @@ public:
 	enum Type m_type;
 
 	// Field tag.
-	std::string m_tag;
+	Tag m_tag;
 	// Indicator 1.
 	char m_ind1;
 	// Indicator 2.
@@ -220,13 +370,44 @@ public:
 	// List of regular subfields.
 	SubfieldList m_subfieldList;
 
+private:
+	// MARC record class.
+	friend class MarcRecord;
+	// ISO 2709 reader class.
+	friend class MarcIsoReader;
+
+	// List of removed subfields kept for reuse.
+	SubfieldList m_spareSubfieldList;
+
+	// Field contents are not decoded yet.
+	bool m_lazy;
+	// Position of undecoded field contents in record data.
+	unsigned int m_rawPos;
+	// Length of undecoded field contents.
+	unsigned int m_rawLength;
+
+	// Insert subfield before specified subfield reusing removed subfield.
+	SubfieldIt allocSubfield(SubfieldIt nextSubfieldIt);
+
 public:
 	// Constructors.
-	Field(const std::string &tag = "", const std::string &data = "");
-	Field(const std::string &tag, char ind1, char ind2);
+	Field(const Tag &tag = Tag(), const std::string &data = "");
+	Field(const Tag &tag, char ind1, char ind2);
+	Field(const Field &field);
+
+	// Assignment operator.
+	Field & operator=(const Field &field);
+
+#if __cplusplus >= 201103L
+	// Move constructor and assignment operator.
+	Field(Field &&field);
+	Field & operator=(Field &&field);
+#endif
 
 	// Clear field data.
 	void clear();
+	// Swap content of fields.
+	void swap(Field &field);
 
 	// Set type of field to controlfield.
 	void setControlFieldType(void);
@@ -239,9 +420,9 @@ public:
 	bool isDataField(void);
 
 	// Get tag of field.
-	std::string & getTag(void);
+	std::string getTag(void);
 	// Set tag of field.
-	void setTag(const std::string &data);
+	void setTag(const Tag &tag);
 
 	// Get indicator 1 of data field.
 	char & getInd1(void);
@@ -261,11 +442,19 @@ public:
 	SubfieldRefList getSubfields(char subfieldId = ' ');
 	// Get subfield.
 	SubfieldIt getSubfield(char subfieldId);
+	// Get next subfield with specified identifier after specified subfield.
+	SubfieldIt nextSubfield(SubfieldIt subfieldIt, char subfieldId = ' ');
 
 	// Get list of embedded fields.
 	EmbeddedFieldList getEmbeddedFields(const std::string &fieldTag = "");
 	// Get embedded field.
 	SubfieldRefList getEmbeddedField(const std::string &fieldTag);
+	// Get first subfield of embedded field (subfields of embedded field
+	// follow it until next embedded field).
+	SubfieldIt firstEmbeddedField(const std::string &fieldTag = "");
+	// Get first subfield of next embedded field after specified subfield.
+	SubfieldIt nextEmbeddedField(SubfieldIt subfieldIt,
+		const std::string &fieldTag = "");
 
 	// Add subfield to the end of field.
 	SubfieldIt addSubfield(const Subfield &subfield);
@@ -279,6 +468,13 @@ public:
 	// Remove subfield from the field.
 	void removeSubfield(SubfieldIt subfieldIt);
 
+#if __cplusplus >= 201103L
+	// Add subfield moving its content.
+	SubfieldIt addSubfield(Subfield &&subfield);
+	SubfieldIt addSubfieldBefore(SubfieldIt nextSubfieldIt,
+		Subfield &&subfield);
+#endif
+
 	// Return null subfield value.
 	inline SubfieldIt nullSubfield()
 	{
@@ -305,6 +501,8 @@ public:
 
 	// Clear subfield data.
 	void clear(void);
+	// Swap content of subfields.
+	void swap(Subfield &subfield);
 
 	// Get identifier of subfield.
 	char & getId(void);
@@ -328,6 +526,97 @@ public:
 	std::string getEmbeddedData(void);
 };
 
+#if __cplusplus >= 201103L
+
+/*
+ * Move constructor of record.
+ */
+inline
+MarcRecord::MarcRecord(MarcRecord &&record)
+	: MarcRecord(record.m_formatVariant)
+{
+	swap(record);
+}
+
+/*
+ * Move assignment operator of record.
+ */
+inline MarcRecord &
+MarcRecord::operator=(MarcRecord &&record)
+{
+	swap(record);
+	return *this;
+}
+
+/*
+ * Add field to the end of record moving its content.
+ */
+inline MarcRecord::FieldIt
+MarcRecord::addField(Field &&field)
+{
+	FieldIt fieldIt = allocField(m_fieldList.end());
+	fieldIt->swap(field);
+	dropLazyField(fieldIt);
+	return fieldIt;
+}
+
+/*
+ * Add field to the record before specified field moving its content.
+ */
+inline MarcRecord::FieldIt
+MarcRecord::addFieldBefore(FieldIt nextFieldIt, Field &&field)
+{
+	FieldIt fieldIt = allocField(nextFieldIt);
+	fieldIt->swap(field);
+	dropLazyField(fieldIt);
+	return fieldIt;
+}
+
+/*
+ * Move constructor of field.
+ */
+inline
+MarcRecord::Field::Field(Field &&field)
+	: Field()
+{
+	swap(field);
+}
+
+/*
+ * Move assignment operator of field.
+ */
+inline MarcRecord::Field &
+MarcRecord::Field::operator=(Field &&field)
+{
+	swap(field);
+	return *this;
+}
+
+/*
+ * Add subfield to the end of field moving its content.
+ */
+inline MarcRecord::SubfieldIt
+MarcRecord::Field::addSubfield(Subfield &&subfield)
+{
+	SubfieldIt subfieldIt = allocSubfield(m_subfieldList.end());
+	subfieldIt->swap(subfield);
+	return subfieldIt;
+}
+
+/*
+ * Add subfield to the field before specified subfield moving its content.
+ */
+inline MarcRecord::SubfieldIt
+MarcRecord::Field::addSubfieldBefore(SubfieldIt nextSubfieldIt,
+	Subfield &&subfield)
+{
+	SubfieldIt subfieldIt = allocSubfield(nextSubfieldIt);
+	subfieldIt->swap(subfield);
+	return subfieldIt;
+}
+
+#endif // __cplusplus >= 201103L
+
 } // namespace marcrecord
 
 #endif // MARCRECORD_MARCRECORD_H
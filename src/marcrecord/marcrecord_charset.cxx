@@ -0,0 +1,935 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "marcrecord_charset.h"
+
+namespace marcrecord {
+
+// Graphic sets.
+#define GRAPHIC_SET_ASCII		0
+#define GRAPHIC_SET_ANSEL		1
+#define GRAPHIC_SET_CYRILLIC		2
+#define GRAPHIC_SET_GREEK_SYMBOLS	3
+#define GRAPHIC_SET_SUBSCRIPTS		4
+#define GRAPHIC_SET_SUPERSCRIPTS	5
+#define GRAPHIC_SET_ISO5426		6
+#define NUM_GRAPHIC_SETS		7
+// Multibyte East Asian graphic set (EACC, no conversion table).
+#define GRAPHIC_SET_EACC		7
+
+// Escape character.
+#define ESCAPE_CHAR			'\x1B'
+// Maximum number of diacritics of one character.
+#define MAX_MARKS			16
+
+/*
+ * Characters of MARC-8 extended Latin (ANSEL) graphic set.
+ */
+static const unsigned int ansel_chars[][2] = {
+	{ 0x88, 0x0098 }, { 0x89, 0x009C }, { 0x8D, 0x200D }, { 0x8E, 0x200C },
+	{ 0xA1, 0x0141 }, { 0xA2, 0x00D8 }, { 0xA3, 0x0110 }, { 0xA4, 0x00DE },
+	{ 0xA5, 0x00C6 }, { 0xA6, 0x0152 }, { 0xA7, 0x02B9 }, { 0xA8, 0x00B7 },
+	{ 0xA9, 0x266D }, { 0xAA, 0x00AE }, { 0xAB, 0x00B1 }, { 0xAC, 0x01A0 },
+	{ 0xAD, 0x01AF }, { 0xAE, 0x02BC }, { 0xB0, 0x02BB }, { 0xB1, 0x0142 },
+	{ 0xB2, 0x00F8 }, { 0xB3, 0x0111 }, { 0xB4, 0x00FE }, { 0xB5, 0x00E6 },
+	{ 0xB6, 0x0153 }, { 0xB7, 0x02BA }, { 0xB8, 0x0131 }, { 0xB9, 0x00A3 },
+	{ 0xBA, 0x00F0 }, { 0xBC, 0x01A1 }, { 0xBD, 0x01B0 }, { 0xC0, 0x00B0 },
+	{ 0xC1, 0x2113 }, { 0xC2, 0x2117 }, { 0xC3, 0x00A9 }, { 0xC4, 0x266F },
+	{ 0xC5, 0x00BF }, { 0xC6, 0x00A1 }, { 0xC7, 0x00DF }, { 0xC8, 0x20AC },
+	{ 0xE0, 0x0309 }, { 0xE1, 0x0300 }, { 0xE2, 0x0301 }, { 0xE3, 0x0302 },
+	{ 0xE4, 0x0303 }, { 0xE5, 0x0304 }, { 0xE6, 0x0306 }, { 0xE7, 0x0307 },
+	{ 0xE8, 0x0308 }, { 0xE9, 0x030C }, { 0xEA, 0x030A }, { 0xEB, 0xFE20 },
+	{ 0xEC, 0xFE21 }, { 0xED, 0x0315 }, { 0xEE, 0x030B }, { 0xEF, 0x0310 },
+	{ 0xF0, 0x0327 }, { 0xF1, 0x0328 }, { 0xF2, 0x0323 }, { 0xF3, 0x0324 },
+	{ 0xF4, 0x0325 }, { 0xF5, 0x0333 }, { 0xF6, 0x0332 }, { 0xF7, 0x0326 },
+	{ 0xF8, 0x031C }, { 0xF9, 0x032E }, { 0xFA, 0xFE22 }, { 0xFB, 0xFE23 },
+	{ 0xFE, 0x0313 }
+};
+
+/*
+ * Characters of MARC-8 basic Cyrillic graphic set.
+ */
+static const unsigned int cyrillic_chars[][2] = {
+	{ 0x21, 0x0021 }, { 0x22, 0x0022 }, { 0x23, 0x0023 }, { 0x24, 0x0024 },
+	{ 0x25, 0x0025 }, { 0x26, 0x0026 }, { 0x27, 0x0027 }, { 0x28, 0x0028 },
+	{ 0x29, 0x0029 }, { 0x2A, 0x002A }, { 0x2B, 0x002B }, { 0x2C, 0x002C },
+	{ 0x2D, 0x002D }, { 0x2E, 0x002E }, { 0x2F, 0x002F }, { 0x30, 0x0030 },
+	{ 0x31, 0x0031 }, { 0x32, 0x0032 }, { 0x33, 0x0033 }, { 0x34, 0x0034 },
+	{ 0x35, 0x0035 }, { 0x36, 0x0036 }, { 0x37, 0x0037 }, { 0x38, 0x0038 },
+	{ 0x39, 0x0039 }, { 0x3A, 0x003A }, { 0x3B, 0x003B }, { 0x3C, 0x003C },
+	{ 0x3D, 0x003D }, { 0x3E, 0x003E }, { 0x3F, 0x003F }, { 0x40, 0x044E },
+	{ 0x41, 0x0430 }, { 0x42, 0x0431 }, { 0x43, 0x0446 }, { 0x44, 0x0434 },
+	{ 0x45, 0x0435 }, { 0x46, 0x0444 }, { 0x47, 0x0433 }, { 0x48, 0x0445 },
+	{ 0x49, 0x0438 }, { 0x4A, 0x0439 }, { 0x4B, 0x043A }, { 0x4C, 0x043B },
+	{ 0x4D, 0x043C }, { 0x4E, 0x043D }, { 0x4F, 0x043E }, { 0x50, 0x043F },
+	{ 0x51, 0x044F }, { 0x52, 0x0440 }, { 0x53, 0x0441 }, { 0x54, 0x0442 },
+	{ 0x55, 0x0443 }, { 0x56, 0x0436 }, { 0x57, 0x0432 }, { 0x58, 0x044C },
+	{ 0x59, 0x044B }, { 0x5A, 0x0437 }, { 0x5B, 0x0448 }, { 0x5C, 0x044D },
+	{ 0x5D, 0x0449 }, { 0x5E, 0x0447 }, { 0x5F, 0x044A }, { 0x60, 0x042E },
+	{ 0x61, 0x0410 }, { 0x62, 0x0411 }, { 0x63, 0x0426 }, { 0x64, 0x0414 },
+	{ 0x65, 0x0415 }, { 0x66, 0x0424 }, { 0x67, 0x0413 }, { 0x68, 0x0425 },
+	{ 0x69, 0x0418 }, { 0x6A, 0x0419 }, { 0x6B, 0x041A }, { 0x6C, 0x041B },
+	{ 0x6D, 0x041C }, { 0x6E, 0x041D }, { 0x6F, 0x041E }, { 0x70, 0x041F },
+	{ 0x71, 0x042F }, { 0x72, 0x0420 }, { 0x73, 0x0421 }, { 0x74, 0x0422 },
+	{ 0x75, 0x0423 }, { 0x76, 0x0416 }, { 0x77, 0x0412 }, { 0x78, 0x042C },
+	{ 0x79, 0x042B }, { 0x7A, 0x0417 }, { 0x7B, 0x0428 }, { 0x7C, 0x042D },
+	{ 0x7D, 0x0429 }, { 0x7E, 0x0427 }
+};
+
+/*
+ * Characters of MARC-8 Greek symbols graphic set.
+ */
+static const unsigned int greek_symbols_chars[][2] = {
+	{ 0x61, 0x03B1 }, { 0x62, 0x03B2 }, { 0x63, 0x03B3 }
+};
+
+/*
+ * Characters of MARC-8 subscripts graphic set.
+ */
+static const unsigned int subscripts_chars[][2] = {
+	{ 0x28, 0x208D }, { 0x29, 0x208E }, { 0x2B, 0x208A }, { 0x2D, 0x208B },
+	{ 0x30, 0x2080 }, { 0x31, 0x2081 }, { 0x32, 0x2082 }, { 0x33, 0x2083 },
+	{ 0x34, 0x2084 }, { 0x35, 0x2085 }, { 0x36, 0x2086 }, { 0x37, 0x2087 },
+	{ 0x38, 0x2088 }, { 0x39, 0x2089 }
+};
+
+/*
+ * Characters of MARC-8 superscripts graphic set.
+ */
+static const unsigned int superscripts_chars[][2] = {
+	{ 0x28, 0x207D }, { 0x29, 0x207E }, { 0x2B, 0x207A }, { 0x2D, 0x207B },
+	{ 0x30, 0x2070 }, { 0x31, 0x00B9 }, { 0x32, 0x00B2 }, { 0x33, 0x00B3 },
+	{ 0x34, 0x2074 }, { 0x35, 0x2075 }, { 0x36, 0x2076 }, { 0x37, 0x2077 },
+	{ 0x38, 0x2078 }, { 0x39, 0x2079 }
+};
+
+/*
+ * Characters of ISO 5426 graphic set.
+ */
+static const unsigned int iso5426_chars[][2] = {
+	{ 0x88, 0x0098 }, { 0x89, 0x009C }, { 0xA1, 0x00A1 }, { 0xA2, 0x201E },
+	{ 0xA3, 0x00A3 }, { 0xA4, 0x0024 }, { 0xA5, 0x00A5 }, { 0xA6, 0x2020 },
+	{ 0xA7, 0x00A7 }, { 0xA8, 0x2032 }, { 0xA9, 0x2018 }, { 0xAA, 0x201C },
+	{ 0xAB, 0x00AB }, { 0xAC, 0x266D }, { 0xAD, 0x00A9 }, { 0xAE, 0x2117 },
+	{ 0xAF, 0x00AE }, { 0xB0, 0x02BB }, { 0xB1, 0x02BC }, { 0xB2, 0x201A },
+	{ 0xB6, 0x2021 }, { 0xB7, 0x00B7 }, { 0xB8, 0x2033 }, { 0xB9, 0x2019 },
+	{ 0xBA, 0x201D }, { 0xBB, 0x00BB }, { 0xBC, 0x266F }, { 0xBD, 0x02B9 },
+	{ 0xBE, 0x02BA }, { 0xBF, 0x00BF }, { 0xC0, 0x0309 }, { 0xC1, 0x0300 },
+	{ 0xC2, 0x0301 }, { 0xC3, 0x0302 }, { 0xC4, 0x0303 }, { 0xC5, 0x0304 },
+	{ 0xC6, 0x0306 }, { 0xC7, 0x0307 }, { 0xC8, 0x0308 }, { 0xC9, 0x0308 },
+	{ 0xCA, 0x030A }, { 0xCB, 0xFE20 }, { 0xCC, 0xFE21 }, { 0xCD, 0x030B },
+	{ 0xCE, 0x031B }, { 0xCF, 0x030C }, { 0xD0, 0x0327 }, { 0xD1, 0x031C },
+	{ 0xD2, 0x0326 }, { 0xD3, 0x0328 }, { 0xD4, 0x0325 }, { 0xD5, 0x032E },
+	{ 0xD6, 0x0323 }, { 0xD7, 0x0324 }, { 0xD8, 0x0332 }, { 0xD9, 0x0333 },
+	{ 0xDA, 0x0329 }, { 0xDB, 0x032D }, { 0xDD, 0xFE22 }, { 0xDE, 0xFE23 },
+	{ 0xE1, 0x00C6 }, { 0xE2, 0x0110 }, { 0xE6, 0x0132 }, { 0xE7, 0x013F },
+	{ 0xE8, 0x0141 }, { 0xE9, 0x00D8 }, { 0xEA, 0x0152 }, { 0xEC, 0x00DE },
+	{ 0xF1, 0x00E6 }, { 0xF2, 0x0111 }, { 0xF3, 0x00F0 }, { 0xF5, 0x0131 },
+	{ 0xF6, 0x0133 }, { 0xF7, 0x0140 }, { 0xF8, 0x0142 }, { 0xF9, 0x00F8 },
+	{ 0xFA, 0x0153 }, { 0xFB, 0x00DF }, { 0xFC, 0x00FE }
+};
+
+/*
+ * Canonical decomposition of Latin letter with diacritic.
+ */
+struct Decomposition {
+	// Code point of letter.
+	unsigned int codePoint;
+	// Code point of base letter.
+	unsigned int base;
+	// Code point of diacritic.
+	unsigned int mark;
+};
+typedef struct Decomposition Decomposition;
+
+/*
+ * Decompositions of Latin letters with diacritics sorted by code point.
+ */
+static const Decomposition decompositions[] = {
+	{ 0x00C0, 0x0041, 0x0300 }, { 0x00C1, 0x0041, 0x0301 },
+	{ 0x00C2, 0x0041, 0x0302 }, { 0x00C3, 0x0041, 0x0303 },
+	{ 0x00C4, 0x0041, 0x0308 }, { 0x00C5, 0x0041, 0x030A },
+	{ 0x00C7, 0x0043, 0x0327 }, { 0x00C8, 0x0045, 0x0300 },
+	{ 0x00C9, 0x0045, 0x0301 }, { 0x00CA, 0x0045, 0x0302 },
+	{ 0x00CB, 0x0045, 0x0308 }, { 0x00CC, 0x0049, 0x0300 },
+	{ 0x00CD, 0x0049, 0x0301 }, { 0x00CE, 0x0049, 0x0302 },
+	{ 0x00CF, 0x0049, 0x0308 }, { 0x00D1, 0x004E, 0x0303 },
+	{ 0x00D2, 0x004F, 0x0300 }, { 0x00D3, 0x004F, 0x0301 },
+	{ 0x00D4, 0x004F, 0x0302 }, { 0x00D5, 0x004F, 0x0303 },
+	{ 0x00D6, 0x004F, 0x0308 }, { 0x00D9, 0x0055, 0x0300 },
+	{ 0x00DA, 0x0055, 0x0301 }, { 0x00DB, 0x0055, 0x0302 },
+	{ 0x00DC, 0x0055, 0x0308 }, { 0x00DD, 0x0059, 0x0301 },
+	{ 0x00E0, 0x0061, 0x0300 }, { 0x00E1, 0x0061, 0x0301 },
+	{ 0x00E2, 0x0061, 0x0302 }, { 0x00E3, 0x0061, 0x0303 },
+	{ 0x00E4, 0x0061, 0x0308 }, { 0x00E5, 0x0061, 0x030A },
+	{ 0x00E7, 0x0063, 0x0327 }, { 0x00E8, 0x0065, 0x0300 },
+	{ 0x00E9, 0x0065, 0x0301 }, { 0x00EA, 0x0065, 0x0302 },
+	{ 0x00EB, 0x0065, 0x0308 }, { 0x00EC, 0x0069, 0x0300 },
+	{ 0x00ED, 0x0069, 0x0301 }, { 0x00EE, 0x0069, 0x0302 },
+	{ 0x00EF, 0x0069, 0x0308 }, { 0x00F1, 0x006E, 0x0303 },
+	{ 0x00F2, 0x006F, 0x0300 }, { 0x00F3, 0x006F, 0x0301 },
+	{ 0x00F4, 0x006F, 0x0302 }, { 0x00F5, 0x006F, 0x0303 },
+	{ 0x00F6, 0x006F, 0x0308 }, { 0x00F9, 0x0075, 0x0300 },
+	{ 0x00FA, 0x0075, 0x0301 }, { 0x00FB, 0x0075, 0x0302 },
+	{ 0x00FC, 0x0075, 0x0308 }, { 0x00FD, 0x0079, 0x0301 },
+	{ 0x00FF, 0x0079, 0x0308 }, { 0x0100, 0x0041, 0x0304 },
+	{ 0x0101, 0x0061, 0x0304 }, { 0x0102, 0x0041, 0x0306 },
+	{ 0x0103, 0x0061, 0x0306 }, { 0x0104, 0x0041, 0x0328 },
+	{ 0x0105, 0x0061, 0x0328 }, { 0x0106, 0x0043, 0x0301 },
+	{ 0x0107, 0x0063, 0x0301 }, { 0x0108, 0x0043, 0x0302 },
+	{ 0x0109, 0x0063, 0x0302 }, { 0x010A, 0x0043, 0x0307 },
+	{ 0x010B, 0x0063, 0x0307 }, { 0x010C, 0x0043, 0x030C },
+	{ 0x010D, 0x0063, 0x030C }, { 0x010E, 0x0044, 0x030C },
+	{ 0x010F, 0x0064, 0x030C }, { 0x0112, 0x0045, 0x0304 },
+	{ 0x0113, 0x0065, 0x0304 }, { 0x0114, 0x0045, 0x0306 },
+	{ 0x0115, 0x0065, 0x0306 }, { 0x0116, 0x0045, 0x0307 },
+	{ 0x0117, 0x0065, 0x0307 }, { 0x0118, 0x0045, 0x0328 },
+	{ 0x0119, 0x0065, 0x0328 }, { 0x011A, 0x0045, 0x030C },
+	{ 0x011B, 0x0065, 0x030C }, { 0x011C, 0x0047, 0x0302 },
+	{ 0x011D, 0x0067, 0x0302 }, { 0x011E, 0x0047, 0x0306 },
+	{ 0x011F, 0x0067, 0x0306 }, { 0x0120, 0x0047, 0x0307 },
+	{ 0x0121, 0x0067, 0x0307 }, { 0x0122, 0x0047, 0x0327 },
+	{ 0x0123, 0x0067, 0x0327 }, { 0x0124, 0x0048, 0x0302 },
+	{ 0x0125, 0x0068, 0x0302 }, { 0x0128, 0x0049, 0x0303 },
+	{ 0x0129, 0x0069, 0x0303 }, { 0x012A, 0x0049, 0x0304 },
+	{ 0x012B, 0x0069, 0x0304 }, { 0x012C, 0x0049, 0x0306 },
+	{ 0x012D, 0x0069, 0x0306 }, { 0x012E, 0x0049, 0x0328 },
+	{ 0x012F, 0x0069, 0x0328 }, { 0x0130, 0x0049, 0x0307 },
+	{ 0x0134, 0x004A, 0x0302 }, { 0x0135, 0x006A, 0x0302 },
+	{ 0x0136, 0x004B, 0x0327 }, { 0x0137, 0x006B, 0x0327 },
+	{ 0x0139, 0x004C, 0x0301 }, { 0x013A, 0x006C, 0x0301 },
+	{ 0x013B, 0x004C, 0x0327 }, { 0x013C, 0x006C, 0x0327 },
+	{ 0x013D, 0x004C, 0x030C }, { 0x013E, 0x006C, 0x030C },
+	{ 0x0143, 0x004E, 0x0301 }, { 0x0144, 0x006E, 0x0301 },
+	{ 0x0145, 0x004E, 0x0327 }, { 0x0146, 0x006E, 0x0327 },
+	{ 0x0147, 0x004E, 0x030C }, { 0x0148, 0x006E, 0x030C },
+	{ 0x014C, 0x004F, 0x0304 }, { 0x014D, 0x006F, 0x0304 },
+	{ 0x014E, 0x004F, 0x0306 }, { 0x014F, 0x006F, 0x0306 },
+	{ 0x0150, 0x004F, 0x030B }, { 0x0151, 0x006F, 0x030B },
+	{ 0x0154, 0x0052, 0x0301 }, { 0x0155, 0x0072, 0x0301 },
+	{ 0x0156, 0x0052, 0x0327 }, { 0x0157, 0x0072, 0x0327 },
+	{ 0x0158, 0x0052, 0x030C }, { 0x0159, 0x0072, 0x030C },
+	{ 0x015A, 0x0053, 0x0301 }, { 0x015B, 0x0073, 0x0301 },
+	{ 0x015C, 0x0053, 0x0302 }, { 0x015D, 0x0073, 0x0302 },
+	{ 0x015E, 0x0053, 0x0327 }, { 0x015F, 0x0073, 0x0327 },
+	{ 0x0160, 0x0053, 0x030C }, { 0x0161, 0x0073, 0x030C },
+	{ 0x0162, 0x0054, 0x0327 }, { 0x0163, 0x0074, 0x0327 },
+	{ 0x0164, 0x0054, 0x030C }, { 0x0165, 0x0074, 0x030C },
+	{ 0x0168, 0x0055, 0x0303 }, { 0x0169, 0x0075, 0x0303 },
+	{ 0x016A, 0x0055, 0x0304 }, { 0x016B, 0x0075, 0x0304 },
+	{ 0x016C, 0x0055, 0x0306 }, { 0x016D, 0x0075, 0x0306 },
+	{ 0x016E, 0x0055, 0x030A }, { 0x016F, 0x0075, 0x030A },
+	{ 0x0170, 0x0055, 0x030B }, { 0x0171, 0x0075, 0x030B },
+	{ 0x0172, 0x0055, 0x0328 }, { 0x0173, 0x0075, 0x0328 },
+	{ 0x0174, 0x0057, 0x0302 }, { 0x0175, 0x0077, 0x0302 },
+	{ 0x0176, 0x0059, 0x0302 }, { 0x0177, 0x0079, 0x0302 },
+	{ 0x0178, 0x0059, 0x0308 }, { 0x0179, 0x005A, 0x0301 },
+	{ 0x017A, 0x007A, 0x0301 }, { 0x017B, 0x005A, 0x0307 },
+	{ 0x017C, 0x007A, 0x0307 }, { 0x017D, 0x005A, 0x030C },
+	{ 0x017E, 0x007A, 0x030C }, { 0x01A0, 0x004F, 0x031B },
+	{ 0x01A1, 0x006F, 0x031B }, { 0x01AF, 0x0055, 0x031B },
+	{ 0x01B0, 0x0075, 0x031B }, { 0x01CD, 0x0041, 0x030C },
+	{ 0x01CE, 0x0061, 0x030C }, { 0x01CF, 0x0049, 0x030C },
+	{ 0x01D0, 0x0069, 0x030C }, { 0x01D1, 0x004F, 0x030C },
+	{ 0x01D2, 0x006F, 0x030C }, { 0x01D3, 0x0055, 0x030C },
+	{ 0x01D4, 0x0075, 0x030C }, { 0x01D5, 0x00DC, 0x0304 },
+	{ 0x01D6, 0x00FC, 0x0304 }, { 0x01D7, 0x00DC, 0x0301 },
+	{ 0x01D8, 0x00FC, 0x0301 }, { 0x01D9, 0x00DC, 0x030C },
+	{ 0x01DA, 0x00FC, 0x030C }, { 0x01DB, 0x00DC, 0x0300 },
+	{ 0x01DC, 0x00FC, 0x0300 }, { 0x01DE, 0x00C4, 0x0304 },
+	{ 0x01DF, 0x00E4, 0x0304 }, { 0x01E0, 0x0226, 0x0304 },
+	{ 0x01E1, 0x0227, 0x0304 }, { 0x01E2, 0x00C6, 0x0304 },
+	{ 0x01E3, 0x00E6, 0x0304 }, { 0x01E6, 0x0047, 0x030C },
+	{ 0x01E7, 0x0067, 0x030C }, { 0x01E8, 0x004B, 0x030C },
+	{ 0x01E9, 0x006B, 0x030C }, { 0x01EA, 0x004F, 0x0328 },
+	{ 0x01EB, 0x006F, 0x0328 }, { 0x01EC, 0x01EA, 0x0304 },
+	{ 0x01ED, 0x01EB, 0x0304 }, { 0x01EE, 0x01B7, 0x030C },
+	{ 0x01EF, 0x0292, 0x030C }, { 0x01F0, 0x006A, 0x030C },
+	{ 0x01F4, 0x0047, 0x0301 }, { 0x01F5, 0x0067, 0x0301 },
+	{ 0x01F8, 0x004E, 0x0300 }, { 0x01F9, 0x006E, 0x0300 },
+	{ 0x01FA, 0x00C5, 0x0301 }, { 0x01FB, 0x00E5, 0x0301 },
+	{ 0x01FC, 0x00C6, 0x0301 }, { 0x01FD, 0x00E6, 0x0301 },
+	{ 0x01FE, 0x00D8, 0x0301 }, { 0x01FF, 0x00F8, 0x0301 },
+	{ 0x0218, 0x0053, 0x0326 }, { 0x0219, 0x0073, 0x0326 },
+	{ 0x021A, 0x0054, 0x0326 }, { 0x021B, 0x0074, 0x0326 },
+	{ 0x021E, 0x0048, 0x030C }, { 0x021F, 0x0068, 0x030C },
+	{ 0x0226, 0x0041, 0x0307 }, { 0x0227, 0x0061, 0x0307 },
+	{ 0x0228, 0x0045, 0x0327 }, { 0x0229, 0x0065, 0x0327 },
+	{ 0x022A, 0x00D6, 0x0304 }, { 0x022B, 0x00F6, 0x0304 },
+	{ 0x022C, 0x00D5, 0x0304 }, { 0x022D, 0x00F5, 0x0304 },
+	{ 0x022E, 0x004F, 0x0307 }, { 0x022F, 0x006F, 0x0307 },
+	{ 0x0230, 0x022E, 0x0304 }, { 0x0231, 0x022F, 0x0304 },
+	{ 0x0232, 0x0059, 0x0304 }, { 0x0233, 0x0079, 0x0304 },
+	{ 0x1E00, 0x0041, 0x0325 }, { 0x1E01, 0x0061, 0x0325 },
+	{ 0x1E02, 0x0042, 0x0307 }, { 0x1E03, 0x0062, 0x0307 },
+	{ 0x1E04, 0x0042, 0x0323 }, { 0x1E05, 0x0062, 0x0323 },
+	{ 0x1E08, 0x00C7, 0x0301 }, { 0x1E09, 0x00E7, 0x0301 },
+	{ 0x1E0A, 0x0044, 0x0307 }, { 0x1E0B, 0x0064, 0x0307 },
+	{ 0x1E0C, 0x0044, 0x0323 }, { 0x1E0D, 0x0064, 0x0323 },
+	{ 0x1E10, 0x0044, 0x0327 }, { 0x1E11, 0x0064, 0x0327 },
+	{ 0x1E14, 0x0112, 0x0300 }, { 0x1E15, 0x0113, 0x0300 },
+	{ 0x1E16, 0x0112, 0x0301 }, { 0x1E17, 0x0113, 0x0301 },
+	{ 0x1E1C, 0x0228, 0x0306 }, { 0x1E1D, 0x0229, 0x0306 },
+	{ 0x1E1E, 0x0046, 0x0307 }, { 0x1E1F, 0x0066, 0x0307 },
+	{ 0x1E20, 0x0047, 0x0304 }, { 0x1E21, 0x0067, 0x0304 },
+	{ 0x1E22, 0x0048, 0x0307 }, { 0x1E23, 0x0068, 0x0307 },
+	{ 0x1E24, 0x0048, 0x0323 }, { 0x1E25, 0x0068, 0x0323 },
+	{ 0x1E26, 0x0048, 0x0308 }, { 0x1E27, 0x0068, 0x0308 },
+	{ 0x1E28, 0x0048, 0x0327 }, { 0x1E29, 0x0068, 0x0327 },
+	{ 0x1E2A, 0x0048, 0x032E }, { 0x1E2B, 0x0068, 0x032E },
+	{ 0x1E2E, 0x00CF, 0x0301 }, { 0x1E2F, 0x00EF, 0x0301 },
+	{ 0x1E30, 0x004B, 0x0301 }, { 0x1E31, 0x006B, 0x0301 },
+	{ 0x1E32, 0x004B, 0x0323 }, { 0x1E33, 0x006B, 0x0323 },
+	{ 0x1E36, 0x004C, 0x0323 }, { 0x1E37, 0x006C, 0x0323 },
+	{ 0x1E38, 0x1E36, 0x0304 }, { 0x1E39, 0x1E37, 0x0304 },
+	{ 0x1E3E, 0x004D, 0x0301 }, { 0x1E3F, 0x006D, 0x0301 },
+	{ 0x1E40, 0x004D, 0x0307 }, { 0x1E41, 0x006D, 0x0307 },
+	{ 0x1E42, 0x004D, 0x0323 }, { 0x1E43, 0x006D, 0x0323 },
+	{ 0x1E44, 0x004E, 0x0307 }, { 0x1E45, 0x006E, 0x0307 },
+	{ 0x1E46, 0x004E, 0x0323 }, { 0x1E47, 0x006E, 0x0323 },
+	{ 0x1E4C, 0x00D5, 0x0301 }, { 0x1E4D, 0x00F5, 0x0301 },
+	{ 0x1E4E, 0x00D5, 0x0308 }, { 0x1E4F, 0x00F5, 0x0308 },
+	{ 0x1E50, 0x014C, 0x0300 }, { 0x1E51, 0x014D, 0x0300 },
+	{ 0x1E52, 0x014C, 0x0301 }, { 0x1E53, 0x014D, 0x0301 },
+	{ 0x1E54, 0x0050, 0x0301 }, { 0x1E55, 0x0070, 0x0301 },
+	{ 0x1E56, 0x0050, 0x0307 }, { 0x1E57, 0x0070, 0x0307 },
+	{ 0x1E58, 0x0052, 0x0307 }, { 0x1E59, 0x0072, 0x0307 },
+	{ 0x1E5A, 0x0052, 0x0323 }, { 0x1E5B, 0x0072, 0x0323 },
+	{ 0x1E5C, 0x1E5A, 0x0304 }, { 0x1E5D, 0x1E5B, 0x0304 },
+	{ 0x1E60, 0x0053, 0x0307 }, { 0x1E61, 0x0073, 0x0307 },
+	{ 0x1E62, 0x0053, 0x0323 }, { 0x1E63, 0x0073, 0x0323 },
+	{ 0x1E64, 0x015A, 0x0307 }, { 0x1E65, 0x015B, 0x0307 },
+	{ 0x1E66, 0x0160, 0x0307 }, { 0x1E67, 0x0161, 0x0307 },
+	{ 0x1E68, 0x1E62, 0x0307 }, { 0x1E69, 0x1E63, 0x0307 },
+	{ 0x1E6A, 0x0054, 0x0307 }, { 0x1E6B, 0x0074, 0x0307 },
+	{ 0x1E6C, 0x0054, 0x0323 }, { 0x1E6D, 0x0074, 0x0323 },
+	{ 0x1E72, 0x0055, 0x0324 }, { 0x1E73, 0x0075, 0x0324 },
+	{ 0x1E78, 0x0168, 0x0301 }, { 0x1E79, 0x0169, 0x0301 },
+	{ 0x1E7A, 0x016A, 0x0308 }, { 0x1E7B, 0x016B, 0x0308 },
+	{ 0x1E7C, 0x0056, 0x0303 }, { 0x1E7D, 0x0076, 0x0303 },
+	{ 0x1E7E, 0x0056, 0x0323 }, { 0x1E7F, 0x0076, 0x0323 },
+	{ 0x1E80, 0x0057, 0x0300 }, { 0x1E81, 0x0077, 0x0300 },
+	{ 0x1E82, 0x0057, 0x0301 }, { 0x1E83, 0x0077, 0x0301 },
+	{ 0x1E84, 0x0057, 0x0308 }, { 0x1E85, 0x0077, 0x0308 },
+	{ 0x1E86, 0x0057, 0x0307 }, { 0x1E87, 0x0077, 0x0307 },
+	{ 0x1E88, 0x0057, 0x0323 }, { 0x1E89, 0x0077, 0x0323 },
+	{ 0x1E8A, 0x0058, 0x0307 }, { 0x1E8B, 0x0078, 0x0307 },
+	{ 0x1E8C, 0x0058, 0x0308 }, { 0x1E8D, 0x0078, 0x0308 },
+	{ 0x1E8E, 0x0059, 0x0307 }, { 0x1E8F, 0x0079, 0x0307 },
+	{ 0x1E90, 0x005A, 0x0302 }, { 0x1E91, 0x007A, 0x0302 },
+	{ 0x1E92, 0x005A, 0x0323 }, { 0x1E93, 0x007A, 0x0323 },
+	{ 0x1E97, 0x0074, 0x0308 }, { 0x1E98, 0x0077, 0x030A },
+	{ 0x1E99, 0x0079, 0x030A }, { 0x1E9B, 0x017F, 0x0307 },
+	{ 0x1EA0, 0x0041, 0x0323 }, { 0x1EA1, 0x0061, 0x0323 },
+	{ 0x1EA2, 0x0041, 0x0309 }, { 0x1EA3, 0x0061, 0x0309 },
+	{ 0x1EA4, 0x00C2, 0x0301 }, { 0x1EA5, 0x00E2, 0x0301 },
+	{ 0x1EA6, 0x00C2, 0x0300 }, { 0x1EA7, 0x00E2, 0x0300 },
+	{ 0x1EA8, 0x00C2, 0x0309 }, { 0x1EA9, 0x00E2, 0x0309 },
+	{ 0x1EAA, 0x00C2, 0x0303 }, { 0x1EAB, 0x00E2, 0x0303 },
+	{ 0x1EAC, 0x1EA0, 0x0302 }, { 0x1EAD, 0x1EA1, 0x0302 },
+	{ 0x1EAE, 0x0102, 0x0301 }, { 0x1EAF, 0x0103, 0x0301 },
+	{ 0x1EB0, 0x0102, 0x0300 }, { 0x1EB1, 0x0103, 0x0300 },
+	{ 0x1EB2, 0x0102, 0x0309 }, { 0x1EB3, 0x0103, 0x0309 },
+	{ 0x1EB4, 0x0102, 0x0303 }, { 0x1EB5, 0x0103, 0x0303 },
+	{ 0x1EB6, 0x1EA0, 0x0306 }, { 0x1EB7, 0x1EA1, 0x0306 },
+	{ 0x1EB8, 0x0045, 0x0323 }, { 0x1EB9, 0x0065, 0x0323 },
+	{ 0x1EBA, 0x0045, 0x0309 }, { 0x1EBB, 0x0065, 0x0309 },
+	{ 0x1EBC, 0x0045, 0x0303 }, { 0x1EBD, 0x0065, 0x0303 },
+	{ 0x1EBE, 0x00CA, 0x0301 }, { 0x1EBF, 0x00EA, 0x0301 },
+	{ 0x1EC0, 0x00CA, 0x0300 }, { 0x1EC1, 0x00EA, 0x0300 },
+	{ 0x1EC2, 0x00CA, 0x0309 }, { 0x1EC3, 0x00EA, 0x0309 },
+	{ 0x1EC4, 0x00CA, 0x0303 }, { 0x1EC5, 0x00EA, 0x0303 },
+	{ 0x1EC6, 0x1EB8, 0x0302 }, { 0x1EC7, 0x1EB9, 0x0302 },
+	{ 0x1EC8, 0x0049, 0x0309 }, { 0x1EC9, 0x0069, 0x0309 },
+	{ 0x1ECA, 0x0049, 0x0323 }, { 0x1ECB, 0x0069, 0x0323 },
+	{ 0x1ECC, 0x004F, 0x0323 }, { 0x1ECD, 0x006F, 0x0323 },
+	{ 0x1ECE, 0x004F, 0x0309 }, { 0x1ECF, 0x006F, 0x0309 },
+	{ 0x1ED0, 0x00D4, 0x0301 }, { 0x1ED1, 0x00F4, 0x0301 },
+	{ 0x1ED2, 0x00D4, 0x0300 }, { 0x1ED3, 0x00F4, 0x0300 },
+	{ 0x1ED4, 0x00D4, 0x0309 }, { 0x1ED5, 0x00F4, 0x0309 },
+	{ 0x1ED6, 0x00D4, 0x0303 }, { 0x1ED7, 0x00F4, 0x0303 },
+	{ 0x1ED8, 0x1ECC, 0x0302 }, { 0x1ED9, 0x1ECD, 0x0302 },
+	{ 0x1EDA, 0x01A0, 0x0301 }, { 0x1EDB, 0x01A1, 0x0301 },
+	{ 0x1EDC, 0x01A0, 0x0300 }, { 0x1EDD, 0x01A1, 0x0300 },
+	{ 0x1EDE, 0x01A0, 0x0309 }, { 0x1EDF, 0x01A1, 0x0309 },
+	{ 0x1EE0, 0x01A0, 0x0303 }, { 0x1EE1, 0x01A1, 0x0303 },
+	{ 0x1EE2, 0x01A0, 0x0323 }, { 0x1EE3, 0x01A1, 0x0323 },
+	{ 0x1EE4, 0x0055, 0x0323 }, { 0x1EE5, 0x0075, 0x0323 },
+	{ 0x1EE6, 0x0055, 0x0309 }, { 0x1EE7, 0x0075, 0x0309 },
+	{ 0x1EE8, 0x01AF, 0x0301 }, { 0x1EE9, 0x01B0, 0x0301 },
+	{ 0x1EEA, 0x01AF, 0x0300 }, { 0x1EEB, 0x01B0, 0x0300 },
+	{ 0x1EEC, 0x01AF, 0x0309 }, { 0x1EED, 0x01B0, 0x0309 },
+	{ 0x1EEE, 0x01AF, 0x0303 }, { 0x1EEF, 0x01B0, 0x0303 },
+	{ 0x1EF0, 0x01AF, 0x0323 }, { 0x1EF1, 0x01B0, 0x0323 },
+	{ 0x1EF2, 0x0059, 0x0300 }, { 0x1EF3, 0x0079, 0x0300 },
+	{ 0x1EF4, 0x0059, 0x0323 }, { 0x1EF5, 0x0079, 0x0323 },
+	{ 0x1EF6, 0x0059, 0x0309 }, { 0x1EF7, 0x0079, 0x0309 },
+	{ 0x1EF8, 0x0059, 0x0303 }, { 0x1EF9, 0x0079, 0x0303 },
+};
+
+/*
+ * Compare decompositions by code point.
+ */
+static inline bool
+compare_decomposition(const Decomposition &decomposition1,
+	const Decomposition &decomposition2)
+{
+	return decomposition1.codePoint < decomposition2.codePoint;
+}
+
+/*
+ * Compare entries of encoding table by code point.
+ */
+static inline bool
+compare_code_point(const std::pair<unsigned int, unsigned int> &entry1,
+	const std::pair<unsigned int, unsigned int> &entry2)
+{
+	return entry1.first < entry2.first;
+}
+
+/*
+ * Check if entries of encoding table have the same code point.
+ */
+static inline bool
+equal_code_point(const std::pair<unsigned int, unsigned int> &entry1,
+	const std::pair<unsigned int, unsigned int> &entry2)
+{
+	return entry1.first == entry2.first;
+}
+
+/*
+ * Return true if character is combining diacritic.
+ */
+static inline bool
+is_combining(unsigned int codePoint)
+{
+	return (codePoint >= 0x0300 && codePoint < 0x0370)
+		|| (codePoint >= 0xFE20 && codePoint < 0xFE30);
+}
+
+/*
+ * Append character to UTF-8 string.
+ */
+static inline void
+append_utf8(std::string &dest, unsigned int codePoint)
+{
+	if (codePoint < 0x80) {
+		dest += (char) codePoint;
+	} else if (codePoint < 0x800) {
+		dest += (char) (0xC0 | (codePoint >> 6));
+		dest += (char) (0x80 | (codePoint & 0x3F));
+	} else {
+		dest += (char) (0xE0 | (codePoint >> 12));
+		dest += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+		dest += (char) (0x80 | (codePoint & 0x3F));
+	}
+}
+
+/*
+ * Read character from UTF-8 string.
+ */
+static inline bool
+read_utf8(const char *&src, const char *end, unsigned int &codePoint)
+{
+	unsigned char c = *src;
+	size_t len;
+	if (c < 0x80) {
+		codePoint = c;
+		len = 1;
+	} else if (c >= 0xC2 && c < 0xE0) {
+		codePoint = c & 0x1F;
+		len = 2;
+	} else if (c >= 0xE0 && c < 0xF0) {
+		codePoint = c & 0x0F;
+		len = 3;
+	} else if (c >= 0xF0 && c < 0xF5) {
+		codePoint = c & 0x07;
+		len = 4;
+	} else {
+		return false;
+	}
+	if (len > (size_t) (end - src)) {
+		return false;
+	}
+
+	for (size_t i = 1; i < len; i++) {
+		if ((src[i] & 0xC0) != 0x80) {
+			return false;
+		}
+		codePoint = (codePoint << 6) | (src[i] & 0x3F);
+	}
+	src += len;
+
+	return true;
+}
+
+/*
+ * Get graphic set by final character of escape sequence (-1 if graphic
+ * set is not supported).
+ */
+static int
+get_graphic_set(char finalChar, bool multibyte = false)
+{
+	if (multibyte) {
+		return finalChar == '1' ? GRAPHIC_SET_EACC : -1;
+	}
+
+	switch (finalChar) {
+	case 'B':
+		return GRAPHIC_SET_ASCII;
+	case 'E':
+		return GRAPHIC_SET_ANSEL;
+	case 'N':
+		return GRAPHIC_SET_CYRILLIC;
+	case 'g':
+		return GRAPHIC_SET_GREEK_SYMBOLS;
+	case 'b':
+		return GRAPHIC_SET_SUBSCRIPTS;
+	case 'p':
+		return GRAPHIC_SET_SUPERSCRIPTS;
+	}
+
+	return -1;
+}
+
+/*
+ * Normalize name of encoding for comparison.
+ */
+static std::string
+normalize_encoding(const char *encoding)
+{
+	std::string name;
+	for (const char *p = encoding; *p != '\0'; p++) {
+		if (*p != '-' && *p != '_' && *p != ' ') {
+			name += (char) toupper((unsigned char) *p);
+		}
+	}
+
+	return name;
+}
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcCharsetCodec::MarcCharsetCodec()
+{
+	clear();
+}
+
+/*
+ * Initialize codec for MARC character set, return false
+ * if encoding is not supported one.
+ */
+bool
+MarcCharsetCodec::init(const char *encoding)
+{
+	clear();
+
+	// Check name of encoding.
+	std::string name = normalize_encoding(encoding);
+	if (name == "MARC8") {
+		m_charset = CHARSET_MARC8;
+	} else if (name == "ISO5426") {
+		m_charset = CHARSET_ISO5426;
+	} else {
+		return false;
+	}
+
+	// Add ASCII graphic set.
+	m_decodeTable.resize(NUM_GRAPHIC_SETS * 128);
+	for (unsigned int c = 0x21; c < 0x7F; c++) {
+		m_decodeTable[GRAPHIC_SET_ASCII * 128 + c] = c;
+		m_encodeTable.push_back(std::make_pair(c,
+			(GRAPHIC_SET_ASCII << 8) | c));
+	}
+
+	// Add graphic sets of character set.
+	if (m_charset == CHARSET_MARC8) {
+		addGraphicSet(GRAPHIC_SET_ANSEL, ansel_chars,
+			sizeof(ansel_chars) / sizeof(ansel_chars[0]));
+		addGraphicSet(GRAPHIC_SET_CYRILLIC, cyrillic_chars,
+			sizeof(cyrillic_chars) / sizeof(cyrillic_chars[0]));
+		addGraphicSet(GRAPHIC_SET_GREEK_SYMBOLS, greek_symbols_chars,
+			sizeof(greek_symbols_chars)
+			/ sizeof(greek_symbols_chars[0]));
+		addGraphicSet(GRAPHIC_SET_SUBSCRIPTS, subscripts_chars,
+			sizeof(subscripts_chars) / sizeof(subscripts_chars[0]));
+		addGraphicSet(GRAPHIC_SET_SUPERSCRIPTS, superscripts_chars,
+			sizeof(superscripts_chars)
+			/ sizeof(superscripts_chars[0]));
+	} else {
+		addGraphicSet(GRAPHIC_SET_ISO5426, iso5426_chars,
+			sizeof(iso5426_chars) / sizeof(iso5426_chars[0]));
+	}
+
+	// Sort encoding table, keep first character for every code point.
+	std::stable_sort(m_encodeTable.begin(), m_encodeTable.end(),
+		compare_code_point);
+	m_encodeTable.erase(std::unique(m_encodeTable.begin(),
+		m_encodeTable.end(), equal_code_point), m_encodeTable.end());
+
+	return true;
+}
+
+/*
+ * Clear codec.
+ */
+void
+MarcCharsetCodec::clear(void)
+{
+	m_charset = CHARSET_NONE;
+	m_decodeTable.clear();
+	m_encodeTable.clear();
+}
+
+/*
+ * Return true if codec is initialized.
+ */
+bool
+MarcCharsetCodec::isValid(void)
+{
+	return m_charset != CHARSET_NONE;
+}
+
+/*
+ * Get character set of codec.
+ */
+MarcCharsetCodec::Charset
+MarcCharsetCodec::getCharset(void)
+{
+	return m_charset;
+}
+
+/*
+ * Convert data from MARC character set to UTF-8.
+ */
+bool
+MarcCharsetCodec::decode(const char *src, size_t len, std::string &dest)
+{
+	if (m_charset == CHARSET_NONE) {
+		return false;
+	}
+
+	const char *end = src + len;
+	unsigned int g0 = GRAPHIC_SET_ASCII;
+	unsigned int g1 = m_charset == CHARSET_MARC8
+		? GRAPHIC_SET_ANSEL : GRAPHIC_SET_ISO5426;
+	std::string marks;
+
+	dest.erase();
+	dest.reserve(len);
+	while (src < end) {
+		unsigned char c = *src++;
+
+		// Process escape sequence selecting graphic set.
+		if (c == ESCAPE_CHAR && m_charset == CHARSET_MARC8) {
+			if (src == end) {
+				return false;
+			}
+			c = *src++;
+			if (c == 's') {
+				g0 = GRAPHIC_SET_ASCII;
+				continue;
+			}
+
+			// Multibyte set is designated to G0 if designator
+			// character is omitted.
+			bool multibyte = c == '$';
+			if (multibyte) {
+				if (src == end) {
+					return false;
+				}
+				c = *src++;
+				if (c != '(' && c != ','
+					&& c != ')' && c != '-')
+				{
+					src--;
+					c = '$';
+				}
+			}
+			if (multibyte || c == '(' || c == ','
+				|| c == ')' || c == '-')
+			{
+				// Skip intermediate character of ANSEL ("!E").
+				if (src < end && *src == '!' && !multibyte) {
+					src++;
+				}
+				if (src == end) {
+					return false;
+				}
+				int graphicSet = get_graphic_set(*src++,
+					multibyte);
+				if (graphicSet < 0) {
+					return false;
+				}
+				if (c == ')' || c == '-') {
+					g1 = graphicSet;
+				} else {
+					g0 = graphicSet;
+				}
+				continue;
+			}
+			int graphicSet = get_graphic_set(c);
+			if (graphicSet != GRAPHIC_SET_GREEK_SYMBOLS
+				&& graphicSet != GRAPHIC_SET_SUBSCRIPTS
+				&& graphicSet != GRAPHIC_SET_SUPERSCRIPTS)
+			{
+				return false;
+			}
+			g0 = graphicSet;
+			continue;
+		}
+
+		// Get code point of character.
+		unsigned int codePoint;
+		if (c <= 0x20 || c == 0x7F) {
+			codePoint = c;
+		} else if ((c < 0x80 ? g0 : g1) == GRAPHIC_SET_EACC) {
+			// Characters of multibyte set can't be converted.
+			return false;
+		} else {
+			codePoint = m_decodeTable[(c < 0x80 ? g0 : g1) * 128
+				+ (c & 0x7F)];
+			if (codePoint == 0) {
+				return false;
+			}
+		}
+
+		// Keep diacritics until base character.
+		if (is_combining(codePoint)) {
+			append_utf8(marks, codePoint);
+			continue;
+		}
+
+		// Append character followed by its diacritics.
+		append_utf8(dest, codePoint);
+		if (!marks.empty()) {
+			dest += marks;
+			marks.erase();
+		}
+	}
+	dest += marks;
+
+	return true;
+}
+
+/*
+ * Convert data from UTF-8 to MARC character set.
+ */
+bool
+MarcCharsetCodec::encode(const char *src, size_t len, std::string &dest)
+{
+	if (m_charset == CHARSET_NONE) {
+		return false;
+	}
+
+	const char *end = src + len;
+	unsigned int graphicSet = GRAPHIC_SET_ASCII;
+	unsigned int marks[MAX_MARKS];
+
+	dest.erase();
+	dest.reserve(len);
+	while (src < end) {
+		unsigned int codePoint;
+		if (!read_utf8(src, end, codePoint)) {
+			return false;
+		}
+
+		// Collect diacritics following character.
+		size_t numMarks = 0;
+		const char *next = src;
+		unsigned int mark;
+		while (next < end && read_utf8(next, end, mark)
+			&& is_combining(mark))
+		{
+			if (numMarks == MAX_MARKS) {
+				return false;
+			}
+			marks[numMarks++] = mark;
+			src = next;
+		}
+
+		// Append character preceded by diacritics.
+		if (!appendChar(dest, codePoint, marks, numMarks, graphicSet)) {
+			return false;
+		}
+	}
+
+	// Restore default graphic set.
+	appendEscape(dest, GRAPHIC_SET_ASCII, graphicSet);
+
+	return true;
+}
+
+/*
+ * Add characters of graphic set to conversion tables.
+ */
+void
+MarcCharsetCodec::addGraphicSet(unsigned int graphicSet,
+	const unsigned int (*chars)[2], size_t numChars)
+{
+	for (size_t i = 0; i < numChars; i++) {
+		unsigned int c = chars[i][0] & 0x7F;
+		m_decodeTable[graphicSet * 128 + c] = chars[i][1];
+		m_encodeTable.push_back(std::make_pair(chars[i][1],
+			(graphicSet << 8) | c));
+	}
+}
+
+/*
+ * Find character by code point.
+ */
+unsigned int
+MarcCharsetCodec::findChar(unsigned int codePoint)
+{
+	std::pair<unsigned int, unsigned int> entry(codePoint, 0);
+	std::vector<std::pair<unsigned int, unsigned int> >::iterator it =
+		std::lower_bound(m_encodeTable.begin(), m_encodeTable.end(),
+		entry, compare_code_point);
+	if (it == m_encodeTable.end() || it->first != codePoint) {
+		return 0;
+	}
+
+	return it->second;
+}
+
+/*
+ * Append character and preceding diacritics to string.
+ */
+bool
+MarcCharsetCodec::appendChar(std::string &dest, unsigned int codePoint,
+	const unsigned int *marks, size_t numMarks, unsigned int &graphicSet)
+{
+	// Decompose character until it is found in graphic sets.
+	unsigned int baseMarks[MAX_MARKS];
+	size_t numBaseMarks = 0;
+	unsigned int charCode = 0;
+	const Decomposition *decompositionsEnd = decompositions
+		+ sizeof(decompositions) / sizeof(decompositions[0]);
+	while (codePoint > 0x20 && codePoint != 0x7F
+		&& (charCode = findChar(codePoint)) == 0)
+	{
+		Decomposition decomposition = { codePoint, 0, 0 };
+		const Decomposition *it = std::lower_bound(decompositions,
+			decompositionsEnd, decomposition,
+			compare_decomposition);
+		if (it == decompositionsEnd || it->codePoint != codePoint
+			|| numBaseMarks == MAX_MARKS)
+		{
+			return false;
+		}
+		baseMarks[numBaseMarks++] = it->mark;
+		codePoint = it->base;
+	}
+
+	// Append diacritics of base character and following diacritics.
+	unsigned int allMarks[MAX_MARKS * 2];
+	size_t numAllMarks = 0;
+	while (numBaseMarks > 0) {
+		allMarks[numAllMarks++] = baseMarks[--numBaseMarks];
+	}
+	for (size_t i = 0; i < numMarks; i++) {
+		allMarks[numAllMarks++] = marks[i];
+	}
+	for (size_t i = 0; i < numAllMarks; i++) {
+		unsigned int markCode = findChar(allMarks[i]);
+		unsigned int markSet = markCode >> 8;
+		if (markCode == 0 || (markSet != GRAPHIC_SET_ANSEL
+			&& markSet != GRAPHIC_SET_ISO5426))
+		{
+			return false;
+		}
+		dest += (char) (0x80 | (markCode & 0x7F));
+	}
+
+	// Append space and control characters as is.
+	if (charCode == 0) {
+		dest += (char) codePoint;
+		return true;
+	}
+
+	// Append character of graphic set.
+	unsigned int charSet = charCode >> 8;
+	unsigned int c = charCode & 0x7F;
+	if (charSet == GRAPHIC_SET_ANSEL || charSet == GRAPHIC_SET_ISO5426) {
+		dest += (char) (0x80 | c);
+	} else {
+		// Keep current graphic set for ASCII characters present in it.
+		if (charSet != GRAPHIC_SET_ASCII
+			|| m_decodeTable[graphicSet * 128 + c] != c)
+		{
+			appendEscape(dest, charSet, graphicSet);
+		}
+		dest += (char) c;
+	}
+
+	return true;
+}
+
+/*
+ * Append escape sequence selecting graphic set.
+ */
+void
+MarcCharsetCodec::appendEscape(std::string &dest, unsigned int newGraphicSet,
+	unsigned int &graphicSet)
+{
+	if (newGraphicSet == graphicSet) {
+		return;
+	}
+
+	dest += ESCAPE_CHAR;
+	switch (newGraphicSet) {
+	case GRAPHIC_SET_GREEK_SYMBOLS:
+		dest += 'g';
+		break;
+	case GRAPHIC_SET_SUBSCRIPTS:
+		dest += 'b';
+		break;
+	case GRAPHIC_SET_SUPERSCRIPTS:
+		dest += 'p';
+		break;
+	case GRAPHIC_SET_CYRILLIC:
+		dest += "(N";
+		break;
+	default:
+		if (graphicSet == GRAPHIC_SET_CYRILLIC) {
+			dest += "(B";
+		} else {
+			dest += 's';
+		}
+		break;
+	}
+	graphicSet = newGraphicSet;
+}
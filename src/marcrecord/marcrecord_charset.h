@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCRECORD_CHARSET_H
+#define MARCRECORD_MARCRECORD_CHARSET_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace marcrecord {
+
+/*
+ * Converter between MARC character sets and UTF-8.
+ *
+ * Supported character sets are MARC-8 (ASCII, ANSEL, basic Cyrillic,
+ * Greek symbols, subscripts and superscripts) and ISO 5426. Diacritics
+ * preceding base characters are moved after them, so decoded text is
+ * in decomposed form. Conversion starts in default state, so data
+ * of every field or subfield must be converted separately. Designations
+ * of MARC-8 multibyte set (EACC) are recognized, but its characters
+ * are not converted.
+ */
+class MarcCharsetCodec {
+public:
+	// Character sets.
+	enum Charset {
+		CHARSET_NONE = 0,
+		CHARSET_MARC8 = 1,
+		CHARSET_ISO5426 = 2
+	};
+
+protected:
+	// Character set of codec.
+	Charset m_charset;
+	// Code points of characters of graphic sets (0 for undefined).
+	std::vector<unsigned int> m_decodeTable;
+	// Characters sorted by code point (graphic set in high byte,
+	// character in low byte).
+	std::vector<std::pair<unsigned int, unsigned int> > m_encodeTable;
+
+private:
+	// Add characters of graphic set to conversion tables.
+	void addGraphicSet(unsigned int graphicSet,
+		const unsigned int (*chars)[2], size_t numChars);
+	// Find character by code point.
+	unsigned int findChar(unsigned int codePoint);
+	// Append character and preceding diacritics to string.
+	bool appendChar(std::string &dest, unsigned int codePoint,
+		const unsigned int *marks, size_t numMarks,
+		unsigned int &graphicSet);
+	// Append escape sequence selecting graphic set.
+	void appendEscape(std::string &dest, unsigned int newGraphicSet,
+		unsigned int &graphicSet);
+
+public:
+	// Constructor.
+	MarcCharsetCodec();
+
+	// Initialize codec for MARC character set, return false
+	// if encoding is not supported one.
+	bool init(const char *encoding);
+	// Clear codec.
+	void clear(void);
+	// Return true if codec is initialized.
+	bool isValid(void);
+	// Get character set of codec.
+	Charset getCharset(void);
+
+	// Convert data from MARC character set to UTF-8.
+	bool decode(const char *src, size_t len, std::string &dest);
+	// Convert data from UTF-8 to MARC character set.
+	bool encode(const char *src, size_t len, std::string &dest);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCRECORD_CHARSET_H
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iconv.h>
+#include "marcrecord_codec.h"
+
+namespace marcrecord {
+
+// Size of buffer for converted data.
+#define CODEC_BUFFER_SIZE	4096
+
+/*
+ * Convert data with iconv, return number of output bytes or -1 on error.
+ */
+static int
+convert_sample(iconv_t iconvDesc, const char *sample, size_t len,
+	char *buf, size_t bufLen)
+{
+#ifndef ICONV_CONST_CHAR
+	char *src = (char *) sample;
+#else
+	const char *src = sample;
+#endif
+	char *dest = buf;
+	size_t srcLen = len;
+	size_t destLen = bufLen;
+
+	// Reset conversion state.
+	::iconv(iconvDesc, NULL, NULL, NULL, NULL);
+
+	if (::iconv(iconvDesc, &src, &srcLen, &dest, &destLen) == (size_t) -1
+		|| srcLen != 0)
+	{
+		return errno == EINVAL ? -2 : -1;
+	}
+
+	return (int) (dest - buf);
+}
+
+/*
+ * Pack UTF-8 sequence into integer.
+ */
+static inline unsigned int
+pack_utf8(const char *s, size_t len)
+{
+	unsigned int value = 0;
+	for (size_t i = 0; i < len; i++) {
+		value = (value << 8) | (unsigned char) s[i];
+	}
+
+	return value;
+}
+
+/*
+ * Compare entries of encoding table by packed UTF-8 sequence.
+ */
+static inline bool
+compare_sequence(const std::pair<unsigned int, char> &entry1,
+	const std::pair<unsigned int, char> &entry2)
+{
+	return entry1.first < entry2.first;
+}
+
+/*
+ * Get length of UTF-8 sequence by its first byte (0 if byte is invalid).
+ */
+static inline size_t
+utf8_length(unsigned char c)
+{
+	if (c < 0x80) {
+		return 1;
+	} else if (c < 0xC2) {
+		return 0;
+	} else if (c < 0xE0) {
+		return 2;
+	} else if (c < 0xF0) {
+		return 3;
+	} else if (c < 0xF5) {
+		return 4;
+	}
+
+	return 0;
+}
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+SingleByteCodec::SingleByteCodec()
+{
+	clear();
+}
+
+/*
+ * Initialize codec for encoding, return false if encoding
+ * is not single-byte one.
+ */
+bool
+SingleByteCodec::init(const char *encoding)
+{
+	clear();
+
+	// Initialize iconv for both directions.
+	iconv_t decodeDesc = iconv_open("UTF-8", encoding);
+	if (decodeDesc == (iconv_t) -1) {
+		return false;
+	}
+	iconv_t encodeDesc = iconv_open(encoding, "UTF-8");
+	if (encodeDesc == (iconv_t) -1) {
+		iconv_close(decodeDesc);
+		return false;
+	}
+
+	// Generate conversion tables.
+	bool singleByte = true;
+	for (unsigned int i = 0; i < 256 && singleByte; i++) {
+		char c = (char) i;
+		char buf[8];
+		int len = convert_sample(decodeDesc, &c, 1, buf, sizeof(buf));
+		if (i < 0x80) {
+			// ASCII characters must be kept as is.
+			singleByte = len == 1 && buf[0] == c;
+		} else if (len == -2 || len == 0) {
+			// Character is part of multibyte sequence.
+			singleByte = false;
+		} else if (len > 0 && len <= 4) {
+			// Check that character is encoded back to itself.
+			char encodedChar;
+			if (convert_sample(encodeDesc, buf, len,
+				&encodedChar, 1) == 1 && encodedChar == c)
+			{
+				memcpy(m_decodeTable[i - 0x80], buf, len);
+				m_decodeLen[i - 0x80] = (unsigned char) len;
+				if (len == 2) {
+					m_encodeTable[((buf[0] & 0x1F) << 6)
+						| (buf[1] & 0x3F)] = c;
+				} else {
+					m_encodeList.push_back(std::make_pair(
+						pack_utf8(buf, len), c));
+				}
+			}
+		}
+	}
+	std::sort(m_encodeList.begin(), m_encodeList.end(),
+		compare_sequence);
+
+	// Finalize iconv.
+	iconv_close(decodeDesc);
+	iconv_close(encodeDesc);
+
+	if (!singleByte) {
+		clear();
+		return false;
+	}
+
+	m_valid = true;
+	return true;
+}
+
+/*
+ * Clear codec.
+ */
+void
+SingleByteCodec::clear(void)
+{
+	m_valid = false;
+	memset(m_decodeLen, 0, sizeof(m_decodeLen));
+	memset(m_encodeTable, 0, sizeof(m_encodeTable));
+	m_encodeList.clear();
+}
+
+/*
+ * Return true if codec is initialized.
+ */
+bool
+SingleByteCodec::isValid(void)
+{
+	return m_valid;
+}
+
+/*
+ * Convert data from single-byte encoding to UTF-8.
+ */
+bool
+SingleByteCodec::decode(const char *src, size_t len, std::string &dest)
+{
+	if (!m_valid) {
+		return false;
+	}
+
+	const char *end = src + len;
+	char buf[CODEC_BUFFER_SIZE];
+	size_t bufLen = 0;
+
+	dest.erase();
+	while (src < end) {
+		// Copy run of ASCII characters at once.
+		if ((unsigned char) *src < 0x80) {
+			const char *run = src;
+			while (src < end && (unsigned char) *src < 0x80) {
+				src++;
+			}
+			appendRun(dest, buf, bufLen, run, src - run);
+			continue;
+		}
+
+		// Append UTF-8 sequence of character.
+		unsigned int i = (unsigned char) *src - 0x80;
+		if (m_decodeLen[i] == 0) {
+			return false;
+		}
+		if (bufLen > CODEC_BUFFER_SIZE - 4) {
+			dest.append(buf, bufLen);
+			bufLen = 0;
+		}
+		memcpy(buf + bufLen, m_decodeTable[i], 4);
+		bufLen += m_decodeLen[i];
+		src++;
+	}
+	dest.append(buf, bufLen);
+
+	return true;
+}
+
+/*
+ * Convert data from UTF-8 to single-byte encoding.
+ */
+bool
+SingleByteCodec::encode(const char *src, size_t len, std::string &dest)
+{
+	if (!m_valid) {
+		return false;
+	}
+
+	const char *end = src + len;
+	char buf[CODEC_BUFFER_SIZE];
+	size_t bufLen = 0;
+
+	dest.erase();
+	while (src < end) {
+		// Copy run of ASCII characters at once.
+		if ((unsigned char) *src < 0x80) {
+			const char *run = src;
+			while (src < end && (unsigned char) *src < 0x80) {
+				src++;
+			}
+			appendRun(dest, buf, bufLen, run, src - run);
+			continue;
+		}
+
+		// Find character by UTF-8 sequence.
+		size_t charLen = utf8_length((unsigned char) *src);
+		if (charLen == 0 || charLen > (size_t) (end - src)) {
+			return false;
+		}
+		char c = 0;
+		if (charLen == 2) {
+			if ((src[1] & 0xC0) == 0x80) {
+				c = m_encodeTable[((src[0] & 0x1F) << 6)
+					| (src[1] & 0x3F)];
+			}
+		} else {
+			std::pair<unsigned int, char> entry(
+				pack_utf8(src, charLen), 0);
+			std::vector<std::pair<unsigned int, char> >::iterator
+				it = std::lower_bound(m_encodeList.begin(),
+				m_encodeList.end(), entry, compare_sequence);
+			if (it != m_encodeList.end()
+				&& it->first == entry.first)
+			{
+				c = it->second;
+			}
+		}
+		if (c == 0) {
+			return false;
+		}
+
+		// Append character.
+		if (bufLen == CODEC_BUFFER_SIZE) {
+			dest.append(buf, bufLen);
+			bufLen = 0;
+		}
+		buf[bufLen++] = c;
+		src += charLen;
+	}
+	dest.append(buf, bufLen);
+
+	return true;
+}
+
+/*
+ * Append run of characters to destination string through buffer.
+ */
+void
+SingleByteCodec::appendRun(std::string &dest, char *buf, size_t &bufLen,
+	const char *run, size_t runLen)
+{
+	if (bufLen + runLen <= CODEC_BUFFER_SIZE) {
+		// Copy short run to buffer.
+		memcpy(buf + bufLen, run, runLen);
+		bufLen += runLen;
+	} else {
+		// Append buffer and long run to destination string.
+		dest.append(buf, bufLen);
+		dest.append(run, runLen);
+		bufLen = 0;
+	}
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCRECORD_CODEC_H
+#define MARCRECORD_MARCRECORD_CODEC_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace marcrecord {
+
+/*
+ * Table-driven converter between single-byte encoding and UTF-8.
+ *
+ * Tables are generated with iconv, so any single-byte encoding compatible
+ * with ASCII is supported. Conversion fails for characters missing in
+ * tables, caller should convert such data with iconv.
+ */
+class SingleByteCodec {
+protected:
+	// Flag of initialized codec.
+	bool m_valid;
+	// UTF-8 sequences of characters 0x80-0xFF.
+	char m_decodeTable[128][4];
+	// Lengths of UTF-8 sequences (0 for undefined characters).
+	unsigned char m_decodeLen[128];
+	// Characters 0x80-0xFF indexed by code points below U+0800
+	// (0 for missing characters).
+	char m_encodeTable[0x800];
+	// Characters 0x80-0xFF with longer UTF-8 sequences sorted
+	// by packed sequence.
+	std::vector<std::pair<unsigned int, char> > m_encodeList;
+
+private:
+	// Append run of characters to destination string through buffer.
+	static void appendRun(std::string &dest, char *buf, size_t &bufLen,
+		const char *run, size_t runLen);
+
+public:
+	// Constructor.
+	SingleByteCodec();
+
+	// Initialize codec for encoding, return false if encoding
+	// is not single-byte one.
+	bool init(const char *encoding);
+	// Clear codec.
+	void clear(void);
+	// Return true if codec is initialized.
+	bool isValid(void);
+
+	// Convert data from single-byte encoding to UTF-8.
+	bool decode(const char *src, size_t len, std::string &dest);
+	// Convert data from UTF-8 to single-byte encoding.
+	bool encode(const char *src, size_t len, std::string &dest);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCRECORD_CODEC_H
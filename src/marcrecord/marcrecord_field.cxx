@@ -26,6 +26,7 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include "marcrecord.h"
 #include "marcrecord_tools.h"
 
@@ -34,7 +35,7 @@ using namespace marcrecord;
 /*
  * Constructor.
  */
-MarcRecord::Field::Field(const std::string &tag, const std::string &data)
+MarcRecord::Field::Field(const Tag &tag, const std::string &data)
 {
 	clear();
 	m_type = CONTROLFIELD;
@@ -42,7 +43,7 @@ MarcRecord::Field::Field(const std::string &tag, const std::string &data)
 	m_data = data;
 }
 
-MarcRecord::Field::Field(const std::string &tag, char ind1, char ind2)
+MarcRecord::Field::Field(const Tag &tag, char ind1, char ind2)
 {
 	clear();
 	m_type = DATAFIELD;
@@ -51,6 +52,44 @@ MarcRecord::Field::Field(const std::string &tag, char ind1, char ind2)
 	m_ind2 = ind2;
 }
 
+MarcRecord::Field::Field(const Field &field)
+	: m_type(field.m_type), m_tag(field.m_tag), m_ind1(field.m_ind1),
+	m_ind2(field.m_ind2), m_data(field.m_data),
+	m_subfieldList(field.m_subfieldList), m_lazy(field.m_lazy),
+	m_rawPos(field.m_rawPos), m_rawLength(field.m_rawLength)
+{
+}
+
+/*
+ * Assignment operator.
+ */
+MarcRecord::Field &
+MarcRecord::Field::operator=(const Field &field)
+{
+	if (this != &field) {
+		m_type = field.m_type;
+		m_tag = field.m_tag;
+		m_ind1 = field.m_ind1;
+		m_ind2 = field.m_ind2;
+		m_data = field.m_data;
+		m_lazy = field.m_lazy;
+		m_rawPos = field.m_rawPos;
+		m_rawLength = field.m_rawLength;
+
+		// Copy subfields reusing removed subfields.
+		m_spareSubfieldList.splice(m_spareSubfieldList.end(),
+			m_subfieldList);
+		for (SubfieldList::const_iterator subfieldIt =
+			field.m_subfieldList.begin();
+			subfieldIt != field.m_subfieldList.end(); subfieldIt++)
+		{
+			*allocSubfield(m_subfieldList.end()) = *subfieldIt;
+		}
+	}
+
+	return *this;
+}
+
 /*
  * Clear field data.
  */
@@ -58,11 +97,34 @@ void
 MarcRecord::Field::clear(void)
 {
 	m_type = CONTROLFIELD;
-	m_tag = "";
+	m_tag.clear();
 	m_data.erase();
 	m_ind1 = ' ';
 	m_ind2 = ' ';
-	m_subfieldList.clear();
+	m_lazy = false;
+	m_rawPos = 0;
+	m_rawLength = 0;
+
+	// Keep subfields for reuse by following additions.
+	m_spareSubfieldList.splice(m_spareSubfieldList.end(), m_subfieldList);
+}
+
+/*
+ * Swap content of fields.
+ */
+void
+MarcRecord::Field::swap(Field &field)
+{
+	std::swap(m_type, field.m_type);
+	std::swap(m_tag, field.m_tag);
+	std::swap(m_ind1, field.m_ind1);
+	std::swap(m_ind2, field.m_ind2);
+	m_data.swap(field.m_data);
+	m_subfieldList.swap(field.m_subfieldList);
+	m_spareSubfieldList.swap(field.m_spareSubfieldList);
+	std::swap(m_lazy, field.m_lazy);
+	std::swap(m_rawPos, field.m_rawPos);
+	std::swap(m_rawLength, field.m_rawLength);
 }
 
 /*
@@ -110,17 +172,17 @@ MarcRecord::Field::isDataField(void)
 /*
  * Get tag of data field.
  */
-std::string &
+std::string
 MarcRecord::Field::getTag(void)
 {
-	return m_tag;
+	return m_tag.str();
 }
 
 /*
  * Set tag of data field.
  */
 void
-MarcRecord::Field::setTag(const std::string &tag)
+MarcRecord::Field::setTag(const Tag &tag)
 {
 	m_tag = tag;
 }
@@ -187,11 +249,11 @@ MarcRecord::Field::toString(void)
 {
 	// Format control field to string.
 	if (m_type == CONTROLFIELD) {
-		return (m_tag + " " + m_data);
+		return (m_tag.str() + " " + m_data);
 	}
 
 	// Format data field to string.
-	std::string textField = m_tag;
+	std::string textField = m_tag.str();
 	snprintf(textField, 5, " [%c%c]", m_ind1, m_ind2);
 
 	// Iterate all subfields.
@@ -259,6 +321,26 @@ MarcRecord::Field::getSubfield(char subfieldId)
 	return m_subfieldList.end();
 }
 
+/*
+ * Get next subfield with specified identifier after specified subfield.
+ */
+MarcRecord::SubfieldIt
+MarcRecord::Field::nextSubfield(SubfieldIt subfieldIt, char subfieldId)
+{
+	if (subfieldIt == m_subfieldList.end()) {
+		return subfieldIt;
+	}
+
+	// Check following subfields in list.
+	for (subfieldIt++; subfieldIt != m_subfieldList.end(); subfieldIt++) {
+		if (subfieldId == ' ' || subfieldIt->m_id == subfieldId) {
+			return subfieldIt;
+		}
+	}
+
+	return m_subfieldList.end();
+}
+
 /*
  * Get list of embedded fields.
  */
@@ -334,6 +416,45 @@ MarcRecord::Field::getEmbeddedField(const std::string &fieldTag)
 	return embeddedSubfieldList;
 }
 
+/*
+ * Get first subfield of embedded field.
+ */
+MarcRecord::SubfieldIt
+MarcRecord::Field::firstEmbeddedField(const std::string &fieldTag)
+{
+	SubfieldIt subfieldIt = m_subfieldList.begin();
+	if (subfieldIt != m_subfieldList.end() && subfieldIt->m_id == '1'
+		&& (fieldTag == "" || fieldTag == subfieldIt->getEmbeddedTag()))
+	{
+		return subfieldIt;
+	}
+
+	return nextEmbeddedField(subfieldIt, fieldTag);
+}
+
+/*
+ * Get first subfield of next embedded field after specified subfield.
+ */
+MarcRecord::SubfieldIt
+MarcRecord::Field::nextEmbeddedField(SubfieldIt subfieldIt,
+	const std::string &fieldTag)
+{
+	if (subfieldIt == m_subfieldList.end()) {
+		return subfieldIt;
+	}
+
+	// Check following subfields in list.
+	for (subfieldIt++; subfieldIt != m_subfieldList.end(); subfieldIt++) {
+		if (subfieldIt->m_id == '1' && (fieldTag == ""
+			|| fieldTag == subfieldIt->getEmbeddedTag()))
+		{
+			return subfieldIt;
+		}
+	}
+
+	return m_subfieldList.end();
+}
+
 /*
  * Add subfield to the end of field.
  */
@@ -341,8 +462,8 @@ MarcRecord::SubfieldIt
 MarcRecord::Field::addSubfield(const Subfield &subfield)
 {
 	// Append subfield to the list.
-	SubfieldIt subfieldIt =
-		m_subfieldList.insert(m_subfieldList.end(), subfield);
+	SubfieldIt subfieldIt = allocSubfield(m_subfieldList.end());
+	*subfieldIt = subfield;
 	return subfieldIt;
 }
 
@@ -351,8 +472,9 @@ MarcRecord::Field::addSubfield(char subfieldId,
 	const std::string &subfieldData)
 {
 	// Append subfield to the list.
-	SubfieldIt subfieldIt = m_subfieldList.insert(m_subfieldList.end(),
-		Subfield(subfieldId, subfieldData));
+	SubfieldIt subfieldIt = allocSubfield(m_subfieldList.end());
+	subfieldIt->m_id = subfieldId;
+	subfieldIt->m_data = subfieldData;
 	return subfieldIt;
 }
 
@@ -364,8 +486,8 @@ MarcRecord::Field::addSubfieldBefore(SubfieldIt nextSubfieldIt,
 	const Subfield &subfield)
 {
 	// Append subfield to the list.
-	SubfieldIt subfieldIt =
-		m_subfieldList.insert(nextSubfieldIt, subfield);
+	SubfieldIt subfieldIt = allocSubfield(nextSubfieldIt);
+	*subfieldIt = subfield;
 	return subfieldIt;
 }
 
@@ -374,8 +496,9 @@ MarcRecord::Field::addSubfieldBefore(SubfieldIt nextSubfieldIt,
 	char subfieldId, const std::string &subfieldData)
 {
 	// Append subfield to the list.
-	SubfieldIt subfieldIt = m_subfieldList.insert(nextSubfieldIt,
-		Subfield(subfieldId, subfieldData));
+	SubfieldIt subfieldIt = allocSubfield(nextSubfieldIt);
+	subfieldIt->m_id = subfieldId;
+	subfieldIt->m_data = subfieldData;
 	return subfieldIt;
 }
 
@@ -385,6 +508,25 @@ MarcRecord::Field::addSubfieldBefore(SubfieldIt nextSubfieldIt,
 void
 MarcRecord::Field::removeSubfield(SubfieldIt subfieldIt)
 {
-	// Remove subfield from the list.
-	m_subfieldList.erase(subfieldIt);
+	// Move subfield to the list of removed subfields.
+	m_spareSubfieldList.splice(m_spareSubfieldList.end(), m_subfieldList,
+		subfieldIt);
+}
+
+/*
+ * Insert subfield before specified subfield reusing removed subfield.
+ */
+MarcRecord::SubfieldIt
+MarcRecord::Field::allocSubfield(SubfieldIt nextSubfieldIt)
+{
+	if (m_spareSubfieldList.empty()) {
+		return m_subfieldList.insert(nextSubfieldIt, Subfield());
+	}
+
+	// Move removed subfield to the list keeping its storage.
+	SubfieldIt subfieldIt = m_spareSubfieldList.begin();
+	m_subfieldList.splice(nextSubfieldIt, m_spareSubfieldList,
+		subfieldIt);
+
+	return subfieldIt;
 }
@@ -26,6 +26,7 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include "marcrecord.h"
 
 using namespace marcrecord;
@@ -50,6 +51,16 @@ MarcRecord::Subfield::clear(void)
 	m_data.erase();
 }
 
+/*
+ * Swap content of subfields.
+ */
+void
+MarcRecord::Subfield::swap(Subfield &subfield)
+{
+	std::swap(m_id, subfield.m_id);
+	m_data.swap(subfield.m_data);
+}
+
 /*
  * Get identifier of subfield.
  */
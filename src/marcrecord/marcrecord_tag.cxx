@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "marcrecord.h"
+
+using namespace marcrecord;
+
+/*
+ * Constructors.
+ */
+Tag::Tag()
+{
+	clear();
+}
+
+Tag::Tag(const char *tag)
+{
+	assign(tag, strlen(tag));
+}
+
+Tag::Tag(const char *tag, size_t tagLen)
+{
+	assign(tag, tagLen);
+}
+
+Tag::Tag(const std::string &tag)
+{
+	assign(tag.data(), tag.size());
+}
+
+/*
+ * Set tag.
+ */
+void
+Tag::assign(const char *tag, size_t tagLen)
+{
+	memset(m_data, 0, sizeof(m_data));
+	memcpy(m_data, tag, std::min(tagLen, sizeof(m_data) - 1));
+}
+
+/*
+ * Clear tag.
+ */
+void
+Tag::clear(void)
+{
+	memset(m_data, 0, sizeof(m_data));
+}
+
+/*
+ * Get length of tag.
+ */
+size_t
+Tag::size(void) const
+{
+	return strlen(m_data);
+}
+
+/*
+ * Check that tag is empty.
+ */
+bool
+Tag::empty(void) const
+{
+	return m_data[0] == '\0';
+}
+
+/*
+ * Get tag as std::string.
+ */
+std::string
+Tag::str(void) const
+{
+	return std::string(m_data);
+}
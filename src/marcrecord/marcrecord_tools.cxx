@@ -30,6 +30,14 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "marcrecord_tools.h"
 
 namespace marcrecord {
@@ -64,41 +72,72 @@ std::string
 serialize_xml(std::string &s)
 {
 	std::string dest = "";
+	serialize_xml(s, dest);
+
+	return dest;
+}
+
+/*
+ * Serialize XML string appending it to destination string.
+ */
+void
+serialize_xml(const std::string &s, std::string &dest)
+{
+	serialize_xml(s.data(), s.size(), dest);
+}
+
+/*
+ * Serialize XML data appending it to destination string.
+ */
+void
+serialize_xml(const char *s, size_t n, std::string &dest)
+{
+	// Entity numbers of special characters (0 for regular characters).
+	static const unsigned char xmlEntityNo[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 1, 0, 0, 0, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 5, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	};
+	// Replacements of special characters.
+	static const char *xmlEntity[] = {
+		NULL, "&quot;", "&amp;", "&apos;", "&lt;", "&gt;"
+	};
 
 	/*
-	 * Copy characters from source sting to destination string,
-	 * replace special characters.
+	 * Copy runs of regular characters from source data to destination
+	 * string at once, replace special characters.
 	 */
-	for (std::string::iterator it = s.begin(); it != s.end(); it++) {
-		unsigned char c = *it;
-
-		switch (c) {
-		case '"':
-			dest.append("&quot;");
-			break;
-		case '&':
-			if ((it + 1) == s.end() || *(it + 1) != '#') {
-				dest.append("&amp;");
-			} else {
-				dest += c;
-			}
-			break;
-		case '\'':
-			dest.append("&apos;");
-			break;
-		case '<':
-			dest.append("&lt;");
-			break;
-		case '>':
-			dest.append("&gt;");
-			break;
-		default:
-			dest += c;
-			break;
+	const char *end = s + n;
+	const char *run = s;
+	for (const char *p = s; p < end; p++) {
+		unsigned char entityNo = xmlEntityNo[(unsigned char) *p];
+		if (entityNo == 0) {
+			continue;
 		}
-	}
 
-	return dest;
+		// Keep character references as is.
+		if (*p == '&' && p + 1 < end && *(p + 1) == '#') {
+			continue;
+		}
+
+		dest.append(run, p - run);
+		dest.append(xmlEntity[entityNo]);
+		run = p + 1;
+	}
+	dest.append(run, end - run);
 }
 
 /*
@@ -119,6 +158,24 @@ is_numeric(const char *s, size_t n)
 	return 1;
 }
 
+/*
+ * Decode unsigned decimal number of fixed width in ASCII encoding.
+ */
+bool
+decode_number(const char *s, size_t n, unsigned int &value)
+{
+	value = 0;
+	for (size_t i = 0; i < n; i++) {
+		unsigned int digit = (unsigned char) s[i] - '0';
+		if (digit > 9) {
+			return false;
+		}
+		value = value * 10 + digit;
+	}
+
+	return true;
+}
+
 /*
  * Convert encoding for std::string.
  */
@@ -183,4 +240,195 @@ iconv(iconv_t iconv_desc, const char *src, size_t len, std::string &dest)
 	return true;
 }
 
+/*
+ * Map file into memory for sequential reading.
+ */
+const char *
+map_file(const char *fileName, size_t &fileSize)
+{
+	// Empty files can not be mapped, return empty buffer for them.
+	static const char emptyData[1] = { '\0' };
+
+	fileSize = 0;
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(fileName, GENERIC_READ,
+		FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+
+	LARGE_INTEGER fileSizeValue;
+	if (!GetFileSizeEx(fileHandle, &fileSizeValue)) {
+		CloseHandle(fileHandle);
+		return NULL;
+	}
+	if (fileSizeValue.QuadPart == 0) {
+		CloseHandle(fileHandle);
+		return emptyData;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL,
+		PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(fileHandle);
+	if (mappingHandle == NULL) {
+		return NULL;
+	}
+
+	// Mapped view keeps reference to the mapping object.
+	void *fileData = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mappingHandle);
+	if (fileData == NULL) {
+		return NULL;
+	}
+
+	fileSize = (size_t) fileSizeValue.QuadPart;
+#else
+	int fd = ::open(fileName, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		::close(fd);
+		return NULL;
+	}
+	if (fileStat.st_size == 0) {
+		::close(fd);
+		return emptyData;
+	}
+
+	// Mapping stays valid after closing file descriptor.
+	void *fileData = mmap(NULL, (size_t) fileStat.st_size, PROT_READ,
+		MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (fileData == MAP_FAILED) {
+		return NULL;
+	}
+
+	// File is read once from start to end.
+	posix_madvise(fileData, (size_t) fileStat.st_size,
+		POSIX_MADV_SEQUENTIAL);
+	posix_madvise(fileData, (size_t) fileStat.st_size,
+		POSIX_MADV_WILLNEED);
+
+	fileSize = (size_t) fileStat.st_size;
+#endif
+
+	return (const char *) fileData;
+}
+
+/*
+ * Unmap file mapped by map_file().
+ */
+void
+unmap_file(const char *fileData, size_t fileSize)
+{
+	if (fileData == NULL || fileSize == 0) {
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile((LPCVOID) fileData);
+#else
+	munmap((void *) fileData, fileSize);
+#endif
+}
+
+/*
+ * Get number of online processors.
+ */
+unsigned int
+cpu_count(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	long numProcessors = (long) systemInfo.dwNumberOfProcessors;
+#else
+	long numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	return numProcessors > 0 ? (unsigned int) numProcessors : 1;
+}
+
+/*
+ * Thread function and its argument.
+ */
+struct ThreadStart {
+	void (*func)(void *);
+	void *arg;
+};
+typedef struct ThreadStart ThreadStart;
+
+#ifndef _WIN32
+extern "C" {
+// Start routine of thread created by thread_create().
+static void *thread_start(void *param);
+} // extern "C"
+#endif
+
+/*
+ * Start routine of thread created by thread_create().
+ */
+#ifdef _WIN32
+static DWORD WINAPI
+thread_start(LPVOID param)
+#else
+static void *
+thread_start(void *param)
+#endif
+{
+	ThreadStart *threadStart = (ThreadStart *) param;
+	void (*func)(void *) = threadStart->func;
+	void *arg = threadStart->arg;
+
+	delete threadStart;
+	func(arg);
+
+	return 0;
+}
+
+/*
+ * Create thread running specified function.
+ */
+bool
+thread_create(thread_t &thread, void (*func)(void *), void *arg)
+{
+	ThreadStart *threadStart = new ThreadStart;
+	threadStart->func = func;
+	threadStart->arg = arg;
+
+#ifdef _WIN32
+	thread = CreateThread(NULL, 0, thread_start, threadStart, 0, NULL);
+	if (thread == NULL) {
+		delete threadStart;
+		return false;
+	}
+#else
+	if (pthread_create(&thread, NULL, thread_start, threadStart) != 0) {
+		delete threadStart;
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+/*
+ * Wait for thread termination.
+ */
+void
+thread_join(thread_t &thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#else
+	pthread_join(thread, NULL);
+#endif
+}
+
 } // namespace marcrecord
@@ -31,19 +31,45 @@
 
 #include <iconv.h>
 #include <string>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 namespace marcrecord {
 
+// Thread handle.
+#ifdef _WIN32
+typedef void *thread_t;
+#else
+typedef pthread_t thread_t;
+#endif
+
 // Print formatted output to std::string.
 int snprintf(std::string &s, size_t n, const char *format, ...);
 // Serialize XML string.
 std::string serialize_xml(std::string &s);
+// Serialize XML string appending it to destination string.
+void serialize_xml(const std::string &s, std::string &dest);
+// Serialize XML data appending it to destination string.
+void serialize_xml(const char *s, size_t n, std::string &dest);
 // Verify that all string characters are decimal digits in ASCII encoding.
 int is_numeric(const char *s, size_t n);
+// Decode unsigned decimal number of fixed width in ASCII encoding.
+bool decode_number(const char *s, size_t n, unsigned int &value);
 // Convert encoding for std::string.
 bool iconv(iconv_t iconv_desc, const std::string &src, std::string &dest);
 // Convert encoding for std::string.
 bool iconv(iconv_t iconv_desc, const char *src, size_t len, std::string &dest);
+// Map file into memory for sequential reading.
+const char *map_file(const char *fileName, size_t &fileSize);
+// Unmap file mapped by map_file().
+void unmap_file(const char *fileData, size_t fileSize);
+// Get number of online processors.
+unsigned int cpu_count(void);
+// Create thread running specified function.
+bool thread_create(thread_t &thread, void (*func)(void *), void *arg);
+// Wait for thread termination.
+void thread_join(thread_t &thread);
 
 } // namespace marcrecord
 
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcrecord_view.h"
+
+namespace marcrecord {
+
+#define ISO2709_FIELD_SEPARATOR		'\x1E'
+#define ISO2709_IDENTIFIER_DELIMITER	'\x1F'
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcRecordView::MarcRecordView()
+{
+	clear();
+}
+
+MarcRecordView::MarcRecordView(const char *recordBuf, size_t recordBufLen)
+{
+	parse(recordBuf, recordBufLen);
+}
+
+/*
+ * Clear view.
+ */
+void
+MarcRecordView::clear(void)
+{
+	// Keep capacity of directory for next record.
+	m_recordBuf = NULL;
+	m_recordBufLen = 0;
+	m_fieldList.clear();
+}
+
+/*
+ * Decode record leader and directory from ISO 2709 buffer.
+ */
+bool
+MarcRecordView::parse(const char *recordBuf, size_t recordBufLen)
+{
+	const size_t leaderLen = sizeof(MarcRecord::Leader);
+	const size_t entryLen = 12;
+
+	clear();
+
+	// Check record length.
+	unsigned int recordLen;
+	if (recordBufLen < leaderLen
+		|| !decode_number(recordBuf, 5, recordLen)
+		|| recordLen != recordBufLen)
+	{
+		return false;
+	}
+
+	// Get base address of data.
+	unsigned int baseAddress;
+	if (!decode_number(recordBuf + 12, 5, baseAddress)
+		|| baseAddress <= leaderLen || baseAddress > recordLen)
+	{
+		return false;
+	}
+
+	// Decode directory entries.
+	size_t numFields = (baseAddress - leaderLen - 1) / entryLen;
+	const char *entry = recordBuf + leaderLen;
+	m_fieldList.resize(numFields);
+	for (size_t fieldNo = 0; fieldNo < numFields;
+		fieldNo++, entry += entryLen)
+	{
+		unsigned int fieldLength, fieldStartPos;
+		if (!decode_number(entry + 3, 4, fieldLength)
+			|| !decode_number(entry + 7, 5, fieldStartPos)
+			|| baseAddress + fieldStartPos + fieldLength
+			> recordLen)
+		{
+			clear();
+			return false;
+		}
+
+		FieldEntry &field = m_fieldList[fieldNo];
+		memcpy(field.tag, entry, 3);
+		field.data = recordBuf + baseAddress + fieldStartPos;
+		field.size = fieldLength;
+
+		// Exclude field separator from field data.
+		if (field.size > 0 && field.data[field.size - 1]
+			== ISO2709_FIELD_SEPARATOR)
+		{
+			field.size--;
+		}
+	}
+
+	m_recordBuf = recordBuf;
+	m_recordBufLen = recordBufLen;
+
+	return true;
+}
+
+/*
+ * Get record buffer.
+ */
+MarcRecordView::Slice
+MarcRecordView::getRecordData(void)
+{
+	Slice slice = { m_recordBuf, m_recordBufLen };
+	return slice;
+}
+
+/*
+ * Get record leader.
+ */
+const MarcRecord::Leader &
+MarcRecordView::getLeader(void)
+{
+	return *((const MarcRecord::Leader *) m_recordBuf);
+}
+
+/*
+ * Get number of fields.
+ */
+size_t
+MarcRecordView::getFieldCount(void)
+{
+	return m_fieldList.size();
+}
+
+/*
+ * Find next field with specified tag starting at specified position.
+ */
+int
+MarcRecordView::findField(const char *fieldTag, int startFieldNo)
+{
+	int numFields = (int) m_fieldList.size();
+	for (int fieldNo = startFieldNo < 0 ? 0 : startFieldNo;
+		fieldNo < numFields; fieldNo++)
+	{
+		if (memcmp(m_fieldList[fieldNo].tag, fieldTag, 3) == 0) {
+			return fieldNo;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * Get tag of field.
+ */
+MarcRecordView::Slice
+MarcRecordView::getTag(int fieldNo)
+{
+	Slice slice = { m_fieldList[fieldNo].tag, 3 };
+	return slice;
+}
+
+/*
+ * Return true if field is control field.
+ */
+bool
+MarcRecordView::isControlField(int fieldNo)
+{
+	return memcmp(m_fieldList[fieldNo].tag, "010", 3) < 0;
+}
+
+/*
+ * Get field data (control field data or indicators with subfields).
+ */
+MarcRecordView::Slice
+MarcRecordView::getFieldData(int fieldNo)
+{
+	Slice slice = { m_fieldList[fieldNo].data, m_fieldList[fieldNo].size };
+	return slice;
+}
+
+/*
+ * Get indicator 1 of data field.
+ */
+char
+MarcRecordView::getInd1(int fieldNo)
+{
+	const FieldEntry &field = m_fieldList[fieldNo];
+	return field.size > 0 ? field.data[0] : ' ';
+}
+
+/*
+ * Get indicator 2 of data field.
+ */
+char
+MarcRecordView::getInd2(int fieldNo)
+{
+	const FieldEntry &field = m_fieldList[fieldNo];
+	return field.size > 1 ? field.data[1] : ' ';
+}
+
+/*
+ * Get data of first subfield with specified identifier.
+ */
+bool
+MarcRecordView::getSubfield(int fieldNo, char subfieldId,
+	Slice &subfieldData)
+{
+	size_t subfieldPos = 0;
+	char id;
+
+	while (nextSubfield(fieldNo, subfieldPos, id, subfieldData)) {
+		if (id == subfieldId) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Iterate subfields of data field.
+ */
+bool
+MarcRecordView::nextSubfield(int fieldNo, size_t &subfieldPos,
+	char &subfieldId, Slice &subfieldData)
+{
+	if (isControlField(fieldNo)) {
+		return false;
+	}
+
+	// Skip indicators.
+	const FieldEntry &field = m_fieldList[fieldNo];
+	if (subfieldPos < 2) {
+		subfieldPos = 2;
+	}
+	if (subfieldPos >= field.size) {
+		return false;
+	}
+
+	// Find subfield delimiter.
+	const char *delimiter = (const char *) memchr(field.data + subfieldPos,
+		ISO2709_IDENTIFIER_DELIMITER, field.size - subfieldPos);
+	if (delimiter == NULL || delimiter + 1 == field.data + field.size) {
+		subfieldPos = field.size;
+		return false;
+	}
+
+	// Find end of subfield.
+	const char *subfieldStart = delimiter + 1;
+	const char *fieldEnd = field.data + field.size;
+	const char *subfieldEnd = (const char *) memchr(subfieldStart + 1,
+		ISO2709_IDENTIFIER_DELIMITER, fieldEnd - subfieldStart - 1);
+	if (subfieldEnd == NULL) {
+		subfieldEnd = fieldEnd;
+	}
+
+	subfieldId = *subfieldStart;
+	subfieldData.data = subfieldStart + 1;
+	subfieldData.size = subfieldEnd - subfieldStart - 1;
+	subfieldPos = subfieldEnd - field.data;
+
+	return true;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCRECORD_VIEW_H
+#define MARCRECORD_MARCRECORD_VIEW_H
+
+#include <cstddef>
+#include <vector>
+#include "marcrecord.h"
+
+namespace marcrecord {
+
+/*
+ * Read-only view of MARC record in ISO 2709 buffer.
+ *
+ * View keeps pointer to the record buffer and decoded record directory,
+ * so buffer must stay valid while view is used. Data is returned as is,
+ * without encoding conversion.
+ */
+class MarcRecordView {
+public:
+	/*
+	 * Slice of record buffer.
+	 */
+	struct Slice {
+		// Pointer to data.
+		const char *data;
+		// Length of data.
+		size_t size;
+	};
+	typedef struct Slice Slice;
+
+	/*
+	 * Decoded record directory entry.
+	 */
+	struct FieldEntry {
+		// Field tag.
+		char tag[3];
+		// Pointer to field data.
+		const char *data;
+		// Length of field data without field separator.
+		size_t size;
+	};
+	typedef struct FieldEntry FieldEntry;
+
+protected:
+	// Record buffer.
+	const char *m_recordBuf;
+	// Length of record buffer.
+	size_t m_recordBufLen;
+	// Decoded record directory.
+	std::vector<FieldEntry> m_fieldList;
+
+public:
+	// Constructor.
+	MarcRecordView();
+	MarcRecordView(const char *recordBuf, size_t recordBufLen);
+
+	// Clear view.
+	void clear(void);
+	// Decode record leader and directory from ISO 2709 buffer.
+	bool parse(const char *recordBuf, size_t recordBufLen);
+
+	// Get record buffer.
+	Slice getRecordData(void);
+	// Get record leader.
+	const MarcRecord::Leader & getLeader(void);
+
+	// Get number of fields.
+	size_t getFieldCount(void);
+	// Find next field with specified tag starting at specified position.
+	int findField(const char *fieldTag, int startFieldNo = 0);
+	// Get tag of field.
+	Slice getTag(int fieldNo);
+	// Return true if field is control field.
+	bool isControlField(int fieldNo);
+	// Get field data (control field data or indicators with subfields).
+	Slice getFieldData(int fieldNo);
+	// Get indicator 1 of data field.
+	char getInd1(int fieldNo);
+	// Get indicator 2 of data field.
+	char getInd2(int fieldNo);
+
+	// Get data of first subfield with specified identifier.
+	bool getSubfield(int fieldNo, char subfieldId, Slice &subfieldData);
+	// Iterate subfields of data field.
+	bool nextSubfield(int fieldNo, size_t &subfieldPos, char &subfieldId,
+		Slice &subfieldData);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCRECORD_VIEW_H
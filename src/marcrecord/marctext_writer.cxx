@@ -89,9 +89,8 @@ MarcTextWriter::setRecordFooter(std::string recordFooter)
 bool
 MarcTextWriter::open(FILE *outputFile, const char *outputEncoding)
 {
-	// Clear error code and message.
-	m_errorCode = OK;
-	m_errorMessage = "";
+	// Close previous output file, writing its buffered data.
+	close();
 
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
@@ -116,6 +115,9 @@ MarcTextWriter::open(FILE *outputFile, const char *outputEncoding)
 			}
 			return false;
 		}
+
+		// Initialize converter for single-byte encoding.
+		m_codec.init(outputEncoding);
 	}
 
 	return true;
@@ -127,6 +129,9 @@ MarcTextWriter::open(FILE *outputFile, const char *outputEncoding)
 void
 MarcTextWriter::close(void)
 {
+	// Write buffered data.
+	flushBuffer();
+
 	// Finalize iconv.
 	if (m_iconvDesc != (iconv_t) -1) {
 		iconv_close(m_iconvDesc);
@@ -138,6 +143,7 @@ MarcTextWriter::close(void)
 	m_outputFile = NULL;
 	m_outputEncoding = "";
 	m_iconvDesc = (iconv_t) -1;
+	m_codec.clear();
 }
 
 /*
@@ -151,26 +157,21 @@ MarcTextWriter::write(MarcRecord &record)
 
 	if (m_iconvDesc == (iconv_t) -1) {
 		// Write MARCXML record.
-		if (fwrite(recordBuf.c_str(), recordBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(recordBuf)) {
 			return false;
 		}
 	} else {
 		// Write MARCXML record with encoding conversion.
 		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, recordBuf, iconvBuf)) {
+		if (!m_codec.encode(recordBuf.data(), recordBuf.size(),
+			iconvBuf)
+			&& !iconv(m_iconvDesc, recordBuf, iconvBuf))
+		{
 			m_errorCode = ERROR_ICONV;
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(iconvBuf)) {
 			return false;
 		}
 	}
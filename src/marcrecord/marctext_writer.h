@@ -33,6 +33,7 @@
 #include <string>
 #include "marc_writer.h"
 #include "marcrecord.h"
+#include "marcrecord_codec.h"
 
 namespace marcrecord {
 
@@ -43,6 +44,8 @@ class MarcTextWriter : public MarcWriter {
 protected:
 	// Iconv descriptor for output encoding.
 	iconv_t m_iconvDesc;
+	// Converter for single-byte output encoding.
+	SingleByteCodec m_codec;
 
 	// Record header.
 	std::string m_recordHeader;
@@ -0,0 +1,1026 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcxml_parallel_reader.h"
+
+using namespace marcrecord;
+
+// Default number of records in batch per worker thread.
+#define DEFAULT_BATCH_SIZE_PER_THREAD	256
+// Maximum size of raw records data in batch.
+#define MAX_BATCH_DATA_SIZE		(16 * 1024 * 1024)
+// Size of input file blocks.
+#define INPUT_BUFFER_SIZE		(256 * 1024)
+// Position of unfinished record element when there is no one.
+#define NO_POSITION			((size_t) -1)
+
+namespace marcrecord {
+
+/*
+ * Check if data at specified position starts with string
+ * (returns -1 if there is not enough data to decide).
+ */
+static int
+matchPrefix(const char *data, size_t len, size_t pos, const char *prefix)
+{
+	for (; *prefix != '\0'; pos++, prefix++) {
+		if (pos >= len) {
+			return -1;
+		}
+		if (data[pos] != *prefix) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Find end of string in data starting at specified position.
+ */
+static size_t
+findEnd(const char *data, size_t len, size_t pos, const char *s)
+{
+	size_t sLen = strlen(s);
+
+	while (pos + sLen <= len) {
+		const char *p = (const char *) memchr(data + pos, s[0],
+			len - pos - sLen + 1);
+		if (p == NULL) {
+			break;
+		}
+		pos = p - data;
+		if (memcmp(p, s, sLen) == 0) {
+			return pos + sLen;
+		}
+		pos++;
+	}
+
+	return NO_POSITION;
+}
+
+// Namespace bindings (prefix and namespace URI).
+typedef std::vector<std::pair<std::string, std::string> > NamespaceBindings;
+
+extern "C" {
+// XML namespace declaration start handler for expat library.
+void XMLCALL marcXmlContextStartNamespace(void *userData,
+	const XML_Char *prefix, const XML_Char *uri);
+// XML namespace declaration end handler for expat library.
+void XMLCALL marcXmlContextEndNamespace(void *userData,
+	const XML_Char *prefix);
+} // extern "C"
+
+/*
+ * Check if local part of element name is 'record'.
+ */
+static bool
+isRecordName(const char *name, size_t nameLen)
+{
+	// Skip namespace prefix.
+	for (size_t i = nameLen; i > 0; i--) {
+		if (name[i - 1] == ':') {
+			name += i;
+			nameLen -= i;
+			break;
+		}
+	}
+
+	return nameLen == 6 && memcmp(name, "record", 6) == 0;
+}
+
+} // namespace marcrecord
+
+/*
+ * Constructor.
+ */
+MarcXmlParallelReader::MarcXmlParallelReader(FILE *inputFile,
+	const char *inputEncoding, unsigned int numThreads)
+	: MarcReader()
+{
+	// Clear member variables.
+	setNumThreads(numThreads);
+	m_batchSize = 0;
+	m_builtinParser = false;
+	m_mapData = NULL;
+	m_mapSize = 0;
+	m_currentBatch = 0;
+	for (int i = 0; i < 2; i++) {
+		m_batches[i].numRecords = 0;
+		m_batches[i].recordPos = 0;
+		m_batches[i].running = false;
+	}
+
+	if (inputFile) {
+		// Open input file.
+		open(inputFile, inputEncoding);
+	} else {
+		// Clear object state.
+		close();
+	}
+}
+
+/*
+ * Destructor.
+ */
+MarcXmlParallelReader::~MarcXmlParallelReader()
+{
+	// Close input file.
+	close();
+}
+
+/*
+ * Set number of worker threads (0 means number of processors).
+ */
+void
+MarcXmlParallelReader::setNumThreads(unsigned int numThreads)
+{
+	m_numThreads = numThreads == 0 ? cpu_count() : numThreads;
+}
+
+/*
+ * Set maximum number of records in batch (0 means default).
+ */
+void
+MarcXmlParallelReader::setBatchSize(unsigned int batchSize)
+{
+	m_batchSize = batchSize;
+}
+
+/*
+ * Set usage of built-in parser for record elements.
+ */
+void
+MarcXmlParallelReader::setBuiltinParser(bool builtinParser)
+{
+	m_builtinParser = builtinParser;
+}
+
+/*
+ * Open input file.
+ */
+bool
+MarcXmlParallelReader::open(FILE *inputFile, const char *inputEncoding)
+{
+	// Clear state of previously opened file.
+	reset();
+
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Initialize input stream parameters.
+	m_inputFile = inputFile == NULL ? stdin : inputFile;
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+
+	return true;
+}
+
+/*
+ * Open input file by name and map it into memory.
+ */
+bool
+MarcXmlParallelReader::openMapped(const char *inputFileName,
+	const char *inputEncoding)
+{
+	// Clear state of previously opened file.
+	reset();
+
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Map input file into memory.
+	m_mapData = map_file(inputFileName, m_mapSize);
+	if (m_mapData == NULL) {
+		m_mapSize = 0;
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "can't map input file";
+		return false;
+	}
+	m_inputData = m_mapData;
+	m_inputLen = m_mapSize;
+	m_endOfInput = true;
+
+	// Initialize input stream parameters.
+	m_inputFile = NULL;
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+
+	return true;
+}
+
+/*
+ * Close input file.
+ */
+void
+MarcXmlParallelReader::close(void)
+{
+	// Clear state of opened file.
+	reset();
+
+	// Clear member variables.
+	m_errorCode = OK;
+	m_errorMessage = "";
+	m_inputFile = NULL;
+	m_inputEncoding = "";
+	m_autoCorrectionMode = false;
+}
+
+/*
+ * Stop worker threads and clear state of opened file.
+ */
+void
+MarcXmlParallelReader::reset(void)
+{
+	// Wait for worker threads and free their parsers.
+	for (int i = 0; i < 2; i++) {
+		Batch &batch = m_batches[i];
+		joinBatch(batch);
+		batch.numRecords = 0;
+		batch.recordPos = 0;
+		for (size_t j = 0; j < batch.workers.size(); j++) {
+			delete batch.workers[j].parser;
+		}
+		batch.workers.clear();
+	}
+
+	// Release memory-mapped input file.
+	if (m_mapData != NULL) {
+		unmap_file(m_mapData, m_mapSize);
+		m_mapData = NULL;
+		m_mapSize = 0;
+	}
+
+	// Clear state of input data scan.
+	m_inputData = NULL;
+	m_inputLen = 0;
+	m_scanPos = 0;
+	m_recordPos = NO_POSITION;
+	m_endOfInput = false;
+	m_context.erase();
+	m_contextFound = false;
+	m_contextPrefixes.clear();
+
+	m_endOfFile = false;
+	m_currentBatch = 0;
+}
+
+/*
+ * Read next record from file in original order.
+ */
+bool
+MarcXmlParallelReader::next(MarcRecord &record)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	Batch *batch = &m_batches[m_currentBatch];
+	for (;;) {
+		while (batch->recordPos >= batch->numRecords) {
+			// Start parsing of next batch if it is not started yet.
+			Batch *nextBatch = &m_batches[1 - m_currentBatch];
+			if (!nextBatch->running) {
+				if (m_endOfFile) {
+					m_errorCode = END_OF_FILE;
+					return false;
+				}
+				fillBatch(*nextBatch);
+				startBatch(*nextBatch);
+			}
+
+			// Switch to parsed batch.
+			joinBatch(*nextBatch);
+			m_currentBatch = 1 - m_currentBatch;
+			batch = nextBatch;
+
+			// Parse following batch while records are returned.
+			if (!m_endOfFile) {
+				Batch *followingBatch =
+					&m_batches[1 - m_currentBatch];
+				fillBatch(*followingBatch);
+				startBatch(*followingBatch);
+			}
+		}
+
+		// Return error of invalid record.
+		BatchRecord &batchRecord = batch->records[batch->recordPos++];
+		if (batchRecord.errorCode != OK) {
+			m_errorCode = batchRecord.errorCode;
+			m_errorMessage = batchRecord.errorMessage;
+			return false;
+		}
+
+		// Skip record elements not containing MARC records.
+		if (!batchRecord.found) {
+			continue;
+		}
+
+		// Move parsed record content to the caller record.
+		record.takeFields(batchRecord.record);
+
+		return true;
+	}
+}
+
+/*
+ * Read all records from file passing them to handler.
+ */
+bool
+MarcXmlParallelReader::read(RecordHandler handler, void *userData,
+	bool ordered)
+{
+	// Pass records to handler in original order.
+	if (ordered) {
+		MarcRecord record;
+		while (next(record)) {
+			if (!handler(record, userData)) {
+				return true;
+			}
+		}
+		return m_errorCode == END_OF_FILE;
+	}
+
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Pass records left from next() to handler in original order.
+	Batch *currentBatch = &m_batches[m_currentBatch];
+	for (;;) {
+		while (currentBatch->recordPos < currentBatch->numRecords) {
+			size_t recordPos = currentBatch->recordPos++;
+			BatchRecord &batchRecord =
+				currentBatch->records[recordPos];
+			if (batchRecord.errorCode != OK) {
+				m_errorCode = batchRecord.errorCode;
+				m_errorMessage = batchRecord.errorMessage;
+				return false;
+			}
+			if (batchRecord.found
+				&& !handler(batchRecord.record, userData))
+			{
+				return true;
+			}
+		}
+
+		// Switch to batch parsed for next().
+		Batch *nextBatch = &m_batches[1 - m_currentBatch];
+		if (!nextBatch->running) {
+			break;
+		}
+		joinBatch(*nextBatch);
+		m_currentBatch = 1 - m_currentBatch;
+		currentBatch = nextBatch;
+	}
+
+	// Pass records to handler directly from worker threads, read next
+	// batch while records of current one are parsed.
+	Batch *batch = currentBatch;
+	Batch *nextBatch = &m_batches[1 - m_currentBatch];
+	if (!m_endOfFile) {
+		fillBatch(*batch);
+		startBatch(*batch, handler, userData);
+	}
+	while (batch->running) {
+		bool nextFilled = !m_endOfFile;
+		if (nextFilled) {
+			fillBatch(*nextBatch);
+		}
+		bool stopped = joinBatch(*batch);
+
+		// Stop at first invalid record of batch.
+		for (size_t i = 0; i < batch->numRecords; i++) {
+			if (batch->records[i].errorCode != OK) {
+				m_errorCode = batch->records[i].errorCode;
+				m_errorMessage =
+					batch->records[i].errorMessage;
+				stopped = true;
+				break;
+			}
+		}
+		batch->numRecords = 0;
+
+		// Leave records of next batch to next().
+		if (stopped) {
+			if (nextFilled) {
+				startBatch(*nextBatch);
+			}
+			m_currentBatch = batch == &m_batches[0] ? 0 : 1;
+			return m_errorCode == OK;
+		}
+
+		// Switch to next batch.
+		if (nextFilled) {
+			startBatch(*nextBatch, handler, userData);
+		}
+		std::swap(batch, nextBatch);
+	}
+
+	m_errorCode = END_OF_FILE;
+	return true;
+}
+
+/*
+ * Check if built-in parser can be used for input
+ * (input is in UTF-8 and document has no type declaration).
+ */
+bool
+MarcXmlParallelReader::isPlainInput(void)
+{
+	// Get encoding specified by caller or in XML declaration.
+	std::string encoding = m_inputEncoding;
+	size_t declPos = m_context.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+	if (encoding == "" && m_context.compare(declPos, 5, "<?xml") == 0) {
+		size_t declEnd = m_context.find("?>", declPos);
+		size_t pos = m_context.find("encoding", declPos);
+		if (pos < declEnd) {
+			pos = m_context.find_first_of("\"'", pos);
+			size_t end = pos < declEnd
+				? m_context.find(m_context[pos], pos + 1)
+				: std::string::npos;
+			if (end < declEnd) {
+				encoding = m_context.substr(pos + 1,
+					end - pos - 1);
+			}
+		}
+	}
+
+	// Check that encoding is UTF-8.
+	for (size_t i = 0; i < encoding.size(); i++) {
+		encoding[i] = toupper((unsigned char) encoding[i]);
+	}
+	if (encoding != "" && encoding != "UTF-8") {
+		return false;
+	}
+
+	// Document type declaration may define entities and attributes.
+	return m_context.find("<!DOCTYPE") == std::string::npos;
+}
+
+/*
+ * Find namespace prefixes referring to MARCXML in document context.
+ */
+void
+MarcXmlParallelReader::findContextPrefixes(void)
+{
+	m_contextPrefixes.clear();
+
+	// Get namespace bindings in scope at the end of context
+	// (default namespace may be not declared).
+	NamespaceBindings bindings;
+	bindings.push_back(std::make_pair(std::string(), std::string()));
+	XML_Parser xmlParser = XML_ParserCreateNS(m_inputEncoding == ""
+		? NULL : m_inputEncoding.c_str(), ' ');
+	XML_SetUserData(xmlParser, &bindings);
+	XML_SetNamespaceDeclHandler(xmlParser, marcXmlContextStartNamespace,
+		marcXmlContextEndNamespace);
+	enum XML_Status parserResult = XML_Parse(xmlParser, m_context.data(),
+		(int) m_context.size(), XML_FALSE);
+	XML_ParserFree(xmlParser);
+	if (parserResult != XML_STATUS_OK) {
+		// Records are parsed by expat reporting error.
+		return;
+	}
+
+	// Select prefixes whose last binding refers to MARCXML.
+	for (size_t i = 0; i < bindings.size(); i++) {
+		const std::string &prefix = bindings[i].first;
+		const std::string &uri = bindings[i].second;
+		bool overridden = false;
+		for (size_t j = i + 1; j < bindings.size(); j++) {
+			if (bindings[j].first == prefix) {
+				overridden = true;
+				break;
+			}
+		}
+		if (!overridden && ((prefix == "" && uri == "")
+			|| MarcXmlReader::isMarcXmlNamespace(uri.data(),
+			uri.size())))
+		{
+			m_contextPrefixes.push_back(prefix);
+		}
+	}
+}
+
+/*
+ * Read more data from input file.
+ */
+bool
+MarcXmlParallelReader::readInput(void)
+{
+	if (m_endOfInput) {
+		return false;
+	}
+
+	// Drop scanned data (document start is kept until context is found).
+	size_t keepPos = 0;
+	if (m_contextFound) {
+		keepPos = m_recordPos != NO_POSITION ? m_recordPos : m_scanPos;
+	}
+	if (keepPos > 0) {
+		memmove(&m_inputBuf[0], &m_inputBuf[0] + keepPos,
+			m_inputLen - keepPos);
+		m_inputLen -= keepPos;
+		m_scanPos -= keepPos;
+		if (m_recordPos != NO_POSITION) {
+			m_recordPos -= keepPos;
+		}
+	}
+
+	// Grow buffer if free space is too small.
+	if (m_inputBuf.size() < m_inputLen + INPUT_BUFFER_SIZE) {
+		size_t bufferSize = m_inputBuf.size() * 2;
+		if (bufferSize < m_inputLen + INPUT_BUFFER_SIZE) {
+			bufferSize = m_inputLen + INPUT_BUFFER_SIZE;
+		}
+		m_inputBuf.resize(bufferSize);
+	}
+
+	// Read block of input file.
+	size_t dataLen = fread(&m_inputBuf[m_inputLen], 1,
+		m_inputBuf.size() - m_inputLen, m_inputFile);
+	m_inputData = &m_inputBuf[0];
+	if (dataLen == 0) {
+		m_endOfInput = true;
+		return false;
+	}
+	m_inputLen += dataLen;
+
+	return true;
+}
+
+/*
+ * Find end of markup starting at specified position
+ * (returns false if markup is not complete in input data).
+ */
+bool
+MarcXmlParallelReader::scanMarkup(size_t pos, size_t &markupEnd,
+	bool &recordStart, bool &recordEnd)
+{
+	const char *data = m_inputData;
+	size_t len = m_inputLen;
+
+	recordStart = false;
+	recordEnd = false;
+	if (pos + 1 >= len) {
+		return false;
+	}
+
+	if (data[pos + 1] == '?') {
+		// Skip processing instruction.
+		markupEnd = findEnd(data, len, pos + 2, "?>");
+		return markupEnd != NO_POSITION;
+	} else if (data[pos + 1] == '!') {
+		// Skip comment.
+		int match = matchPrefix(data, len, pos, "<!--");
+		if (match != 0) {
+			markupEnd = match < 0 ? NO_POSITION
+				: findEnd(data, len, pos + 4, "-->");
+			return markupEnd != NO_POSITION;
+		}
+
+		// Skip CDATA section.
+		match = matchPrefix(data, len, pos, "<![CDATA[");
+		if (match != 0) {
+			markupEnd = match < 0 ? NO_POSITION
+				: findEnd(data, len, pos + 9, "]]>");
+			return markupEnd != NO_POSITION;
+		}
+
+		// Skip declaration with optional internal subset.
+		int depth = 0;
+		for (size_t i = pos + 2; i < len; i++) {
+			if (data[i] == '"' || data[i] == '\'') {
+				const char *quote = (const char *) memchr(
+					data + i + 1, data[i], len - i - 1);
+				if (quote == NULL) {
+					return false;
+				}
+				i = quote - data;
+			} else if (data[i] == '[') {
+				depth++;
+			} else if (data[i] == ']') {
+				depth--;
+			} else if (data[i] == '>' && depth <= 0) {
+				markupEnd = i + 1;
+				return true;
+			}
+		}
+		return false;
+	} else if (data[pos + 1] == '/') {
+		// Find end of end tag.
+		const char *tagEnd = (const char *) memchr(data + pos + 2, '>',
+			len - pos - 2);
+		if (tagEnd == NULL) {
+			return false;
+		}
+		markupEnd = tagEnd - data + 1;
+
+		// Check element name.
+		size_t nameLen = 0;
+		while (pos + 2 + nameLen < markupEnd - 1
+			&& strchr(" \t\r\n", data[pos + 2 + nameLen]) == NULL)
+		{
+			nameLen++;
+		}
+		recordEnd = isRecordName(data + pos + 2, nameLen);
+		return true;
+	}
+
+	// Find end of start tag skipping quoted attribute values.
+	size_t i = pos + 1;
+	while (i < len) {
+		const char *tagEnd = (const char *) memchr(data + i, '>',
+			len - i);
+		if (tagEnd == NULL) {
+			return false;
+		}
+
+		// Find first quote preceding end of tag.
+		const char *quote = (const char *) memchr(data + i, '"',
+			tagEnd - data - i);
+		const char *apos = (const char *) memchr(data + i, '\'',
+			(quote == NULL ? tagEnd : quote) - data - i);
+		if (apos != NULL) {
+			quote = apos;
+		}
+		if (quote == NULL) {
+			i = tagEnd - data;
+			break;
+		}
+
+		// Skip quoted value.
+		const char *valueEnd = (const char *) memchr(quote + 1, *quote,
+			data + len - quote - 1);
+		if (valueEnd == NULL) {
+			return false;
+		}
+		i = valueEnd - data + 1;
+	}
+	if (i >= len) {
+		return false;
+	}
+	markupEnd = i + 1;
+
+	// Check element name, empty elements are not records.
+	size_t nameLen = 0;
+	while (pos + 1 + nameLen < i
+		&& strchr(" \t\r\n/", data[pos + 1 + nameLen]) == NULL)
+	{
+		nameLen++;
+	}
+	recordStart = data[i - 1] != '/'
+		&& isRecordName(data + pos + 1, nameLen);
+
+	return true;
+}
+
+/*
+ * Find next record element in input data (returns false at the end of
+ * input data or on error, error message is set in the latter case).
+ */
+bool
+MarcXmlParallelReader::scanRecord(size_t &recordStart, size_t &recordEnd,
+	std::string &errorMessage)
+{
+	errorMessage.erase();
+
+	for (;;) {
+		// Check that encoding of input is compatible with ASCII.
+		if (!m_contextFound && m_scanPos == 0 && m_inputLen >= 2
+			&& (m_inputData[0] == '\0' || m_inputData[1] == '\0'
+			|| matchPrefix(m_inputData, 2, 0, "\xFE\xFF") == 1
+			|| matchPrefix(m_inputData, 2, 0, "\xFF\xFE") == 1))
+		{
+			errorMessage = "unsupported encoding of input";
+			return false;
+		}
+
+		// Scan markup in input data.
+		while (m_scanPos < m_inputLen) {
+			const char *markup = (const char *) memchr(
+				m_inputData + m_scanPos, '<',
+				m_inputLen - m_scanPos);
+			if (markup == NULL) {
+				m_scanPos = m_inputLen;
+				break;
+			}
+
+			size_t pos = markup - m_inputData, markupEnd;
+			bool isRecordStart, isRecordEnd;
+			if (!scanMarkup(pos, markupEnd, isRecordStart,
+				isRecordEnd))
+			{
+				m_scanPos = pos;
+				break;
+			}
+			m_scanPos = markupEnd;
+
+			// Innermost record element is taken as MARC record.
+			if (isRecordStart) {
+				m_recordPos = pos;
+			} else if (isRecordEnd && m_recordPos != NO_POSITION) {
+				recordStart = m_recordPos;
+				recordEnd = markupEnd;
+				m_recordPos = NO_POSITION;
+
+				// Keep document part preceding first record.
+				if (!m_contextFound) {
+					m_context.assign(m_inputData,
+						recordStart);
+					m_contextFound = true;
+					findContextPrefixes();
+				}
+
+				return true;
+			}
+		}
+
+		// Read more data.
+		if (!readInput()) {
+			break;
+		}
+	}
+
+	// Check that last record element is complete.
+	if (m_recordPos != NO_POSITION) {
+		errorMessage = "unexpected end of record element";
+	}
+
+	return false;
+}
+
+/*
+ * Read raw records to batch.
+ */
+void
+MarcXmlParallelReader::fillBatch(Batch &batch)
+{
+	unsigned int batchSize = m_batchSize != 0 ? m_batchSize
+		: m_numThreads * DEFAULT_BATCH_SIZE_PER_THREAD;
+
+	batch.data.clear();
+	batch.numRecords = 0;
+	batch.recordPos = 0;
+	if (batch.records.size() < batchSize) {
+		batch.records.resize(batchSize);
+	}
+
+	// Read record elements until batch is full.
+	while (batch.numRecords < batchSize
+		&& batch.data.size() < MAX_BATCH_DATA_SIZE)
+	{
+		size_t recordStart, recordEnd;
+		std::string errorMessage;
+		bool result = scanRecord(recordStart, recordEnd, errorMessage);
+		if (!result && errorMessage.empty()) {
+			m_endOfFile = true;
+			break;
+		}
+
+		// Append record element to batch.
+		BatchRecord &batchRecord = batch.records[batch.numRecords++];
+		batchRecord.offset = batch.data.size();
+		batchRecord.found = false;
+		if (result) {
+			batchRecord.length = recordEnd - recordStart;
+			batchRecord.errorCode = OK;
+			batchRecord.errorMessage.erase();
+			batch.data.insert(batch.data.end(),
+				m_inputData + recordStart,
+				m_inputData + recordEnd);
+		} else {
+			// Input can't be split after error.
+			batchRecord.length = 0;
+			batchRecord.errorCode = ERROR_XML_PARSER;
+			batchRecord.errorMessage = errorMessage;
+			m_endOfFile = true;
+			break;
+		}
+	}
+}
+
+/*
+ * Start parsing of batch records.
+ */
+void
+MarcXmlParallelReader::startBatch(Batch &batch, RecordHandler handler,
+	void *userData)
+{
+	// Split batch to ranges for worker threads.
+	size_t numWorkers = m_numThreads;
+	if (numWorkers > batch.numRecords) {
+		numWorkers = batch.numRecords;
+	}
+
+	// Create parsers for new worker threads.
+	while (batch.workers.size() < numWorkers) {
+		Worker worker;
+		worker.parser = new MarcXmlReader();
+		worker.parser->open(NULL, m_inputEncoding == ""
+			? NULL : m_inputEncoding.c_str());
+		worker.builtinParser = false;
+		worker.stopped = false;
+		worker.threadStarted = false;
+		batch.workers.push_back(worker);
+	}
+
+	// Start worker threads.
+	bool builtinParser = m_builtinParser && isPlainInput();
+	for (size_t i = 0; i < numWorkers; i++) {
+		Worker &worker = batch.workers[i];
+		worker.builtinParser = builtinParser;
+		if (builtinParser) {
+			worker.pullParser.setContextPrefixes(m_contextPrefixes);
+		}
+		worker.context = &m_context;
+		worker.batch = &batch;
+		worker.firstRecord = batch.numRecords * i / numWorkers;
+		worker.lastRecord = batch.numRecords * (i + 1) / numWorkers;
+		worker.handler = handler;
+		worker.userData = userData;
+		worker.stopped = false;
+
+		if (numWorkers == 1) {
+			// Parse records in current thread.
+			worker.threadStarted = false;
+			parseRecords(&worker);
+		} else {
+			// Parse records in worker thread (or in current thread
+			// if thread can't be created).
+			worker.threadStarted = thread_create(worker.thread,
+				parseRecords, &worker);
+			if (!worker.threadStarted) {
+				parseRecords(&worker);
+			}
+		}
+	}
+	for (size_t i = numWorkers; i < batch.workers.size(); i++) {
+		batch.workers[i].batch = NULL;
+	}
+
+	batch.running = true;
+}
+
+/*
+ * Wait until batch records are parsed.
+ */
+bool
+MarcXmlParallelReader::joinBatch(Batch &batch)
+{
+	bool stopped = false;
+
+	if (!batch.running) {
+		return false;
+	}
+
+	// Wait for worker threads of batch.
+	for (size_t i = 0; i < batch.workers.size(); i++) {
+		Worker &worker = batch.workers[i];
+		if (worker.batch != &batch) {
+			continue;
+		}
+		if (worker.threadStarted) {
+			thread_join(worker.thread);
+			worker.threadStarted = false;
+		}
+		stopped |= worker.stopped;
+		worker.batch = NULL;
+	}
+
+	batch.running = false;
+
+	return stopped;
+}
+
+/*
+ * Parse range of batch records.
+ */
+void
+MarcXmlParallelReader::parseRecords(void *workerPtr)
+{
+	Worker *worker = (Worker *) workerPtr;
+	Batch *batch = worker->batch;
+	bool contextParsed = false;
+
+	for (size_t i = worker->firstRecord; i < worker->lastRecord; i++) {
+		BatchRecord &batchRecord = batch->records[i];
+		if (batchRecord.errorCode != OK) {
+			continue;
+		}
+
+		// Parse plain record element with built-in parser.
+		const char *recordData = &batch->data[batchRecord.offset];
+		if (worker->builtinParser && worker->pullParser.parse(
+			recordData, batchRecord.length, batchRecord.record))
+		{
+			batchRecord.found = true;
+		} else {
+			// Parse document context before first record and after
+			// error.
+			if (!contextParsed) {
+				if (!worker->parser->parseContext(
+					worker->context->data(),
+					worker->context->size()))
+				{
+					MarcXmlReader *parser = worker->parser;
+					batchRecord.errorCode =
+						parser->getErrorCode();
+					batchRecord.errorMessage =
+						parser->getErrorMessage();
+					continue;
+				}
+				contextParsed = true;
+			}
+
+			// Parse record with expat.
+			if (!worker->parser->parseFragment(recordData,
+				batchRecord.length, batchRecord.record,
+				batchRecord.found))
+			{
+				batchRecord.errorCode =
+					worker->parser->getErrorCode();
+				batchRecord.errorMessage =
+					worker->parser->getErrorMessage();
+				contextParsed = false;
+				continue;
+			}
+		}
+
+		// Pass record to handler.
+		if (batchRecord.found && worker->handler != NULL
+			&& !worker->stopped)
+		{
+			worker->stopped = !worker->handler(batchRecord.record,
+				worker->userData);
+		}
+	}
+}
+
+namespace marcrecord {
+
+/*
+ * XML namespace declaration start handler for expat library.
+ */
+void XMLCALL
+marcXmlContextStartNamespace(void *userData, const XML_Char *prefix,
+	const XML_Char *uri)
+{
+	NamespaceBindings *bindings = (NamespaceBindings *) userData;
+	bindings->push_back(std::make_pair(
+		std::string(prefix == NULL ? "" : prefix),
+		std::string(uri == NULL ? "" : uri)));
+}
+
+/*
+ * XML namespace declaration end handler for expat library.
+ */
+void XMLCALL
+marcXmlContextEndNamespace(void *userData, const XML_Char *prefix)
+{
+	NamespaceBindings *bindings = (NamespaceBindings *) userData;
+	std::string prefixString = prefix == NULL ? "" : prefix;
+
+	// Remove last binding of prefix.
+	for (size_t i = bindings->size(); i > 1; i--) {
+		if ((*bindings)[i - 1].first == prefixString) {
+			bindings->erase(bindings->begin() + i - 1);
+			break;
+		}
+	}
+}
+
+} // namespace marcrecord
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCXML_PARALLEL_READER_H
+#define MARCRECORD_MARCXML_PARALLEL_READER_H
+
+#include <string>
+#include <vector>
+#include "marc_reader.h"
+#include "marcrecord.h"
+#include "marcrecord_tools.h"
+#include "marcxml_pull_parser.h"
+#include "marcxml_reader.h"
+
+namespace marcrecord {
+
+/*
+ * MARCXML records reader parsing records in parallel threads.
+ *
+ * Input is split into fragments at boundaries of record elements found
+ * by lexical scan (comments, CDATA sections, processing instructions and
+ * quoted attribute values are skipped). Fragments are parsed by worker
+ * threads in context of document part preceding the first record, so
+ * namespaces must be declared in that part or in record elements.
+ * Encodings incompatible with ASCII (UTF-16, UTF-32) are not supported.
+ *
+ * Optionally records in UTF-8 are parsed by built-in MARCXML parser,
+ * record elements it can't handle are parsed by expat. With one thread
+ * records are parsed in the caller thread.
+ */
+class MarcXmlParallelReader : public MarcReader {
+public:
+	// Record handler, returns false to stop reading.
+	typedef bool (*RecordHandler)(MarcRecord &record, void *userData);
+
+	// Record of batch.
+	struct BatchRecord {
+		// Offset of record element data in batch buffer.
+		size_t offset;
+		// Length of record element data.
+		size_t length;
+		// Record element contains MARC record.
+		bool found;
+		// Code of record read or parse error.
+		ErrorCode errorCode;
+		// Message of record read or parse error.
+		std::string errorMessage;
+		// Parsed record.
+		MarcRecord record;
+	};
+	typedef struct BatchRecord BatchRecord;
+
+	struct Batch;
+
+	// Worker thread state.
+	struct Worker {
+		// Parser of worker.
+		MarcXmlReader *parser;
+		// Built-in parser of worker (used if enabled).
+		MarcXmlPullParser pullParser;
+		bool builtinParser;
+		// Document part preceding records.
+		const std::string *context;
+		// Batch and range of records to parse.
+		struct Batch *batch;
+		size_t firstRecord;
+		size_t lastRecord;
+		// Record handler for unordered reading.
+		RecordHandler handler;
+		void *userData;
+		// Record handler requested stop.
+		bool stopped;
+		// Worker thread.
+		thread_t thread;
+		bool threadStarted;
+	};
+	typedef struct Worker Worker;
+
+	// Batch of records.
+	struct Batch {
+		// Raw data of record elements.
+		std::vector<char> data;
+		// Records of batch (list keeps capacity between batches).
+		std::vector<BatchRecord> records;
+		// Number of records in batch.
+		size_t numRecords;
+		// Position of next record to return.
+		size_t recordPos;
+		// Worker threads are started for batch.
+		bool running;
+		// Worker threads parsing batch.
+		std::vector<Worker> workers;
+	};
+	typedef struct Batch Batch;
+
+protected:
+	// Memory-mapped input file data.
+	const char *m_mapData;
+	// Size of memory-mapped input file.
+	size_t m_mapSize;
+	// Input file buffer.
+	std::vector<char> m_inputBuf;
+	// Input data (memory-mapped file or input file buffer).
+	const char *m_inputData;
+	// Length of input data.
+	size_t m_inputLen;
+	// Position of next markup to scan in input data.
+	size_t m_scanPos;
+	// Position of unfinished record element in input data.
+	size_t m_recordPos;
+	// All input data is read.
+	bool m_endOfInput;
+	// Document part preceding records.
+	std::string m_context;
+	// Document part preceding records is found.
+	bool m_contextFound;
+	// Namespace prefixes referring to MARCXML in document context.
+	std::vector<std::string> m_contextPrefixes;
+
+	// End of input file reached.
+	bool m_endOfFile;
+	// Number of worker threads.
+	unsigned int m_numThreads;
+	// Maximum number of records in batch.
+	unsigned int m_batchSize;
+	// Use built-in parser for record elements.
+	bool m_builtinParser;
+	// Batches of records (one is returned while other is parsed).
+	Batch m_batches[2];
+	// Index of batch being returned.
+	int m_currentBatch;
+
+private:
+	// Stop worker threads and clear state of opened file.
+	void reset(void);
+	// Check if built-in parser can be used for input.
+	bool isPlainInput(void);
+	// Find namespace prefixes referring to MARCXML in document context.
+	void findContextPrefixes(void);
+	// Read more data from input file.
+	bool readInput(void);
+	// Find next record element in input data.
+	bool scanRecord(size_t &recordStart, size_t &recordEnd,
+		std::string &errorMessage);
+	// Find end of markup starting at specified position.
+	bool scanMarkup(size_t pos, size_t &markupEnd, bool &recordStart,
+		bool &recordEnd);
+	// Read raw records to batch.
+	void fillBatch(Batch &batch);
+	// Start parsing of batch records.
+	void startBatch(Batch &batch, RecordHandler handler = NULL,
+		void *userData = NULL);
+	// Wait until batch records are parsed.
+	bool joinBatch(Batch &batch);
+	// Parse range of batch records.
+	static void parseRecords(void *worker);
+
+public:
+	// Constructor.
+	MarcXmlParallelReader(FILE *inputFile = NULL,
+		const char *inputEncoding = NULL, unsigned int numThreads = 0);
+	// Destructor.
+	~MarcXmlParallelReader();
+
+	// Set number of worker threads (0 means number of processors).
+	void setNumThreads(unsigned int numThreads = 0);
+	// Set maximum number of records in batch (0 means default).
+	void setBatchSize(unsigned int batchSize = 0);
+	// Set usage of built-in parser for record elements.
+	void setBuiltinParser(bool builtinParser = true);
+
+	// Open input file.
+	bool open(FILE *inputFile, const char *inputEncoding = NULL);
+	// Open input file by name and map it into memory.
+	bool openMapped(const char *inputFileName,
+		const char *inputEncoding = NULL);
+	// Close input file.
+	void close(void);
+	// Read next record from file in original order.
+	bool next(MarcRecord &record);
+	// Read all records from file passing them to handler (in unordered
+	// mode handler is called from worker threads and reading stops after
+	// batch containing invalid record, records read ahead by next() are
+	// passed first in original order from calling thread).
+	bool read(RecordHandler handler, void *userData = NULL,
+		bool ordered = true);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCXML_PARALLEL_READER_H
@@ -0,0 +1,708 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include "marcrecord.h"
+#include "marcxml_pull_parser.h"
+
+namespace marcrecord {
+
+// Classes of characters in XML data.
+enum CharClass {
+	CHAR_REGULAR = 0,
+	CHAR_LT = 1,
+	CHAR_AMP = 2,
+	CHAR_BRACKET = 3,
+	CHAR_MULTIBYTE = 4,
+	CHAR_INVALID = 5,
+	CHAR_QUOTE = 6,
+	CHAR_SPACE = 7
+};
+
+// Classes of characters (whitespace other than space is not regular
+// because it is normalized in attribute values, carriage return is
+// normalized everywhere).
+static const unsigned char charClass[256] = {
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 7, 7, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	0, 0, 6, 0, 0, 0, 2, 6, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4
+};
+
+// Local names of MARCXML elements.
+static const char *elementNames[] = {
+	"", "record", "leader", "controlfield", "datafield", "subfield"
+};
+
+// Attributes of MARCXML elements.
+#define ATTRIBUTE_TAG	1
+#define ATTRIBUTE_IND1	2
+#define ATTRIBUTE_IND2	4
+#define ATTRIBUTE_CODE	8
+
+/*
+ * Check if character is whitespace.
+ */
+static inline bool
+isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/*
+ * Get length of valid UTF-8 sequence of XML character (0 if invalid).
+ */
+static size_t
+getUtf8Length(const char *s, const char *end)
+{
+	const unsigned char *p = (const unsigned char *) s;
+	unsigned char min = 0x80, max = 0xBF;
+	size_t len;
+
+	// Get length of sequence and range of its second byte.
+	if (p[0] < 0xC2) {
+		return 0;
+	} else if (p[0] < 0xE0) {
+		len = 2;
+	} else if (p[0] < 0xF0) {
+		len = 3;
+		if (p[0] == 0xE0) {
+			min = 0xA0;
+		} else if (p[0] == 0xED) {
+			max = 0x9F;
+		}
+	} else if (p[0] < 0xF5) {
+		len = 4;
+		if (p[0] == 0xF0) {
+			min = 0x90;
+		} else if (p[0] == 0xF4) {
+			max = 0x8F;
+		}
+	} else {
+		return 0;
+	}
+
+	// Check continuation bytes.
+	if ((size_t) (end - s) < len || p[1] < min || p[1] > max) {
+		return 0;
+	}
+	for (size_t i = 2; i < len; i++) {
+		if (p[i] < 0x80 || p[i] > 0xBF) {
+			return 0;
+		}
+	}
+
+	// Characters U+FFFE and U+FFFF are not allowed in XML.
+	if (p[0] == 0xEF && p[1] == 0xBF && p[2] >= 0xBE) {
+		return 0;
+	}
+
+	return len;
+}
+
+/*
+ * Check if word contains only regular characters (printable ASCII
+ * characters other than '<', '&' and ']').
+ */
+static inline bool
+isRegularWord(unsigned long word)
+{
+	// Bytes 0x01 and 0x80 repeated in word.
+	const unsigned long ones = (unsigned long) -1 / 0xFF;
+	const unsigned long highBits = ones * 0x80;
+
+	// High bit of byte in mask is set if byte is less than space, has
+	// high bit set or is zero after exclusive or with special character
+	// (bytes after such byte may be set too).
+	unsigned long lt = word ^ (ones * '<');
+	unsigned long amp = word ^ (ones * '&');
+	unsigned long bracket = word ^ (ones * ']');
+	unsigned long mask = word | (word - ones * ' ')
+		| ((lt - ones) & ~lt) | ((amp - ones) & ~amp)
+		| ((bracket - ones) & ~bracket);
+
+	return (mask & highBits) == 0;
+}
+
+/*
+ * Get MARCXML element by its local name.
+ */
+static MarcXmlReader::XmlElement
+getElement(const char *name, size_t nameLen)
+{
+	for (int element = MarcXmlReader::ELEMENT_RECORD;
+		element <= MarcXmlReader::ELEMENT_SUBFIELD; element++)
+	{
+		if (strlen(elementNames[element]) == nameLen
+			&& memcmp(elementNames[element], name, nameLen) == 0)
+		{
+			return (MarcXmlReader::XmlElement) element;
+		}
+	}
+
+	return MarcXmlReader::ELEMENT_UNKNOWN;
+}
+
+} // namespace marcrecord
+
+using namespace marcrecord;
+
+/*
+ * Constructor.
+ */
+MarcXmlPullParser::MarcXmlPullParser()
+{
+	// Clear member variables.
+	m_pos = NULL;
+	m_end = NULL;
+	m_prefix = NULL;
+	m_prefixLen = 0;
+	m_prefixDeclared = false;
+	m_tag = "";
+	m_tagLen = 0;
+	m_ind1 = ' ';
+	m_ind2 = ' ';
+	m_code = ' ';
+}
+
+/*
+ * Set namespace prefixes referring to MARCXML in document context.
+ */
+void
+MarcXmlPullParser::setContextPrefixes(const std::vector<std::string> &prefixes)
+{
+	m_contextPrefixes = prefixes;
+}
+
+/*
+ * Parse record element.
+ */
+bool
+MarcXmlPullParser::parse(const char *data, size_t dataLen,
+	MarcRecord &record)
+{
+	MarcXmlReader::XmlElement element;
+	bool empty;
+
+	m_pos = data;
+	m_end = data + dataLen;
+	m_prefix = NULL;
+	m_prefixLen = 0;
+	m_prefixDeclared = false;
+	record.clear();
+
+	// Parse start tag of record element.
+	if (!parseStartTag(element, empty) || empty
+		|| (!m_prefixDeclared && !isContextPrefix()))
+	{
+		return false;
+	}
+
+	// Parse elements of record.
+	for (;;) {
+		skipSpace();
+		if (m_end - m_pos >= 2 && m_pos[0] == '<' && m_pos[1] == '/') {
+			break;
+		}
+		if (!parseStartTag(element, empty)) {
+			return false;
+		}
+
+		if (element == MarcXmlReader::ELEMENT_LEADER) {
+			// Set record leader.
+			if (!parseContent(element, empty)) {
+				return false;
+			}
+			record.setLeader(m_text);
+		} else if (element == MarcXmlReader::ELEMENT_CONTROLFIELD) {
+			// Add control field to the record.
+			Tag tag(m_tag, m_tagLen);
+			if (!parseContent(element, empty)) {
+				return false;
+			}
+			record.addControlField(tag, m_text);
+		} else if (element == MarcXmlReader::ELEMENT_DATAFIELD) {
+			// Add data field to the record.
+			MarcRecord::FieldIt fieldIt = record.addDataField(
+				Tag(m_tag, m_tagLen), m_ind1, m_ind2);
+			if (empty) {
+				continue;
+			}
+
+			// Parse subfields of data field.
+			for (;;) {
+				skipSpace();
+				if (m_end - m_pos >= 2 && m_pos[0] == '<'
+					&& m_pos[1] == '/')
+				{
+					break;
+				}
+				if (!parseStartTag(element, empty) || element
+					!= MarcXmlReader::ELEMENT_SUBFIELD)
+				{
+					return false;
+				}
+				char subfieldId = m_code;
+				if (!parseContent(element, empty)) {
+					return false;
+				}
+				fieldIt->addSubfield(subfieldId, m_text);
+			}
+			if (!parseEndTag(MarcXmlReader::ELEMENT_DATAFIELD)) {
+				return false;
+			}
+		} else {
+			return false;
+		}
+	}
+
+	// Parse end tag of record element, it must end data.
+	return parseEndTag(MarcXmlReader::ELEMENT_RECORD) && m_pos == m_end;
+}
+
+/*
+ * Skip whitespace.
+ */
+void
+MarcXmlPullParser::skipSpace(void)
+{
+	while (m_pos < m_end && isSpace(*m_pos)) {
+		m_pos++;
+	}
+}
+
+/*
+ * Parse start tag of element.
+ */
+bool
+MarcXmlPullParser::parseStartTag(MarcXmlReader::XmlElement &element,
+	bool &empty)
+{
+	// Get element name.
+	if (m_pos == m_end || *m_pos != '<') {
+		return false;
+	}
+	const char *name = ++m_pos;
+	while (m_pos < m_end && !isSpace(*m_pos) && *m_pos != '/'
+		&& *m_pos != '>')
+	{
+		m_pos++;
+	}
+	size_t nameLen = m_pos - name;
+
+	if (m_prefix == NULL) {
+		// Get namespace prefix from name of record element.
+		if (nameLen < 6 || memcmp(name + nameLen - 6, "record", 6) != 0
+			|| (nameLen > 6 && (nameLen == 7
+			|| name[nameLen - 7] != ':')))
+		{
+			return false;
+		}
+		m_prefix = name;
+		m_prefixLen = nameLen - 6;
+		element = MarcXmlReader::ELEMENT_RECORD;
+	} else {
+		// Other elements must have the same prefix.
+		if (nameLen <= m_prefixLen
+			|| memcmp(name, m_prefix, m_prefixLen) != 0)
+		{
+			return false;
+		}
+		element = getElement(name + m_prefixLen, nameLen - m_prefixLen);
+	}
+
+	// Parse attributes.
+	unsigned int attributes = 0;
+	m_tag = "";
+	m_tagLen = 0;
+	m_ind1 = ' ';
+	m_ind2 = ' ';
+	m_code = ' ';
+	for (;;) {
+		const char *attributeStart = m_pos;
+		skipSpace();
+		if (m_pos == m_end) {
+			return false;
+		}
+
+		// Check end of tag.
+		if (*m_pos == '>') {
+			m_pos++;
+			empty = false;
+			return true;
+		} else if (*m_pos == '/') {
+			if (m_end - m_pos < 2 || m_pos[1] != '>') {
+				return false;
+			}
+			m_pos += 2;
+			empty = true;
+			return true;
+		}
+
+		// Attributes must be preceded by whitespace.
+		if (m_pos == attributeStart
+			|| !parseAttribute(element, attributes))
+		{
+			return false;
+		}
+	}
+}
+
+/*
+ * Parse attribute of start tag.
+ */
+bool
+MarcXmlPullParser::parseAttribute(MarcXmlReader::XmlElement element,
+	unsigned int &attributes)
+{
+	// Get attribute name.
+	const char *name = m_pos;
+	while (m_pos < m_end && !isSpace(*m_pos) && *m_pos != '='
+		&& *m_pos != '/' && *m_pos != '>')
+	{
+		m_pos++;
+	}
+	size_t nameLen = m_pos - name;
+	skipSpace();
+	if (nameLen == 0 || m_pos == m_end || *m_pos != '=') {
+		return false;
+	}
+	m_pos++;
+	skipSpace();
+	if (m_pos == m_end || (*m_pos != '"' && *m_pos != '\'')) {
+		return false;
+	}
+
+	// Get attribute value (references and whitespace other than space
+	// are not supported).
+	char quote = *m_pos++;
+	const char *value = m_pos;
+	while (m_pos < m_end && *m_pos != quote) {
+		unsigned char charClassNo = charClass[(unsigned char) *m_pos];
+		if (charClassNo == CHAR_MULTIBYTE) {
+			size_t len = getUtf8Length(m_pos, m_end);
+			if (len == 0) {
+				return false;
+			}
+			m_pos += len;
+		} else if (charClassNo == CHAR_REGULAR
+			|| charClassNo == CHAR_BRACKET
+			|| charClassNo == CHAR_QUOTE)
+		{
+			m_pos++;
+		} else {
+			return false;
+		}
+	}
+	if (m_pos == m_end) {
+		return false;
+	}
+	size_t valueLen = m_pos - value;
+	m_pos++;
+
+	// Check namespace declarations.
+	if (nameLen >= 5 && memcmp(name, "xmlns", 5) == 0
+		&& (nameLen == 5 || name[5] == ':'))
+	{
+		// Namespace can be declared only in record element.
+		if (element != MarcXmlReader::ELEMENT_RECORD) {
+			return false;
+		}
+
+		// Namespace of record element must be namespace of MARCXML.
+		bool prefixed = nameLen > 5;
+		if (prefixed != (m_prefixLen > 0)
+			|| (prefixed && (nameLen - 6 != m_prefixLen - 1
+			|| memcmp(name + 6, m_prefix, m_prefixLen - 1) != 0)))
+		{
+			return true;
+		}
+		m_prefixDeclared = true;
+		return (!prefixed && valueLen == 0)
+			|| MarcXmlReader::isMarcXmlNamespace(value, valueLen);
+	}
+
+	// Get values of attributes 'tag', 'ind1', 'ind2' and 'code'.
+	unsigned int attribute = 0;
+	if (nameLen == 3 && memcmp(name, "tag", 3) == 0) {
+		attribute = ATTRIBUTE_TAG;
+		m_tag = value;
+		m_tagLen = valueLen;
+	} else if (nameLen == 4 && memcmp(name, "ind1", 4) == 0) {
+		attribute = ATTRIBUTE_IND1;
+		m_ind1 = valueLen > 0 ? value[0] : '\0';
+	} else if (nameLen == 4 && memcmp(name, "ind2", 4) == 0) {
+		attribute = ATTRIBUTE_IND2;
+		m_ind2 = valueLen > 0 ? value[0] : '\0';
+	} else if (nameLen == 4 && memcmp(name, "code", 4) == 0) {
+		attribute = ATTRIBUTE_CODE;
+		m_code = valueLen > 0 ? value[0] : '\0';
+	} else {
+		// Qualified names of known attributes are not supported.
+		const char *colon = (const char *) memchr(name, ':', nameLen);
+		if (colon != NULL) {
+			const char *localName = colon + 1;
+			size_t localNameLen = name + nameLen - localName;
+			if ((localNameLen == 3
+				&& memcmp(localName, "tag", 3) == 0)
+				|| (localNameLen == 4
+				&& (memcmp(localName, "ind1", 4) == 0
+				|| memcmp(localName, "ind2", 4) == 0
+				|| memcmp(localName, "code", 4) == 0)))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Duplicate attributes are not allowed.
+	if ((attributes & attribute) != 0) {
+		return false;
+	}
+	attributes |= attribute;
+
+	return true;
+}
+
+/*
+ * Check if namespace prefix of record element refers to MARCXML
+ * in document context.
+ */
+bool
+MarcXmlPullParser::isContextPrefix(void)
+{
+	size_t prefixLen = m_prefixLen > 0 ? m_prefixLen - 1 : 0;
+	for (size_t i = 0; i < m_contextPrefixes.size(); i++) {
+		if (m_contextPrefixes[i].size() == prefixLen
+			&& m_contextPrefixes[i].compare(0, prefixLen,
+			m_prefix, prefixLen) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Parse end tag of element.
+ */
+bool
+MarcXmlPullParser::parseEndTag(MarcXmlReader::XmlElement element)
+{
+	const char *localName = elementNames[element];
+	size_t localNameLen = strlen(localName);
+
+	// Check element name.
+	if ((size_t) (m_end - m_pos) < 2 + m_prefixLen + localNameLen
+		|| m_pos[0] != '<' || m_pos[1] != '/'
+		|| memcmp(m_pos + 2, m_prefix, m_prefixLen) != 0
+		|| memcmp(m_pos + 2 + m_prefixLen, localName,
+		localNameLen) != 0)
+	{
+		return false;
+	}
+	m_pos += 2 + m_prefixLen + localNameLen;
+
+	// Check end of tag.
+	skipSpace();
+	if (m_pos == m_end || *m_pos != '>') {
+		return false;
+	}
+	m_pos++;
+
+	return true;
+}
+
+/*
+ * Parse character data and end tag of element.
+ */
+bool
+MarcXmlPullParser::parseContent(MarcXmlReader::XmlElement element,
+	bool empty)
+{
+	m_text.clear();
+	if (empty) {
+		return true;
+	}
+
+	// Copy runs of regular characters at once, decode references.
+	const char *run = m_pos;
+	for (;;) {
+		unsigned long word;
+		while ((size_t) (m_end - m_pos) >= sizeof(word)) {
+			memcpy(&word, m_pos, sizeof(word));
+			if (!isRegularWord(word)) {
+				break;
+			}
+			m_pos += sizeof(word);
+		}
+		while (m_pos < m_end
+			&& charClass[(unsigned char) *m_pos] == CHAR_REGULAR)
+		{
+			m_pos++;
+		}
+		if (m_pos == m_end) {
+			return false;
+		}
+
+		switch (charClass[(unsigned char) *m_pos]) {
+		case CHAR_LT:
+			m_text.append(run, m_pos - run);
+			return parseEndTag(element);
+		case CHAR_AMP:
+			m_text.append(run, m_pos - run);
+			if (!parseReference(m_text)) {
+				return false;
+			}
+			run = m_pos;
+			break;
+		case CHAR_BRACKET:
+			// Sequence ']]>' is not allowed in character data.
+			if (m_end - m_pos >= 3
+				&& memcmp(m_pos, "]]>", 3) == 0)
+			{
+				return false;
+			}
+			m_pos++;
+			break;
+		case CHAR_MULTIBYTE: {
+			size_t len = getUtf8Length(m_pos, m_end);
+			if (len == 0) {
+				return false;
+			}
+			m_pos += len;
+			break;
+		}
+		case CHAR_QUOTE:
+		case CHAR_SPACE:
+			m_pos++;
+			break;
+		default:
+			return false;
+		}
+	}
+}
+
+/*
+ * Parse entity or character reference appending it to string.
+ */
+bool
+MarcXmlPullParser::parseReference(std::string &text)
+{
+	// Find end of reference.
+	size_t maxLen = m_end - m_pos < 12 ? m_end - m_pos : 12;
+	const char *end = (const char *) memchr(m_pos, ';', maxLen);
+	if (end == NULL) {
+		return false;
+	}
+	const char *name = m_pos + 1;
+	size_t nameLen = end - name;
+	m_pos = end + 1;
+
+	// Decode predefined entities.
+	if (name[0] != '#') {
+		static const char *entities[] = {
+			"lt", "<", "gt", ">", "amp", "&", "quot", "\"",
+			"apos", "'"
+		};
+		for (size_t i = 0; i < 10; i += 2) {
+			if (strlen(entities[i]) == nameLen
+				&& memcmp(entities[i], name, nameLen) == 0)
+			{
+				text += entities[i + 1];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Decode number of character reference.
+	bool hex = nameLen > 1 && name[1] == 'x';
+	size_t pos = hex ? 2 : 1;
+	unsigned long c = 0;
+	if (pos == nameLen) {
+		return false;
+	}
+	for (; pos < nameLen; pos++) {
+		int digit;
+		if (name[pos] >= '0' && name[pos] <= '9') {
+			digit = name[pos] - '0';
+		} else if (hex && name[pos] >= 'a' && name[pos] <= 'f') {
+			digit = name[pos] - 'a' + 10;
+		} else if (hex && name[pos] >= 'A' && name[pos] <= 'F') {
+			digit = name[pos] - 'A' + 10;
+		} else {
+			return false;
+		}
+		c = c * (hex ? 16 : 10) + digit;
+		if (c > 0x10FFFF) {
+			return false;
+		}
+	}
+
+	// Check that character is allowed in XML (carriage return is not
+	// supported).
+	if (!(c == 0x9 || c == 0xA || (c >= 0x20 && c <= 0xD7FF)
+		|| (c >= 0xE000 && c <= 0xFFFD) || c >= 0x10000))
+	{
+		return false;
+	}
+
+	// Encode character in UTF-8.
+	if (c < 0x80) {
+		text += (char) c;
+	} else if (c < 0x800) {
+		text += (char) (0xC0 | (c >> 6));
+		text += (char) (0x80 | (c & 0x3F));
+	} else if (c < 0x10000) {
+		text += (char) (0xE0 | (c >> 12));
+		text += (char) (0x80 | ((c >> 6) & 0x3F));
+		text += (char) (0x80 | (c & 0x3F));
+	} else {
+		text += (char) (0xF0 | (c >> 18));
+		text += (char) (0x80 | ((c >> 12) & 0x3F));
+		text += (char) (0x80 | ((c >> 6) & 0x3F));
+		text += (char) (0x80 | (c & 0x3F));
+	}
+
+	return true;
+}
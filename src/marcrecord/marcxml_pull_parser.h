@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2013, Alexander Fronkin
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MARCRECORD_MARCXML_PULL_PARSER_H
+#define MARCRECORD_MARCXML_PULL_PARSER_H
+
+#include <string>
+#include <vector>
+#include "marcrecord.h"
+#include "marcxml_reader.h"
+
+namespace marcrecord {
+
+/*
+ * Built-in parser of MARCXML record elements in UTF-8 encoding.
+ *
+ * Parser handles only plain MARCXML markup: record element with leader,
+ * control fields and data fields, predefined entities and character
+ * references. Parsing fails on anything else (comments, CDATA sections,
+ * unknown elements, namespace declarations not referring to MARCXML,
+ * invalid characters), such elements must be parsed by MarcXmlReader.
+ * Namespace prefix of record element declared outside of record element
+ * must be one of prefixes referring to MARCXML in document context.
+ */
+class MarcXmlPullParser {
+protected:
+	// Current position in parsed data.
+	const char *m_pos;
+	// End of parsed data.
+	const char *m_end;
+	// Namespace prefix of record element (including colon).
+	const char *m_prefix;
+	size_t m_prefixLen;
+	// Namespace prefix of record element is declared in it.
+	bool m_prefixDeclared;
+	// Namespace prefixes referring to MARCXML in document context
+	// (empty prefix if default namespace is not declared).
+	std::vector<std::string> m_contextPrefixes;
+
+	// Value of attribute 'tag' of last start tag.
+	const char *m_tag;
+	size_t m_tagLen;
+	// Values of attributes 'ind1', 'ind2' and 'code' of last start tag.
+	char m_ind1;
+	char m_ind2;
+	char m_code;
+
+	// Buffer of decoded character data.
+	std::string m_text;
+
+private:
+	// Skip whitespace.
+	void skipSpace(void);
+	// Parse start tag of element.
+	bool parseStartTag(MarcXmlReader::XmlElement &element, bool &empty);
+	// Parse attribute of start tag.
+	bool parseAttribute(MarcXmlReader::XmlElement element,
+		unsigned int &attributes);
+	// Parse end tag of element.
+	bool parseEndTag(MarcXmlReader::XmlElement element);
+	// Parse character data and end tag of element.
+	bool parseContent(MarcXmlReader::XmlElement element, bool empty);
+	// Parse entity or character reference appending it to string.
+	bool parseReference(std::string &text);
+	// Check if namespace prefix of record element refers to MARCXML
+	// in document context.
+	bool isContextPrefix(void);
+
+public:
+	// Constructor.
+	MarcXmlPullParser();
+
+	// Set namespace prefixes referring to MARCXML in document context.
+	void setContextPrefixes(const std::vector<std::string> &prefixes);
+	// Parse record element (returns false if element must be parsed
+	// by MarcXmlReader).
+	bool parse(const char *data, size_t dataLen, MarcRecord &record);
+};
+
+} // namespace marcrecord
+
+#endif // MARCRECORD_MARCXML_PULL_PARSER_H
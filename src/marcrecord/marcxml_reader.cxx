@@ -26,16 +26,30 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <climits>
 #include <cstdio>
 #include <cstring>
 #include <iconv.h>
 #include <string>
 
 #include "marcrecord.h"
+#include "marcrecord_tools.h"
 #include "marcxml_reader.h"
 
 namespace marcrecord {
 
+#define INPUT_BUFFER_SIZE		(256 * 1024)
+#define XML_NAMESPACE_SEPARATOR		' '
+
+// Namespaces of MARCXML elements.
+static const char *marcXmlNamespaces[] = {
+	"http://www.loc.gov/MARC21/slim",
+	"http://www.rusmarc.ru/shema/UNISlim.xsd",
+	"info:lc/xmlns/marcxchange-v1",
+	"info:lc/xmlns/marcxchange-v2",
+	NULL
+};
+
 extern "C" { 
 // XML start element handler for expat library.
 void XMLCALL marcXmlStartElement(void *userData, const XML_Char *name,
@@ -49,6 +63,11 @@ int XMLCALL marcXmlUnknownEncoding(void *data, const XML_Char *encoding,
 	XML_Encoding *info);
 } // extern "C"
 
+// Get local part of element or attribute name.
+static const XML_Char *getLocalName(const XML_Char *name);
+// Get MARCXML element by its name.
+static MarcXmlReader::XmlElement getXmlElement(const XML_Char *name);
+
 } // namespace marcrecord
 
 using namespace marcrecord;
@@ -59,12 +78,18 @@ using namespace marcrecord;
 MarcXmlReader::MarcXmlReader(FILE *inputFile, const char *inputEncoding)
 	: MarcReader()
 {
+	// Clear member variables.
+	m_xmlParser = NULL;
+	m_bufferSize = INPUT_BUFFER_SIZE;
+	m_mapData = NULL;
+	m_mapSize = 0;
+	m_mapPos = 0;
+
 	if (inputFile) {
 		// Open input file and initialize parser.
 		open(inputFile, inputEncoding);
 	} else {
 		// Clear object state.
-		m_xmlParser = NULL;
 		close();
 	}
 }
@@ -88,12 +113,66 @@ MarcXmlReader::open(FILE *inputFile, const char *inputEncoding)
 	m_errorCode = OK;
 	m_errorMessage = "";
 
+	// Release memory-mapped input file.
+	unmapInput();
+
 	// Initialize input stream parameters.
 	m_inputFile = inputFile == NULL ? stdin : inputFile;
 	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
 
 	// Create XML parser.
-	m_xmlParser = XML_ParserCreate(inputEncoding);
+	initParser(inputEncoding);
+
+	return true;
+}
+
+/*
+ * Open input file by name and map it into memory.
+ */
+bool
+MarcXmlReader::openMapped(const char *inputFileName,
+	const char *inputEncoding)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Release previously memory-mapped input file.
+	unmapInput();
+
+	// Map input file into memory.
+	m_mapData = map_file(inputFileName, m_mapSize);
+	if (m_mapData == NULL) {
+		m_mapSize = 0;
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "can't map input file";
+		return false;
+	}
+
+	// Initialize input stream parameters.
+	m_inputFile = NULL;
+	m_inputEncoding = inputEncoding == NULL ? "" : inputEncoding;
+
+	// Create XML parser.
+	initParser(inputEncoding);
+
+	return true;
+}
+
+/*
+ * Create XML parser and initialize its state.
+ */
+void
+MarcXmlReader::initParser(const char *inputEncoding)
+{
+	// Free previously created XML parser.
+	if (m_xmlParser) {
+		XML_ParserFree(m_xmlParser);
+	}
+
+	// Create XML parser reporting names as namespace URI and local name.
+	m_xmlParser = XML_ParserCreateNS(inputEncoding,
+		XML_NAMESPACE_SEPARATOR);
 	XML_SetUserData(m_xmlParser, &m_parserState);
 	XML_SetElementHandler(m_xmlParser,
 		marcXmlStartElement, marcXmlEndElement);
@@ -105,11 +184,23 @@ MarcXmlReader::open(FILE *inputFile, const char *inputEncoding)
 	m_parserState.xmlParser = m_xmlParser;
 	m_parserState.done = false;
 	m_parserState.paused = false;
-	m_parserState.parentTag = "";
+	m_parserState.parentElement = ELEMENT_NONE;
 	m_parserState.record = NULL;
 	m_parserState.characterData.erase();
+}
 
-	return true;
+/*
+ * Release memory-mapped input file.
+ */
+void
+MarcXmlReader::unmapInput(void)
+{
+	if (m_mapData != NULL) {
+		unmap_file(m_mapData, m_mapSize);
+		m_mapData = NULL;
+	}
+	m_mapSize = 0;
+	m_mapPos = 0;
 }
 
 /*
@@ -123,6 +214,9 @@ MarcXmlReader::close(void)
 		XML_ParserFree(m_xmlParser);
 	}
 
+	// Release memory-mapped input file.
+	unmapInput();
+
 	// Clear member variables.
 	m_errorCode = OK;
 	m_errorMessage = "";
@@ -135,11 +229,44 @@ MarcXmlReader::close(void)
 	m_parserState.xmlParser = NULL;
 	m_parserState.done = false;
 	m_parserState.paused = false;
-	m_parserState.parentTag = "";
+	m_parserState.parentElement = ELEMENT_NONE;
 	m_parserState.record = NULL;
 	m_parserState.characterData.erase();
 }
 
+/*
+ * Set size of input blocks passed to parser.
+ */
+bool
+MarcXmlReader::setBufferSize(size_t bufferSize)
+{
+	// Check that block size fits into length argument of parser.
+	if (bufferSize == 0 || bufferSize > INT_MAX) {
+		m_errorCode = ERROR_IO;
+		m_errorMessage = "invalid buffer size";
+		return false;
+	}
+
+	m_bufferSize = bufferSize;
+
+	return true;
+}
+
+/*
+ * Check if URI is namespace of MARCXML elements.
+ */
+bool
+MarcXmlReader::isMarcXmlNamespace(const char *uri, size_t uriLen)
+{
+	for (const char **ns = marcXmlNamespaces; *ns != NULL; ns++) {
+		if (strncmp(uri, *ns, uriLen) == 0 && (*ns)[uriLen] == '\0') {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * Read next record from MARCXML file.
  */
@@ -162,19 +289,37 @@ MarcXmlReader::next(MarcRecord &record)
 			// Resume stopped parser.
 			m_parserState.paused = false;
 			parserResult = XML_ResumeParser(m_xmlParser);
-		} else {
-			// Read and parse buffer from file.
-			size_t dataLength = (int) fread(m_buffer,
-				1, sizeof(m_buffer), m_inputFile);
-			m_parserState.done = dataLength < sizeof(m_buffer);
+		} else if (m_mapData != NULL) {
+			// Parse next block of memory-mapped file.
+			size_t dataLength = m_mapSize - m_mapPos;
+			if (dataLength > m_bufferSize) {
+				dataLength = m_bufferSize;
+			}
+			m_parserState.done =
+				m_mapPos + dataLength == m_mapSize;
 			parserResult = XML_Parse(m_xmlParser,
-				m_buffer, dataLength, m_parserState.done);
+				m_mapData + m_mapPos, (int) dataLength,
+				m_parserState.done);
+			m_mapPos += dataLength;
+		} else {
+			// Read block from file directly into parser buffer.
+			void *buffer = XML_GetBuffer(m_xmlParser,
+				(int) m_bufferSize);
+			if (buffer == NULL) {
+				parserResult = XML_STATUS_ERROR;
+			} else {
+				size_t dataLength = fread(buffer, 1,
+					m_bufferSize, m_inputFile);
+				m_parserState.done = dataLength < m_bufferSize;
+				parserResult = XML_ParseBuffer(m_xmlParser,
+					(int) dataLength, m_parserState.done);
+			}
 		}
 
 		// Handle parser errors.
 		if (parserResult == XML_STATUS_ERROR) {
 			record.clear();
-			m_parserState.parentTag = "";
+			m_parserState.parentElement = ELEMENT_NONE;
 			m_errorCode = ERROR_XML_PARSER;
 			m_errorMessage =
 				XML_ErrorString(XML_GetErrorCode(m_xmlParser));
@@ -194,8 +339,131 @@ MarcXmlReader::next(MarcRecord &record)
 	return true;
 }
 
+/*
+ * Parse part of document preceding record elements.
+ */
+bool
+MarcXmlReader::parseContext(const char *data, size_t dataLen)
+{
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Create new parser and pass context to it without finishing document.
+	initParser(m_inputEncoding == "" ? NULL : m_inputEncoding.c_str());
+	if (XML_Parse(m_xmlParser, data, (int) dataLen, XML_FALSE)
+		!= XML_STATUS_OK)
+	{
+		m_errorCode = ERROR_XML_PARSER;
+		m_errorMessage =
+			XML_ErrorString(XML_GetErrorCode(m_xmlParser));
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Parse record element in context of document.
+ */
+bool
+MarcXmlReader::parseFragment(const char *data, size_t dataLen,
+	MarcRecord &record, bool &found)
+{
+	enum XML_Status parserResult;
+
+	// Clear error code and message.
+	m_errorCode = OK;
+	m_errorMessage = "";
+
+	// Clear record and initialize record pointer.
+	record.clear();
+	m_parserState.record = &record;
+	m_parserState.paused = false;
+
+	// Parse fragment, parser is paused at the end of record element.
+	parserResult = XML_Parse(m_xmlParser, data, (int) dataLen, XML_FALSE);
+	if (parserResult == XML_STATUS_SUSPENDED) {
+		parserResult = XML_ResumeParser(m_xmlParser);
+	}
+	found = m_parserState.paused;
+	m_parserState.paused = false;
+
+	// Handle parser errors.
+	if (parserResult == XML_STATUS_ERROR) {
+		record.clear();
+		m_parserState.parentElement = ELEMENT_NONE;
+		m_errorCode = ERROR_XML_PARSER;
+		m_errorMessage =
+			XML_ErrorString(XML_GetErrorCode(m_xmlParser));
+		return false;
+	}
+
+	return true;
+}
+
 namespace marcrecord {
 
+/*
+ * Get local part of element or attribute name.
+ */
+static const XML_Char *
+getLocalName(const XML_Char *name)
+{
+	// Skip namespace URI of qualified name.
+	const XML_Char *separator = strchr(name, XML_NAMESPACE_SEPARATOR);
+	return separator == NULL ? name : separator + 1;
+}
+
+/*
+ * Get MARCXML element by its name.
+ */
+static MarcXmlReader::XmlElement
+getXmlElement(const XML_Char *name)
+{
+	// Check namespace of qualified name.
+	const XML_Char *localName = getLocalName(name);
+	if (localName != name) {
+		if (!MarcXmlReader::isMarcXmlNamespace(name,
+			localName - name - 1))
+		{
+			return MarcXmlReader::ELEMENT_UNKNOWN;
+		}
+		name = localName;
+	}
+
+	// Select candidate element by first character of name.
+	switch (name[0]) {
+	case 'r':
+		if (strcmp(name, "record") == 0) {
+			return MarcXmlReader::ELEMENT_RECORD;
+		}
+		break;
+	case 'l':
+		if (strcmp(name, "leader") == 0) {
+			return MarcXmlReader::ELEMENT_LEADER;
+		}
+		break;
+	case 'c':
+		if (strcmp(name, "controlfield") == 0) {
+			return MarcXmlReader::ELEMENT_CONTROLFIELD;
+		}
+		break;
+	case 'd':
+		if (strcmp(name, "datafield") == 0) {
+			return MarcXmlReader::ELEMENT_DATAFIELD;
+		}
+		break;
+	case 's':
+		if (strcmp(name, "subfield") == 0) {
+			return MarcXmlReader::ELEMENT_SUBFIELD;
+		}
+		break;
+	}
+
+	return MarcXmlReader::ELEMENT_UNKNOWN;
+}
+
 /*
  * XML start element handler for expat library.
  */
@@ -205,76 +473,83 @@ marcXmlStartElement(void *userData, const XML_Char *name,
 {
 	MarcXmlReader::XmlParserState *parserState =
 		(MarcXmlReader::XmlParserState *) userData;
+	MarcXmlReader::XmlElement element = getXmlElement(name);
 
-	// Select MARCXML element.
-	if (strcmp(name, "record") == 0 && parserState->parentTag == "") {
-		// Set parent tag.
-		parserState->parentTag = name;
-	} else if (strcmp(name, "leader") == 0
-		&& parserState->parentTag == "record")
-	{
-		// Set parent tag.
-		parserState->parentTag = name;
-	} else if (strcmp(name, "controlfield") == 0
-		&& parserState->parentTag == "record")
-	{
-		// Get attribute 'tag' for control field.
-		char *tag = (char *) "";
+	// Clear character data.
+	parserState->characterData.clear();
 
-		for (int i = 0; atts[i]; i += 2) {
-			if (strcmp(atts[i], "tag") == 0) {
-				tag = (char *) atts[i + 1];
-			}
+	// Select MARCXML element allowed in current parent element.
+	switch (parserState->parentElement) {
+	case MarcXmlReader::ELEMENT_NONE:
+		if (element == MarcXmlReader::ELEMENT_RECORD) {
+			parserState->parentElement = element;
 		}
-
-		// Add control field to the record.
-		parserState->fieldIt =
-			parserState->record->addControlField(tag);
-		// Set parent tag.
-		parserState->parentTag = name;
-	} else if (strcmp(name, "datafield") == 0
-		&& parserState->parentTag == "record")
-	{
-		// Get attributes 'tag', 'ind1, 'ind2' for data field.
-		char *tag = (char *) "";
-		char ind1 = ' ', ind2 = ' ';
-
-		for (int i = 0; atts[i]; i += 2) {
-			if (strcmp(atts[i], "tag") == 0) {
-				tag = (char *) atts[i + 1];
-			} else if (strcmp(atts[i], "ind1") == 0) {
-				ind1 = atts[i + 1][0];
-			} else if (strcmp(atts[i], "ind2") == 0) {
-				ind2 = atts[i + 1][0];
+		break;
+	case MarcXmlReader::ELEMENT_RECORD:
+		if (element == MarcXmlReader::ELEMENT_LEADER) {
+			parserState->parentElement = element;
+		} else if (element == MarcXmlReader::ELEMENT_CONTROLFIELD) {
+			// Get attribute 'tag' for control field.
+			char *tag = (char *) "";
+
+			for (int i = 0; atts[i]; i += 2) {
+				const XML_Char *attName =
+					getLocalName(atts[i]);
+				if (strcmp(attName, "tag") == 0) {
+					tag = (char *) atts[i + 1];
+				}
 			}
-		}
-
-		// Add data field to the record.
-		parserState->fieldIt =
-			parserState->record->addDataField(tag, ind1, ind2);
-		// Set parent tag.
-		parserState->parentTag = name;
-	} else if (strcmp(name, "subfield") == 0
-		&& parserState->parentTag == "datafield")
-	{
-		// Get attribute 'code' for subfield.
-		char subfieldId = ' ';
 
-		for (int i = 0; atts[i]; i += 2) {
-			if (strcmp(atts[i], "code") == 0) {
-				subfieldId = atts[i + 1][0];
+			// Add control field to the record.
+			parserState->fieldIt =
+				parserState->record->addControlField(tag);
+			parserState->parentElement = element;
+		} else if (element == MarcXmlReader::ELEMENT_DATAFIELD) {
+			// Get attributes 'tag', 'ind1, 'ind2' for data field.
+			char *tag = (char *) "";
+			char ind1 = ' ', ind2 = ' ';
+
+			for (int i = 0; atts[i]; i += 2) {
+				const XML_Char *attName =
+					getLocalName(atts[i]);
+				if (strcmp(attName, "tag") == 0) {
+					tag = (char *) atts[i + 1];
+				} else if (strcmp(attName, "ind1") == 0) {
+					ind1 = atts[i + 1][0];
+				} else if (strcmp(attName, "ind2") == 0) {
+					ind2 = atts[i + 1][0];
+				}
 			}
+
+			// Add data field to the record.
+			parserState->fieldIt =
+				parserState->record->addDataField(tag,
+				ind1, ind2);
+			parserState->parentElement = element;
 		}
+		break;
+	case MarcXmlReader::ELEMENT_DATAFIELD:
+		if (element == MarcXmlReader::ELEMENT_SUBFIELD) {
+			// Get attribute 'code' for subfield.
+			char subfieldId = ' ';
+
+			for (int i = 0; atts[i]; i += 2) {
+				const XML_Char *attName =
+					getLocalName(atts[i]);
+				if (strcmp(attName, "code") == 0) {
+					subfieldId = atts[i + 1][0];
+				}
+			}
 
-		// Add subfield to the data field.
-		parserState->subfieldIt =
-			parserState->fieldIt->addSubfield(subfieldId);
-		// Set parent tag.
-		parserState->parentTag = name;
+			// Add subfield to the data field.
+			parserState->subfieldIt =
+				parserState->fieldIt->addSubfield(subfieldId);
+			parserState->parentElement = element;
+		}
+		break;
+	default:
+		break;
 	}
-
-	// Clear character data.
-	parserState->characterData.erase();
 }
 
 /*
@@ -286,36 +561,39 @@ marcXmlEndElement(void *userData, const XML_Char *name)
 	MarcXmlReader::XmlParserState *parserState =
 		(MarcXmlReader::XmlParserState *) userData;
 
-	// Check if start and end tags are equal.
-	if (parserState->parentTag != name) {
+	// Check if start and end elements are equal.
+	if (getXmlElement(name) != parserState->parentElement) {
 		return;
 	}
 
-	// Select MARCXML element.
-	if (strcmp(name, "record") == 0) {
-		// Restore parent tag.
-		parserState->parentTag = "";
+	// Select MARCXML element and restore its parent element.
+	switch (parserState->parentElement) {
+	case MarcXmlReader::ELEMENT_RECORD:
+		parserState->parentElement = MarcXmlReader::ELEMENT_NONE;
 		// Pause parser.
 		parserState->paused = true;
 		XML_StopParser(parserState->xmlParser, XML_TRUE);
-	} else if (strcmp(name, "leader") == 0) {
-		// Restore parent tag.
-		parserState->parentTag = "record";
+		break;
+	case MarcXmlReader::ELEMENT_LEADER:
+		parserState->parentElement = MarcXmlReader::ELEMENT_RECORD;
 		// Set record leader.
 		parserState->record->setLeader(parserState->characterData);
-	} else if (strcmp(name, "controlfield") == 0) {
-		// Restore parent tag.
-		parserState->parentTag = "record";
+		break;
+	case MarcXmlReader::ELEMENT_CONTROLFIELD:
+		parserState->parentElement = MarcXmlReader::ELEMENT_RECORD;
 		// Set data of control field.
 		parserState->fieldIt->setData(parserState->characterData);
-	} else if (strcmp(name, "datafield") == 0) {
-		// Restore parent tag.
-		parserState->parentTag = "record";
-	} else if (strcmp(name, "subfield") == 0) {
-		// Restore parent tag.
-		parserState->parentTag = "datafield";
+		break;
+	case MarcXmlReader::ELEMENT_DATAFIELD:
+		parserState->parentElement = MarcXmlReader::ELEMENT_RECORD;
+		break;
+	case MarcXmlReader::ELEMENT_SUBFIELD:
+		parserState->parentElement = MarcXmlReader::ELEMENT_DATAFIELD;
 		// Set data of subfield.
 		parserState->subfieldIt->setData(parserState->characterData);
+		break;
+	default:
+		break;
 	}
 }
 
@@ -328,7 +606,16 @@ marcXmlCharacterData(void *userData, const XML_Char *s, int len)
 	MarcXmlReader::XmlParserState *parserState =
 		(MarcXmlReader::XmlParserState *) userData;
 
-	parserState->characterData.append(s, len);
+	// Keep only data of elements containing text.
+	switch (parserState->parentElement) {
+	case MarcXmlReader::ELEMENT_LEADER:
+	case MarcXmlReader::ELEMENT_CONTROLFIELD:
+	case MarcXmlReader::ELEMENT_SUBFIELD:
+		parserState->characterData.append(s, len);
+		break;
+	default:
+		break;
+	}
 }
 
 /*
@@ -360,7 +647,7 @@ marcXmlUnknownEncoding(void *data, const XML_Char *encoding,
 		size_t srcLen = 1;
 		size_t destLen = sizeof(iconvBuf);
 
-		if (iconv(iconvDesc, &src, &srcLen, &dest, &destLen)
+		if (::iconv(iconvDesc, &src, &srcLen, &dest, &destLen)
 			== (size_t) -1)
 		{
 			info->map[i] = -1;
@@ -40,13 +40,28 @@ namespace marcrecord {
  * MARCXML records reader.
  */
 class MarcXmlReader : public MarcReader {
+	// Parallel MARCXML reader class.
+	friend class MarcXmlParallelReader;
+
 public:
+	// MARCXML elements.
+	enum XmlElement {
+		ELEMENT_NONE,
+		ELEMENT_RECORD,
+		ELEMENT_LEADER,
+		ELEMENT_CONTROLFIELD,
+		ELEMENT_DATAFIELD,
+		ELEMENT_SUBFIELD,
+		ELEMENT_UNKNOWN
+	};
+	typedef enum XmlElement XmlElement;
+
 	// XML parser state structure definition.
 	struct XmlParserState {
 		XML_Parser xmlParser;
 		bool done;
 		bool paused;
-		std::string parentTag;
+		XmlElement parentElement;
 
 		MarcRecord *record;
 		MarcRecord::FieldIt fieldIt;
@@ -60,8 +75,26 @@ protected:
 	XML_Parser m_xmlParser;
 	// XML parser state.
 	XmlParserState m_parserState;
-	// Record buffer.
-	char m_buffer[4096];
+	// Size of input blocks passed to parser.
+	size_t m_bufferSize;
+
+	// Memory-mapped input file data.
+	const char *m_mapData;
+	// Size of memory-mapped input file.
+	size_t m_mapSize;
+	// Position of unparsed data in memory-mapped input file.
+	size_t m_mapPos;
+
+private:
+	// Create XML parser and initialize its state.
+	void initParser(const char *inputEncoding);
+	// Release memory-mapped input file.
+	void unmapInput(void);
+	// Parse part of document preceding record elements.
+	bool parseContext(const char *data, size_t dataLen);
+	// Parse record element in context of document.
+	bool parseFragment(const char *data, size_t dataLen,
+		MarcRecord &record, bool &found);
 
 public:
 	// Constructor.
@@ -72,10 +105,18 @@ public:
 
 	// Open input file and initialize parser.
 	bool open(FILE *inputFile, const char *inputEncoding = NULL);
+	// Open input file by name and map it into memory.
+	bool openMapped(const char *inputFileName,
+		const char *inputEncoding = NULL);
 	// Close input file and finalize parser.
 	void close(void);
+	// Set size of input blocks passed to parser.
+	bool setBufferSize(size_t bufferSize);
 	// Read next record from file.
 	bool next(MarcRecord &record);
+
+	// Check if URI is namespace of MARCXML elements.
+	static bool isMarcXmlNamespace(const char *uri, size_t uriLen);
 };
 
 } // namespace marcrecord
@@ -68,9 +68,8 @@ MarcXmlWriter::~MarcXmlWriter()
 bool
 MarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 {
-	// Clear error code and message.
-	m_errorCode = OK;
-	m_errorMessage = "";
+	// Close previous output file, writing its buffered data.
+	close();
 
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
@@ -95,6 +94,9 @@ MarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 			}
 			return false;
 		}
+
+		// Initialize converter for single-byte encoding.
+		m_codec.init(outputEncoding);
 	}
 
 	return true;
@@ -106,6 +108,9 @@ MarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 void
 MarcXmlWriter::close(void)
 {
+	// Write buffered data.
+	flushBuffer();
+
 	// Finalize iconv.
 	if (m_iconvDesc != (iconv_t) -1) {
 		iconv_close(m_iconvDesc);
@@ -117,6 +122,7 @@ MarcXmlWriter::close(void)
 	m_outputFile = NULL;
 	m_outputEncoding = "";
 	m_iconvDesc = (iconv_t) -1;
+	m_codec.clear();
 }
 
 /*
@@ -125,34 +131,53 @@ MarcXmlWriter::close(void)
 bool
 MarcXmlWriter::write(MarcRecord &record)
 {
-	std::string recordBuf = "";
+	// Reserve record buffer for data and markup of fields.
+	record.decodeFields();
+	size_t recordSize = 64;
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		recordSize += 64 + fieldIt->m_data.size();
+		for (MarcRecord::SubfieldIt subfieldIt =
+			fieldIt->m_subfieldList.begin();
+			subfieldIt != fieldIt->m_subfieldList.end();
+			subfieldIt++)
+		{
+			recordSize += 40 + subfieldIt->m_data.size();
+		}
+	}
+	m_recordBuf.erase();
+	m_recordBuf.reserve(recordSize);
 
 	// Append tag '<record>'.
-	recordBuf += "  <record>\n";
+	m_recordBuf += "  <record>\n";
 
 	// Append record leader.
-	recordBuf += "    <leader>     "
-		+ std::string((char *) &record.m_leader + 5,
-		(size_t) sizeof(MarcRecord::Leader) - 5)
-		+ "</leader>\n";
+	m_recordBuf += "    <leader>     ";
+	m_recordBuf.append((char *) &record.m_leader + 5,
+		sizeof(MarcRecord::Leader) - 5);
+	m_recordBuf += "</leader>\n";
 
 	// Iterate all fields.
 	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
 		fieldIt != record.m_fieldList.end(); fieldIt++)
 	{
-		std::string xmlData;
-
-		if (fieldIt->m_tag < "010") {
+		if (fieldIt->m_tag.isControlTag()) {
 			// Append control field.
-			xmlData = serialize_xml(fieldIt->m_data);
-			recordBuf += "    <controlfield tag=\""
-				+ fieldIt->m_tag + "\">"
-				+ xmlData + "</controlfield>\n";
+			m_recordBuf += "    <controlfield tag=\"";
+			m_recordBuf += fieldIt->m_tag.c_str();
+			m_recordBuf += "\">";
+			serialize_xml(fieldIt->m_data, m_recordBuf);
+			m_recordBuf += "</controlfield>\n";
 		} else {
 			// Append tag '<datafield>'.
-			recordBuf += "    <datafield tag=\"" + fieldIt->m_tag
-				+ "\" ind1=\"" + fieldIt->m_ind1
-				+ "\" ind2=\"" + fieldIt->m_ind2 + "\">\n";
+			m_recordBuf += "    <datafield tag=\"";
+			m_recordBuf += fieldIt->m_tag.c_str();
+			m_recordBuf += "\" ind1=\"";
+			m_recordBuf += fieldIt->m_ind1;
+			m_recordBuf += "\" ind2=\"";
+			m_recordBuf += fieldIt->m_ind2;
+			m_recordBuf += "\">\n";
 
 			// Iterate all subfields.
 			MarcRecord::SubfieldIt subfieldIt =
@@ -161,43 +186,37 @@ MarcXmlWriter::write(MarcRecord &record)
 				subfieldIt++)
 			{
 				// Append subfield.
-				xmlData = serialize_xml(subfieldIt->m_data);
-				recordBuf = recordBuf
-					+ "      <subfield code=\""
-					+ subfieldIt->m_id + "\">"
-					+ xmlData + "</subfield>\n";
+				m_recordBuf += "      <subfield code=\"";
+				m_recordBuf += subfieldIt->m_id;
+				m_recordBuf += "\">";
+				serialize_xml(subfieldIt->m_data, m_recordBuf);
+				m_recordBuf += "</subfield>\n";
 			}
 
 			// Append tag '</datafield>'.
-			recordBuf += "    </datafield>\n";
+			m_recordBuf += "    </datafield>\n";
 		}
 	}
 
 	// Append tag '<record>'.
-	recordBuf += "  </record>\n";
+	m_recordBuf += "  </record>\n";
 
 	if (m_iconvDesc == (iconv_t) -1) {
 		// Write MARCXML record.
-		if (fwrite(recordBuf.c_str(), recordBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(m_recordBuf)) {
 			return false;
 		}
 	} else {
 		// Write MARCXML record with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, recordBuf, iconvBuf)) {
+		if (!m_codec.encode(m_recordBuf.data(), m_recordBuf.size(),
+			m_iconvBuf)
+			&& !iconv(m_iconvDesc, m_recordBuf, m_iconvBuf))
+		{
 			m_errorCode = ERROR_ICONV;
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(m_iconvBuf)) {
 			return false;
 		}
 	}
@@ -225,11 +244,7 @@ MarcXmlWriter::writeHeader(void)
 
 	if (m_iconvDesc == (iconv_t) -1) {
 		// Write MARCXML header.
-		if (fwrite(header.c_str(), header.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(header)) {
 			return false;
 		}
 	} else {
@@ -240,11 +255,7 @@ MarcXmlWriter::writeHeader(void)
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(iconvBuf)) {
 			return false;
 		}
 	}
@@ -262,11 +273,7 @@ MarcXmlWriter::writeFooter(void)
 
 	if (m_iconvDesc == (iconv_t) -1) {
 		// Write MARCXML footer.
-		if (fwrite(footer.c_str(), footer.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(footer)) {
 			return false;
 		}
 	} else {
@@ -277,11 +284,7 @@ MarcXmlWriter::writeFooter(void)
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(iconvBuf)) {
 			return false;
 		}
 	}
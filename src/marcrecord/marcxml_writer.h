@@ -33,6 +33,7 @@
 #include <string>
 #include "marc_writer.h"
 #include "marcrecord.h"
+#include "marcrecord_codec.h"
 
 namespace marcrecord {
 
@@ -43,6 +44,13 @@ class MarcXmlWriter : public MarcWriter {
 protected:
 	// Iconv descriptor for output encoding.
 	iconv_t m_iconvDesc;
+	// Converter for single-byte output encoding.
+	SingleByteCodec m_codec;
+
+	// Buffer of record data.
+	std::string m_recordBuf;
+	// Buffer of record data in output encoding.
+	std::string m_iconvBuf;
 
 public:
 	// Constructor.
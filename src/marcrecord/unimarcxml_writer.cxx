@@ -69,9 +69,8 @@ UnimarcXmlWriter::~UnimarcXmlWriter()
 bool
 UnimarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 {
-	// Clear error code and message.
-	m_errorCode = OK;
-	m_errorMessage = "";
+	// Close previous output file, writing its buffered data.
+	close();
 
 	// Initialize output stream parameters.
 	m_outputFile = outputFile == NULL ? stdout : outputFile;
@@ -96,6 +95,9 @@ UnimarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 			}
 			return false;
 		}
+
+		// Initialize converter for single-byte encoding.
+		m_codec.init(outputEncoding);
 	}
 
 	return true;
@@ -107,6 +109,9 @@ UnimarcXmlWriter::open(FILE *outputFile, const char *outputEncoding)
 void
 UnimarcXmlWriter::close(void)
 {
+	// Write buffered data.
+	flushBuffer();
+
 	// Finalize iconv.
 	if (m_iconvDesc != (iconv_t) -1) {
 		iconv_close(m_iconvDesc);
@@ -118,6 +123,7 @@ UnimarcXmlWriter::close(void)
 	m_outputFile = NULL;
 	m_outputEncoding = "";
 	m_iconvDesc = (iconv_t) -1;
+	m_codec.clear();
 }
 
 /*
@@ -126,60 +132,69 @@ UnimarcXmlWriter::close(void)
 bool
 UnimarcXmlWriter::write(MarcRecord &record)
 {
-	std::string recordBuf = "";
+	// Reserve record buffer for data and markup of fields.
+	record.decodeFields();
+	size_t recordSize = 64;
+	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
+		fieldIt != record.m_fieldList.end(); fieldIt++)
+	{
+		recordSize += 64 + fieldIt->m_data.size();
+		for (MarcRecord::SubfieldIt subfieldIt =
+			fieldIt->m_subfieldList.begin();
+			subfieldIt != fieldIt->m_subfieldList.end();
+			subfieldIt++)
+		{
+			recordSize += 48 + subfieldIt->m_data.size();
+		}
+	}
+	m_recordBuf.erase();
+	m_recordBuf.reserve(recordSize);
 
 	// Append tag '<record>'.
-	recordBuf += "  <record>\n";
+	m_recordBuf += "  <record>\n";
 
 	// Append record leader.
-	recordBuf += "    <leader>     "
-		+ std::string((char *) &record.m_leader + 5,
-		(size_t) sizeof(MarcRecord::Leader) - 5)
-		+ "</leader>\n";
+	m_recordBuf += "    <leader>     ";
+	m_recordBuf.append((char *) &record.m_leader + 5,
+		sizeof(MarcRecord::Leader) - 5);
+	m_recordBuf += "</leader>\n";
 
 	// Iterate all fields.
 	for (MarcRecord::FieldIt fieldIt = record.m_fieldList.begin();
 		fieldIt != record.m_fieldList.end(); fieldIt++)
 	{
-		std::string xmlData;
-
-		if (fieldIt->m_tag < "010") {
+		if (fieldIt->m_tag.isControlTag()) {
 			// Append control field.
-			xmlData = serialize_xml(fieldIt->m_data);
-			recordBuf += "    <controlfield tag=\""
-				+ fieldIt->m_tag + "\">"
-				+ xmlData + "</controlfield>\n";
+			m_recordBuf += "    <controlfield tag=\"";
+			m_recordBuf += fieldIt->m_tag.c_str();
+			m_recordBuf += "\">";
+			serialize_xml(fieldIt->m_data, m_recordBuf);
+			m_recordBuf += "</controlfield>\n";
 		} else {
 			// Append data field.
-			appendDataField(recordBuf, fieldIt);
+			appendDataField(m_recordBuf, fieldIt);
 		}
 	}
 
 	// Append tag '<record>'.
-	recordBuf += "  </record>\n";
+	m_recordBuf += "  </record>\n";
 
 	if (m_iconvDesc == (iconv_t) -1) {
 		// Write UNIMARCXML record.
-		if (fwrite(recordBuf.c_str(), recordBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(m_recordBuf)) {
 			return false;
 		}
 	} else {
 		// Write UNIMARCXML record with encoding conversion.
-		std::string iconvBuf;
-		if (!iconv(m_iconvDesc, recordBuf, iconvBuf)) {
+		if (!m_codec.encode(m_recordBuf.data(), m_recordBuf.size(),
+			m_iconvBuf)
+			&& !iconv(m_iconvDesc, m_recordBuf, m_iconvBuf))
+		{
 			m_errorCode = ERROR_ICONV;
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(m_iconvBuf)) {
 			return false;
 		}
 	}
@@ -208,11 +223,7 @@ UnimarcXmlWriter::writeHeader(void)
 
 	if (m_iconvDesc == (iconv_t) -1) {
 		// Write UNIMARCXML header.
-		if (fwrite(header.c_str(), header.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(header)) {
 			return false;
 		}
 	} else {
@@ -223,11 +234,7 @@ UnimarcXmlWriter::writeHeader(void)
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(iconvBuf)) {
 			return false;
 		}
 	}
@@ -245,11 +252,7 @@ UnimarcXmlWriter::writeFooter(void)
 
 	if (m_iconvDesc == (iconv_t) -1) {
 		// Write UNIMARCXML footer.
-		if (fwrite(footer.c_str(), footer.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(footer)) {
 			return false;
 		}
 	} else {
@@ -260,11 +263,7 @@ UnimarcXmlWriter::writeFooter(void)
 			m_errorMessage = "encoding conversion failed";
 			return false;
 		}
-		if (fwrite(iconvBuf.c_str(), iconvBuf.size(), 1,
-			m_outputFile) != 1)
-		{
-			m_errorCode = ERROR_IO;
-			m_errorMessage = "i/o operation failed";
+		if (!writeData(iconvBuf)) {
 			return false;
 		}
 	}
@@ -280,9 +279,13 @@ UnimarcXmlWriter::appendDataField(std::string &recordBuf,
 	MarcRecord::FieldIt &fieldIt)
 {
 	// Append tag '<datafield>'.
-	recordBuf += "    <datafield tag=\"" + fieldIt->m_tag
-		+ "\" ind1=\"" + fieldIt->m_ind1
-		+ "\" ind2=\"" + fieldIt->m_ind2 + "\">\n";
+	recordBuf += "    <datafield tag=\"";
+	recordBuf += fieldIt->m_tag.c_str();
+	recordBuf += "\" ind1=\"";
+	recordBuf += fieldIt->m_ind1;
+	recordBuf += "\" ind2=\"";
+	recordBuf += fieldIt->m_ind2;
+	recordBuf += "\">\n";
 
 	// Iterate all subfields.
 	MarcRecord::SubfieldIt subfieldIt = fieldIt->m_subfieldList.begin();
@@ -290,40 +293,35 @@ UnimarcXmlWriter::appendDataField(std::string &recordBuf,
 	for (; subfieldIt != fieldIt->m_subfieldList.end();
 		subfieldIt++)
 	{
-		std::string xmlData;
-
 		if (subfieldIt->isEmbedded()) {
 			if (isEmbeddedDataField) {
 				// Append embedded data field footer.
-				recordBuf = recordBuf
-					+ "        </datafield>\n"
-					+ "      </s1>\n";
+				recordBuf += "        </datafield>\n";
+				recordBuf += "      </s1>\n";
 			}
 
 			// Append embedded field header.
 			std::string embeddedTag = subfieldIt->getEmbeddedTag();
 			if (embeddedTag < "010") {
 				// Append embedded control field.
-				std::string embeddedData =
-					subfieldIt->getEmbeddedData();
-				xmlData = serialize_xml(embeddedData);
-				recordBuf = recordBuf
-					+ "      <s1>\n"
-					+ "        <controlfield tag=\""
-					+ embeddedTag + "\">"
-					+ xmlData + "</controlfield>\n"
-					+ "      </s1>\n";
+				recordBuf += "      <s1>\n";
+				recordBuf += "        <controlfield tag=\"";
+				recordBuf += embeddedTag;
+				recordBuf += "\">";
+				serialize_xml(subfieldIt->getEmbeddedData(),
+					recordBuf);
+				recordBuf += "</controlfield>\n";
+				recordBuf += "      </s1>\n";
 				isEmbeddedDataField = false;
 			} else {
-				recordBuf = recordBuf
-					+ "      <s1>\n"
-					+ "        <datafield tag=\""
-					+ embeddedTag
-					+ "\" ind1=\""
-					+ subfieldIt->getEmbeddedInd1()
-					+ "\" ind2=\""
-					+ subfieldIt->getEmbeddedInd2()
-					+ "\">\n";
+				recordBuf += "      <s1>\n";
+				recordBuf += "        <datafield tag=\"";
+				recordBuf += embeddedTag;
+				recordBuf += "\" ind1=\"";
+				recordBuf += subfieldIt->getEmbeddedInd1();
+				recordBuf += "\" ind2=\"";
+				recordBuf += subfieldIt->getEmbeddedInd2();
+				recordBuf += "\">\n";
 				isEmbeddedDataField = true;
 			}
 			continue;
@@ -335,18 +333,17 @@ UnimarcXmlWriter::appendDataField(std::string &recordBuf,
 		}
 
 		// Append subfield.
-		xmlData = serialize_xml(subfieldIt->m_data);
-		recordBuf = recordBuf
-			+ "      <subfield code=\""
-			+ subfieldIt->m_id + "\">"
-			+ xmlData + "</subfield>\n";
+		recordBuf += "      <subfield code=\"";
+		recordBuf += subfieldIt->m_id;
+		recordBuf += "\">";
+		serialize_xml(subfieldIt->m_data, recordBuf);
+		recordBuf += "</subfield>\n";
 	}
 
 	// Append embedded data field footer.
 	if (isEmbeddedDataField) {
-		recordBuf = recordBuf
-			+ "        </datafield>\n"
-			+ "      </s1>\n";
+		recordBuf += "        </datafield>\n";
+		recordBuf += "      </s1>\n";
 	}
 
 	// Append tag '</datafield>'.
@@ -26,13 +26,20 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <stdio.h>
+#include "flat_marcrecord.h"
 #include "marcrecord.h"
 #include "marc_reader.h"
+#include "marciso_parallel_reader.h"
 // #include "marc_writer.h"
 #include "marciso_reader.h"
 #include "marciso_writer.h"
+#include "marcrecord_charset.h"
+#include "marcrecord_codec.h"
+#include "marcrecord_view.h"
 #include "marctext_writer.h"
+#include "marcxml_parallel_reader.h"
 #include "marcxml_reader.h"
 #include "marcxml_writer.h"
 #include "unimarcxml_writer.h"
@@ -102,6 +109,29 @@ createRecord2(void)
 	return record;
 }
 
+/*
+ * Count records passed by parallel reader.
+ */
+bool
+countRecord(MarcRecord &record, void *userData)
+{
+	(void) record;
+	(*(int *) userData)++;
+
+	return true;
+}
+
+/*
+ * Count record passed by parallel reader and stop reading.
+ */
+bool
+stopReading(MarcRecord &record, void *userData)
+{
+	countRecord(record, userData);
+
+	return false;
+}
+
 bool
 test1(void)
 {
@@ -760,9 +790,1787 @@ test15(void)
 	return true;
 }
 
-/*
- * Main function.
- */
+bool
+test16(void)
+{
+	printf("[16] MarcIsoReader with memory-mapped input file\n");
+
+	try {
+		// Initialize ISO 2709 reader for memory-mapped file.
+		MarcIsoReader marcIsoReader;
+		if (!marcIsoReader.openMapped("test_003.iso", "CP1251")) {
+			throw marcIsoReader.getErrorMessage();
+		}
+
+		// Read records.
+		MarcRecord record(MarcRecord::UNIMARC);
+		while (marcIsoReader.next(record)) {
+			printf("%s\n", record.toString().c_str());
+		}
+
+		// Check error code.
+		if (marcIsoReader.getErrorCode() != MarcReader::END_OF_FILE) {
+			throw marcIsoReader.getErrorMessage();
+		}
+	} catch (std::string errorMessage) {
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test17(void)
+{
+	FILE *inputFile = NULL;
+
+	printf("[17] MarcIsoReader with MarcRecordView\n");
+
+	try {
+		// Open ISO 2709 file.
+		inputFile = fopen("test_003.iso", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+
+		// Initialize ISO 2709 reader.
+		MarcIsoReader marcIsoReader(inputFile);
+
+		// Read records without decoding of fields.
+		MarcRecordView recordView;
+		while (marcIsoReader.next(recordView)) {
+			printf("Fields: %u\n",
+				(unsigned int) recordView.getFieldCount());
+
+			// Print data of control field 001.
+			int fieldNo = recordView.findField("001");
+			if (fieldNo >= 0) {
+				MarcRecordView::Slice fieldData =
+					recordView.getFieldData(fieldNo);
+				printf("Field 001: '%.*s'\n",
+					(int) fieldData.size, fieldData.data);
+			}
+
+			// Print subfields $a of data fields 200 and 201.
+			fieldNo = recordView.findField("200");
+			if (fieldNo < 0) {
+				fieldNo = recordView.findField("201");
+			}
+			MarcRecordView::Slice subfieldData;
+			if (fieldNo >= 0 && recordView.getSubfield(fieldNo, 'a',
+				subfieldData))
+			{
+				printf("Subfield %.3s $a: '%.*s'\n",
+					recordView.getTag(fieldNo).data,
+					(int) subfieldData.size,
+					subfieldData.data);
+			}
+		}
+
+		// Check error code.
+		if (marcIsoReader.getErrorCode() != MarcReader::END_OF_FILE) {
+			throw marcIsoReader.getErrorMessage();
+		}
+
+		// Close ISO 2709 file.
+		fclose(inputFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test18(void)
+{
+	FILE *inputFile = NULL;
+
+	printf("[18] MarcIsoParallelReader\n");
+
+	try {
+		// Open ISO 2709 file.
+		inputFile = fopen("test_003.iso", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+
+		// Initialize parallel ISO 2709 reader.
+		MarcIsoParallelReader marcIsoReader(inputFile, "CP1251", 2);
+
+		// Read records in original order.
+		MarcRecord record(MarcRecord::UNIMARC);
+		int totalRecords = 0;
+		while (marcIsoReader.next(record)) {
+			printf("%s\n", record.toString().c_str());
+			totalRecords++;
+		}
+
+		// Check error code.
+		if (marcIsoReader.getErrorCode() != MarcReader::END_OF_FILE) {
+			throw marcIsoReader.getErrorMessage();
+		}
+
+		// Read rest of records in unordered mode after next().
+		rewind(inputFile);
+		marcIsoReader.open(inputFile, "CP1251");
+		marcIsoReader.setBatchSize(1);
+		int numRecords = 0;
+		if (!marcIsoReader.next(record)
+			|| !marcIsoReader.read(countRecord, &numRecords, false)
+			|| numRecords != 1)
+		{
+			throw std::string("records read ahead are lost");
+		}
+
+		// Read all records in unordered mode by single record
+		// batches.
+		rewind(inputFile);
+		marcIsoReader.open(inputFile, "CP1251");
+		numRecords = 0;
+		if (!marcIsoReader.read(countRecord, &numRecords, false)
+			|| numRecords != totalRecords)
+		{
+			throw std::string("records are lost in unordered mode");
+		}
+
+		// Read records after stop of unordered mode.
+		rewind(inputFile);
+		marcIsoReader.open(inputFile, "CP1251");
+		numRecords = 0;
+		if (!marcIsoReader.read(stopReading, &numRecords, false)) {
+			throw marcIsoReader.getErrorMessage();
+		}
+		while (marcIsoReader.next(record)) {
+			numRecords++;
+		}
+		if (numRecords != totalRecords) {
+			throw std::string("records read ahead by unordered "
+				"mode are lost");
+		}
+
+		// Close ISO 2709 file.
+		fclose(inputFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test19(void)
+{
+	FILE *inputFile = NULL;
+	FILE *outputFile = NULL;
+
+	printf("[19] MarcIsoReader and MarcIsoWriter with FlatMarcRecord\n");
+
+	try {
+		// Open ISO 2709 files.
+		inputFile = fopen("test_003.iso", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+		outputFile = fopen("test_019.iso", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+
+		// Initialize ISO 2709 reader and writer.
+		MarcIsoReader marcIsoReader(inputFile, "CP1251");
+		MarcIsoWriter marcIsoWriter(outputFile, "CP1251");
+
+		// Read records to record with contiguous storage.
+		FlatMarcRecord record(MarcRecord::UNIMARC);
+		std::vector<std::string> textRecords;
+		std::vector<MarcRecord::Leader> leaders;
+		while (marcIsoReader.next(record)) {
+			// Check conversion to regular record.
+			MarcRecord marcRecord;
+			record.toMarcRecord(marcRecord);
+			if (marcRecord.toString() != record.toString()) {
+				throw std::string("record conversion failed");
+			}
+
+			// Check data access without copying.
+			FlatMarcRecord::FieldIt fieldIt =
+				record.getField("001");
+			FlatMarcRecord::Slice data;
+			if (fieldIt != record.nullField()) {
+				data = record.getDataSlice(fieldIt);
+				if (std::string(data.data, data.size)
+					!= record.getData(fieldIt))
+				{
+					throw std::string("invalid data of "
+						"control field");
+				}
+			}
+			fieldIt = record.getField("201");
+			if (fieldIt != record.nullField()) {
+				FlatMarcRecord::SubfieldIt subfieldIt =
+					record.firstSubfield(fieldIt);
+				data = record.getSubfieldDataSlice(subfieldIt);
+				if (std::string(data.data, data.size)
+					!= record.getSubfieldData(subfieldIt))
+				{
+					throw std::string("invalid data of "
+						"subfield");
+				}
+			}
+
+			// Edit record.
+			fieldIt = record.getField("200");
+			if (fieldIt != record.nullField()) {
+				record.addSubfieldBefore(fieldIt,
+					record.getSubfield(fieldIt, 'b'),
+					'e', "added");
+				record.removeSubfield(fieldIt,
+					record.getSubfield(fieldIt, 'a'));
+			}
+			fieldIt = record.addControlFieldBefore(
+				record.firstField(), "005", "20130101");
+			record.removeField(record.nextField(fieldIt));
+			if (record.firstSubfield(record.getField("999"))
+				!= record.nullSubfield())
+			{
+				throw std::string("invalid subfield of "
+					"null field");
+			}
+
+			// Check replacing data in place and reclaiming
+			// data buffer.
+			std::string textRecord = record.toString();
+			data = record.getDataSlice(fieldIt);
+			record.setData(fieldIt, "20140101");
+			if (record.getDataSlice(fieldIt).data != data.data) {
+				throw std::string("data of control field "
+					"is not replaced in place");
+			}
+			for (int i = 0; i < 100; i++) {
+				record.setData(fieldIt,
+					std::string(i + 9, '0'));
+			}
+			record.setData(fieldIt, "20130101");
+			if (record.toString() != textRecord) {
+				throw std::string("record is damaged by "
+					"replacing data");
+			}
+
+			// Write record.
+			if (!marcIsoWriter.write(record)) {
+				throw marcIsoWriter.getErrorMessage();
+			}
+			textRecords.push_back(textRecord);
+			leaders.push_back(record.getLeader());
+
+			// Print record.
+			printf("%s\n", textRecord.c_str());
+		}
+
+		// Check error code.
+		if (marcIsoReader.getErrorCode() != MarcReader::END_OF_FILE) {
+			throw marcIsoReader.getErrorMessage();
+		}
+
+		// Close ISO 2709 files.
+		fclose(inputFile);
+		inputFile = NULL;
+		marcIsoWriter.close();
+		fclose(outputFile);
+		outputFile = NULL;
+
+		// Check written records.
+		inputFile = fopen("test_019.iso", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open written file");
+		}
+		marcIsoReader.open(inputFile, "CP1251");
+		MarcRecord marcRecord;
+		size_t recordCount = 0;
+		while (marcIsoReader.next(marcRecord)) {
+			if (recordCount >= textRecords.size()) {
+				throw std::string("invalid number of "
+					"written records");
+			}
+			marcRecord.setLeader(leaders[recordCount]);
+			if (marcRecord.toString()
+				!= textRecords[recordCount])
+			{
+				throw std::string("invalid written record");
+			}
+			recordCount++;
+		}
+		if (marcIsoReader.getErrorCode() != MarcReader::END_OF_FILE) {
+			throw marcIsoReader.getErrorMessage();
+		}
+		if (recordCount != textRecords.size()) {
+			throw std::string("invalid number of "
+				"written records");
+		}
+		fclose(inputFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (inputFile) {
+			fclose(inputFile);
+		}
+		if (outputFile) {
+			fclose(outputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test20(void)
+{
+	printf("[20] Reuse of removed fields and subfields\n");
+
+	try {
+		// Create new MARC record and its copy.
+		MarcRecord record = createRecord1();
+		MarcRecord recordCopy(record);
+		std::string recordText = record.toString();
+
+		// Remember fields of record.
+		MarcRecord::FieldRefList fieldRefs = record.getFields();
+		std::vector<MarcRecord::Field *> fields;
+		for (MarcRecord::FieldRefIt fieldRefIt = fieldRefs.begin();
+			fieldRefIt != fieldRefs.end(); fieldRefIt++)
+		{
+			fields.push_back(&**fieldRefIt);
+		}
+
+		// Remove subfield and check that it is reused.
+		MarcRecord::FieldIt fieldIt = record.getField("200");
+		MarcRecord::SubfieldIt subfieldIt = fieldIt->getSubfield('a');
+		MarcRecord::Subfield *subfield = &*subfieldIt;
+		fieldIt->removeSubfield(subfieldIt);
+		if (&*fieldIt->addSubfield('e', "added") != subfield) {
+			throw std::string("removed subfield is not reused");
+		}
+
+		// Remove some fields, then clear record.
+		record.removeField(record.getField("001"));
+		record.clear();
+
+		// Fill cleared record again reusing removed storage.
+		record = recordCopy;
+		if (record.toString() != recordText
+			|| recordCopy.toString() != recordText)
+		{
+			throw std::string("record content changed");
+		}
+		fieldRefs = record.getFields();
+		if (fieldRefs.size() != fields.size()) {
+			throw std::string("invalid number of fields");
+		}
+		for (MarcRecord::FieldRefIt fieldRefIt = fieldRefs.begin();
+			fieldRefIt != fieldRefs.end(); fieldRefIt++)
+		{
+			if (std::find(fields.begin(), fields.end(),
+				&**fieldRefIt) == fields.end())
+			{
+				throw std::string("removed field is not "
+					"reused");
+			}
+		}
+
+		// Edit record.
+		fieldIt = record.getField("200");
+		fieldIt->addSubfieldBefore(fieldIt->getSubfield('b'), 'e',
+			"added");
+		fieldIt->removeSubfield(fieldIt->getSubfield('a'));
+		record.addControlFieldBefore(record.getField("001"), "005",
+			"20130101");
+		record.removeField(record.getField("001"));
+
+		// Print content of record.
+		printf("%s\n", record.toString().c_str());
+	} catch (std::string errorMessage) {
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test21(void)
+{
+	FILE *outputFile = NULL;
+
+	printf("[21] MarcIsoWriter size limits\n");
+
+	try {
+		// Open output file.
+		outputFile = fopen("test_021.iso", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+
+		// Initialize ISO 2709 writer.
+		MarcIsoWriter marcIsoWriter(outputFile);
+
+		// Write record with field exceeding ISO 2709 limit.
+		MarcRecord record(MarcRecord::UNIMARC);
+		MarcRecord::FieldIt fieldIt = record.addDataField("300");
+		fieldIt->addSubfield('a', std::string(10000, 'a'));
+		if (marcIsoWriter.write(record)) {
+			throw std::string("oversized field is written");
+		}
+		printf("Field of 10004 bytes: %s\n",
+			marcIsoWriter.getErrorMessage().c_str());
+
+		// Write record exceeding ISO 2709 limit.
+		record.clear();
+		for (int i = 0; i < 12; i++) {
+			fieldIt = record.addDataField("300");
+			fieldIt->addSubfield('a', std::string(9000, 'a'));
+		}
+		if (marcIsoWriter.write(record)) {
+			throw std::string("oversized record is written");
+		}
+		printf("Record of 12 fields: %s\n",
+			marcIsoWriter.getErrorMessage().c_str());
+
+		// Write record close to ISO 2709 limit.
+		record.clear();
+		for (int i = 0; i < 10; i++) {
+			fieldIt = record.addDataField("300");
+			fieldIt->addSubfield('a', std::string(9900, 'a'));
+		}
+		if (!marcIsoWriter.write(record)) {
+			throw marcIsoWriter.getErrorMessage();
+		}
+		printf("Record of 10 fields: written\n");
+
+		// Close output file.
+		fclose(outputFile);
+		outputFile = NULL;
+
+		// Read written record.
+		MarcRecord readRecord;
+		outputFile = fopen("test_021.iso", "rb");
+		if (outputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+		MarcIsoReader marcIsoReader(outputFile);
+		if (!marcIsoReader.next(readRecord)) {
+			throw marcIsoReader.getErrorMessage();
+		}
+		MarcRecord::FieldRefList fieldList =
+			readRecord.getFields("300");
+		if (fieldList.size() != 10 || fieldList.back()->getSubfield(
+			'a')->getData() != std::string(9900, 'a'))
+		{
+			throw std::string("written record differs");
+		}
+		printf("Record length: %.5s\n",
+			readRecord.getLeader().recordLength);
+
+		// Close input file.
+		fclose(outputFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (outputFile) {
+			fclose(outputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test22(void)
+{
+	FILE *inputFile = NULL, *lazyInputFile = NULL;
+
+	printf("[22] MarcIsoReader in lazy mode\n");
+
+	try {
+		// Open ISO 2709 file twice.
+		inputFile = fopen("test_003.iso", "rb");
+		lazyInputFile = fopen("test_003.iso", "rb");
+		if (inputFile == NULL || lazyInputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+
+		// Initialize ISO 2709 readers.
+		MarcIsoReader marcIsoReader(inputFile, "CP1251");
+		MarcIsoReader lazyMarcIsoReader(lazyInputFile, "CP1251");
+		lazyMarcIsoReader.setLazyMode();
+
+		// Compare records read in normal and lazy modes.
+		MarcRecord record, lazyRecord;
+		int numRecords = 0;
+		while (marcIsoReader.next(record)) {
+			if (!lazyMarcIsoReader.next(lazyRecord)) {
+				throw lazyMarcIsoReader.getErrorMessage();
+			}
+
+			// Check access to single field.
+			MarcRecord::FieldIt fieldIt = record.getField("200");
+			MarcRecord::FieldIt lazyFieldIt =
+				lazyRecord.getField("200");
+			if ((fieldIt == record.nullField())
+				!= (lazyFieldIt == lazyRecord.nullField())
+				|| (fieldIt != record.nullField()
+				&& fieldIt->toString()
+				!= lazyFieldIt->toString()))
+			{
+				throw std::string("field decoding failed");
+			}
+
+			// Check copy and content of whole record.
+			MarcRecord recordCopy(lazyRecord);
+			if (recordCopy.toString() != record.toString()
+				|| lazyRecord.toString() != record.toString())
+			{
+				throw std::string("record decoding failed");
+			}
+
+			numRecords++;
+		}
+
+		// Check error codes.
+		if (marcIsoReader.getErrorCode() != MarcReader::END_OF_FILE) {
+			throw marcIsoReader.getErrorMessage();
+		}
+		if (lazyMarcIsoReader.next(lazyRecord)) {
+			throw std::string("unexpected record in lazy mode");
+		}
+
+		// Fields accessed after reopening reader must not be decoded.
+		rewind(lazyInputFile);
+		lazyMarcIsoReader.open(lazyInputFile, "CP1251");
+		lazyMarcIsoReader.setLazyMode();
+		if (!lazyMarcIsoReader.next(lazyRecord)) {
+			throw lazyMarcIsoReader.getErrorMessage();
+		}
+
+		// Undecoded field added to other record must be left empty.
+		MarcRecord::FieldIt fieldIt = lazyRecord.getField("");
+		fieldIt++;
+		record.clear();
+		record.addField(*fieldIt);
+		MarcRecord::FieldIt addedFieldIt = record.getField("");
+		if (!addedFieldIt->getSubfields().empty()
+			|| !addedFieldIt->getData().empty()
+			|| record.getDecodeErrorMessage().empty())
+		{
+			throw std::string("undecoded field added to "
+				"other record");
+		}
+
+		rewind(lazyInputFile);
+		lazyMarcIsoReader.open(lazyInputFile, "CP1251");
+		if (lazyRecord.getField("200")->getSubfields().size() != 0
+			|| lazyRecord.getDecodeErrorMessage().empty())
+		{
+			throw std::string("field decoded after reopening "
+				"reader");
+		}
+
+		// Print number of records.
+		printf("Records: %d\n", numRecords);
+
+		// Close ISO 2709 files.
+		fclose(inputFile);
+		fclose(lazyInputFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (inputFile) {
+			fclose(inputFile);
+		}
+		if (lazyInputFile) {
+			fclose(lazyInputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test23(void)
+{
+	const char *fieldTags[] = { "", "001", "200", "461", "899", "999",
+		"?00", NULL };
+
+	printf("[23] Tag index of record\n");
+
+	try {
+		// Create new MARC record and its copy with tag index.
+		MarcRecord record = createRecord1();
+		MarcRecord indexedRecord(record);
+		indexedRecord.setTagIndexMode();
+
+		for (int pass = 0; pass < 2; pass++) {
+			// Compare fields found with and without tag index.
+			for (int tagNo = 0; fieldTags[tagNo] != NULL; tagNo++) {
+				std::string fieldTag = fieldTags[tagNo];
+				MarcRecord::FieldRefList fieldList =
+					record.getFields(fieldTag);
+				MarcRecord::FieldRefList indexedFieldList =
+					indexedRecord.getFields(fieldTag);
+				if (fieldList.size()
+					!= indexedFieldList.size())
+				{
+					throw std::string(
+						"invalid number of fields");
+				}
+
+				MarcRecord::FieldRefIt fieldIt =
+					fieldList.begin();
+				MarcRecord::FieldRefIt indexedFieldIt =
+					indexedFieldList.begin();
+				for (; fieldIt != fieldList.end();
+					fieldIt++, indexedFieldIt++)
+				{
+					if ((*fieldIt)->toString() !=
+						(*indexedFieldIt)->toString())
+					{
+						throw std::string(
+							"invalid field");
+					}
+				}
+
+				if ((record.getField(fieldTag)
+					== record.nullField())
+					!= (indexedRecord.getField(fieldTag)
+					== indexedRecord.nullField()))
+				{
+					throw std::string("invalid field");
+				}
+			}
+
+			// Edit records.
+			MarcRecord *records[] = { &record, &indexedRecord };
+			for (int recordNo = 0; recordNo < 2; recordNo++) {
+				MarcRecord::FieldIt fieldIt =
+					records[recordNo]->addDataFieldBefore(
+					records[recordNo]->getField("200"),
+					"899", '1', '2');
+				fieldIt->addSubfield('a', "added");
+				records[recordNo]->addControlField("999",
+					"end");
+				records[recordNo]->removeField(
+					records[recordNo]->getField(
+					pass == 0 ? "461" : "463"));
+			}
+		}
+
+		// Print fields found by tag index.
+		MarcRecord::FieldRefList fieldList =
+			indexedRecord.getFields("899");
+		for (MarcRecord::FieldRefIt fieldIt = fieldList.begin();
+			fieldIt != fieldList.end(); fieldIt++)
+		{
+			printf("%s\n", (*fieldIt)->toString().c_str());
+		}
+	} catch (std::string errorMessage) {
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test24(void)
+{
+	printf("[24] Iteration of fields and subfields\n");
+
+	try {
+		// Create new MARC record.
+		MarcRecord record = createRecord1();
+
+		// Iterate fields with tag and compare them with list of fields.
+		MarcRecord::FieldRefList fieldList = record.getFields("899");
+		MarcRecord::FieldRefIt fieldRefIt = fieldList.begin();
+		MarcRecord::FieldIt fieldIt = record.getField("899");
+		for (; fieldIt != record.nullField();
+			fieldIt = record.nextField(fieldIt, "899"),
+			fieldRefIt++)
+		{
+			if (fieldRefIt == fieldList.end()
+				|| *fieldRefIt != fieldIt)
+			{
+				throw std::string("invalid field");
+			}
+
+			// Iterate subfields with identifier.
+			MarcRecord::SubfieldRefList subfieldList =
+				fieldIt->getSubfields('e');
+			MarcRecord::SubfieldRefIt subfieldRefIt =
+				subfieldList.begin();
+			MarcRecord::SubfieldIt subfieldIt =
+				fieldIt->getSubfield('e');
+			for (; subfieldIt != fieldIt->nullSubfield();
+				subfieldIt = fieldIt->nextSubfield(
+					subfieldIt, 'e'), subfieldRefIt++)
+			{
+				if (subfieldRefIt == subfieldList.end()
+					|| *subfieldRefIt != subfieldIt)
+				{
+					throw std::string("invalid subfield");
+				}
+				printf("%s $e %s\n", fieldIt->getTag().c_str(),
+					subfieldIt->getData().c_str());
+			}
+			if (subfieldRefIt != subfieldList.end()) {
+				throw std::string(
+					"invalid number of subfields");
+			}
+		}
+		if (fieldRefIt != fieldList.end()) {
+			throw std::string("invalid number of fields");
+		}
+
+		// Iterate embedded fields with tag.
+		fieldIt = record.getField("461");
+		MarcRecord::EmbeddedFieldList embeddedFieldList =
+			fieldIt->getEmbeddedFields("801");
+		MarcRecord::EmbeddedFieldIt embeddedFieldIt =
+			embeddedFieldList.begin();
+		MarcRecord::SubfieldIt subfieldIt =
+			fieldIt->firstEmbeddedField("801");
+		for (; subfieldIt != fieldIt->nullSubfield();
+			subfieldIt = fieldIt->nextEmbeddedField(
+				subfieldIt, "801"), embeddedFieldIt++)
+		{
+			if (embeddedFieldIt == embeddedFieldList.end()
+				|| embeddedFieldIt->front() != subfieldIt)
+			{
+				throw std::string("invalid embedded field");
+			}
+			printf("461 $1 %s\n", subfieldIt->getData().c_str());
+		}
+		if (embeddedFieldIt != embeddedFieldList.end()) {
+			throw std::string("invalid number of embedded fields");
+		}
+	} catch (std::string errorMessage) {
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test25(void)
+{
+	printf("[25] Field tags\n");
+
+	try {
+		// Check comparison and classification of tags.
+		Tag tag("200");
+		if (tag != "200" || tag != std::string("200") || tag == "20"
+			|| tag == std::string("2000") || tag.isControlTag()
+			|| !(Tag("005") < tag) || !Tag("005").isControlTag()
+			|| !Tag().empty() || !Tag().isControlTag())
+		{
+			throw std::string("invalid tag comparison");
+		}
+
+		// Check that long tags are truncated.
+		tag = std::string("9001");
+		if (tag.size() != 3 || tag.str() != "900") {
+			throw std::string("invalid tag truncation");
+		}
+
+		// Check tags of fields.
+		MarcRecord record = createRecord1();
+		MarcRecord::FieldIt fieldIt = record.getField("461");
+		fieldIt->setTag("462");
+		if (record.getField("462") != fieldIt
+			|| fieldIt->getTag() != "462")
+		{
+			throw std::string("invalid field tag");
+		}
+		printf("%s\n", fieldIt->toString().c_str());
+	} catch (std::string errorMessage) {
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test26(void)
+{
+	printf("[26] Swap of records, fields and subfields\n");
+
+	try {
+		// Create new MARC records.
+		MarcRecord record1 = createRecord1();
+		MarcRecord record2 = createRecord2();
+		std::string recordText1 = record1.toString();
+		std::string recordText2 = record2.toString();
+
+		// Swap records.
+		record1.swap(record2);
+		if (record1.toString() != recordText2
+			|| record2.toString() != recordText1)
+		{
+			throw std::string("invalid content of swapped records");
+		}
+
+		// Build field and move it to record.
+		MarcRecord::Field field("700", '1', ' ');
+		field.addSubfield('a', "Author");
+		MarcRecord::Subfield subfield('b', "Name");
+		field.addSubfield()->swap(subfield);
+		record1.addDataField()->swap(field);
+		if (!field.getTag().empty() || !subfield.getData().empty()) {
+			throw std::string("invalid content of swapped field");
+		}
+
+		// Print content of record.
+		printf("%s\n", record1.toString().c_str());
+	} catch (std::string errorMessage) {
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test27(void)
+{
+	FILE *outputFile = NULL, *nextFile = NULL;
+
+	printf("[27] Buffered output\n");
+
+	try {
+		// Open ISO 2709 file.
+		outputFile = fopen("test_027.iso", "w+b");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+
+		// Initialize ISO 2709 writer with output buffer.
+		MarcIsoWriter marcIsoWriter(outputFile, "CP1251");
+		marcIsoWriter.setBufferSize(4096);
+
+		// Write MARC records, they must be kept in buffer.
+		MarcRecord record1 = createRecord1();
+		MarcRecord record2 = createRecord2();
+		if (!marcIsoWriter.write(record1)
+			|| !marcIsoWriter.write(record2))
+		{
+			throw marcIsoWriter.getErrorMessage();
+		}
+		if (ftell(outputFile) != 0) {
+			throw std::string("records are not buffered");
+		}
+
+		// Write records with buffer smaller than record size.
+		if (!marcIsoWriter.setBufferSize(16)
+			|| !marcIsoWriter.write(record1)
+			|| !marcIsoWriter.write(record2)
+			|| !marcIsoWriter.flush())
+		{
+			throw marcIsoWriter.getErrorMessage();
+		}
+
+		// Compare output with unbuffered output of test 9.
+		std::string expectedData, outputData;
+		char buf[1024];
+		size_t len;
+		FILE *inputFile = fopen("test_003.iso", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+		while ((len = fread(buf, 1, sizeof(buf), inputFile)) > 0) {
+			expectedData.append(buf, len);
+		}
+		fclose(inputFile);
+		expectedData += expectedData;
+		rewind(outputFile);
+		while ((len = fread(buf, 1, sizeof(buf), outputFile)) > 0) {
+			outputData.append(buf, len);
+		}
+		if (outputData != expectedData) {
+			throw std::string("invalid content of buffered output");
+		}
+
+		// Reopen writer, buffered record must go to previous file.
+		nextFile = fopen("test_027_2.iso", "w+b");
+		if (nextFile == NULL) {
+			throw std::string("can't open output file");
+		}
+		long outputSize = ftell(outputFile);
+		if (!marcIsoWriter.setBufferSize(4096)
+			|| !marcIsoWriter.write(record1)
+			|| !marcIsoWriter.open(nextFile, "CP1251")
+			|| !marcIsoWriter.write(record2))
+		{
+			throw marcIsoWriter.getErrorMessage();
+		}
+		marcIsoWriter.close();
+		outputData.erase();
+		fseek(outputFile, outputSize, SEEK_SET);
+		while ((len = fread(buf, 1, sizeof(buf), outputFile)) > 0) {
+			outputData.append(buf, len);
+		}
+		std::string nextData;
+		rewind(nextFile);
+		while ((len = fread(buf, 1, sizeof(buf), nextFile)) > 0) {
+			nextData.append(buf, len);
+		}
+		if (outputData.empty() || nextData.empty()
+			|| outputData + nextData
+			!= expectedData.substr(0, expectedData.size() / 2))
+		{
+			throw std::string("invalid output of reopened writer");
+		}
+
+		// Close ISO 2709 files.
+		fclose(outputFile);
+		fclose(nextFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (outputFile) {
+			fclose(outputFile);
+		}
+		if (nextFile) {
+			fclose(nextFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test28(void)
+{
+	printf("[28] Single-byte encoding converter\n");
+
+	try {
+		// Initialize converters.
+		SingleByteCodec codec;
+		if (codec.init("UTF-16") || codec.isValid()) {
+			throw std::string("multibyte encoding is accepted");
+		}
+		if (!codec.init("CP1251")) {
+			throw std::string("can't initialize converter");
+		}
+
+		// Convert text to CP1251 and back.
+		std::string text = "Test \xD0\x9F\xD1\x80\xD0\xB8\xD0\xB2"
+			"\xD0\xB5\xD1\x82 \xE2\x84\x96 1";
+		std::string encodedText, decodedText;
+		if (!codec.encode(text.data(), text.size(), encodedText)
+			|| encodedText != "Test \xCF\xF0\xE8\xE2\xE5\xF2 \xB9 1"
+			|| !codec.decode(encodedText.data(), encodedText.size(),
+			decodedText)
+			|| decodedText != text)
+		{
+			throw std::string("invalid conversion");
+		}
+
+		// Check that missing characters are not converted.
+		text = "\xE4\xB8\xAD";
+		if (codec.encode(text.data(), text.size(), encodedText)) {
+			throw std::string("missing character is converted");
+		}
+	} catch (std::string errorMessage) {
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test29(void)
+{
+	FILE *outputFile = NULL, *inputFile = NULL;
+
+	printf("[29] MARC-8 and ISO 5426 character set converters\n");
+
+	try {
+		// Initialize converter.
+		MarcCharsetCodec codec;
+		if (codec.init("CP1251") || codec.isValid()) {
+			throw std::string("unknown character set is accepted");
+		}
+		if (!codec.init("MARC-8") || codec.getCharset()
+			!= MarcCharsetCodec::CHARSET_MARC8)
+		{
+			throw std::string("can't initialize converter");
+		}
+
+		// Convert text to MARC-8 and back.
+		std::string text = "Caf\xC3\xA9 \xC5\x81\xC3\xB3" "d\xC5\xBA "
+			"H\xE2\x82\x82O \xD0\x9C\xD0\xB8\xD1\x80";
+		std::string decomposedText = "Cafe\xCC\x81 \xC5\x81o\xCC\x81"
+			"dz\xCC\x81 H\xE2\x82\x82O \xD0\x9C\xD0\xB8\xD1\x80";
+		std::string encodedText, decodedText;
+		if (!codec.encode(text.data(), text.size(), encodedText)
+			|| encodedText != "Caf\xE2" "e \xA1\xE2" "od\xE2z "
+			"H\x1B" "b2\x1Bs" "O \x1B(NmIR\x1B(B"
+			|| !codec.decode(encodedText.data(), encodedText.size(),
+			decodedText)
+			|| decodedText != decomposedText)
+		{
+			throw std::string("invalid conversion");
+		}
+
+		// Decode standard designations of ANSEL and multibyte set.
+		encodedText = "\x1B(!E!\x1B(Bx\x1B)!E\xA1"
+			"\x1B$1\x1B(Babc\x1B$)1d";
+		if (!codec.decode(encodedText.data(), encodedText.size(),
+			decodedText)
+			|| decodedText != "\xC5\x81x\xC5\x81" "abcd")
+		{
+			throw std::string("invalid escape sequences");
+		}
+
+		// Check that unsupported graphic sets are not converted.
+		encodedText = "\x1B$1!!!";
+		if (codec.decode(encodedText.data(), encodedText.size(),
+			decodedText))
+		{
+			throw std::string("unsupported set is converted");
+		}
+
+		// Convert ISO 5426 text with non-sort markers and quotes.
+		MarcCharsetCodec iso5426Codec;
+		if (!iso5426Codec.init("ISO5426") || iso5426Codec.getCharset()
+			!= MarcCharsetCodec::CHARSET_ISO5426)
+		{
+			throw std::string("can't initialize converter");
+		}
+		encodedText = "\x88The \x89\xAA" "B\xC2" "a\xBA \xA9x\xB9 "
+			"\xA2y\xB2 1\xA8 2\xB8 \xAC\xBC \xBD\xBE";
+		text = "\xC2\x98The \xC2\x9C\xE2\x80\x9C" "Ba\xCC\x81"
+			"\xE2\x80\x9D \xE2\x80\x98x\xE2\x80\x99 "
+			"\xE2\x80\x9Ey\xE2\x80\x9A 1\xE2\x80\xB2 "
+			"2\xE2\x80\xB3 \xE2\x99\xAD\xE2\x99\xAF "
+			"\xCA\xB9\xCA\xBA";
+		std::string reencodedText;
+		if (!iso5426Codec.decode(encodedText.data(), encodedText.size(),
+			decodedText) || decodedText != text
+			|| !iso5426Codec.encode(decodedText.data(),
+			decodedText.size(), reencodedText)
+			|| reencodedText != encodedText)
+		{
+			throw std::string("invalid ISO 5426 conversion");
+		}
+
+		// Write record to ISO 2709 file in MARC-8 encoding.
+		MarcRecord record = createRecord1();
+		outputFile = fopen("test_029.iso", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't create output file");
+		}
+		MarcIsoWriter marcIsoWriter(outputFile, "MARC-8");
+		if (!marcIsoWriter.write(record)) {
+			throw marcIsoWriter.getErrorMessage();
+		}
+		marcIsoWriter.close();
+		fclose(outputFile);
+		outputFile = NULL;
+
+		// Read record back and compare it with original.
+		inputFile = fopen("test_029.iso", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+		MarcIsoReader marcIsoReader(inputFile, "MARC-8");
+		MarcRecord readRecord;
+		if (!marcIsoReader.next(readRecord)) {
+			throw marcIsoReader.getErrorMessage();
+		}
+		// Compare fields only, leader is updated by writer.
+		readRecord.setLeader(record.getLeader());
+		if (readRecord.toString() != record.toString()) {
+			throw std::string("record is changed after conversion");
+		}
+		marcIsoReader.close();
+		fclose(inputFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (outputFile) {
+			fclose(outputFile);
+		}
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test30(void)
+{
+	FILE *inputFile = NULL;
+
+	printf("[30] MarcXmlReader input blocks\n");
+
+	try {
+		// Read records from MARCXML file with default block size.
+		std::string expectedText;
+		MarcRecord record(MarcRecord::UNIMARC);
+		inputFile = fopen("test_013.xml", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+		MarcXmlReader marcXmlReader(inputFile);
+		while (marcXmlReader.next(record)) {
+			expectedText += record.toString();
+		}
+		if (marcXmlReader.getErrorCode()
+			!= MarcXmlReader::END_OF_FILE)
+		{
+			throw marcXmlReader.getErrorMessage();
+		}
+		if (expectedText.empty()) {
+			throw std::string("no records read");
+		}
+
+		// Read records with blocks splitting elements.
+		std::string recordText;
+		rewind(inputFile);
+		if (!marcXmlReader.open(inputFile)
+			|| marcXmlReader.setBufferSize(0)
+			|| !marcXmlReader.setBufferSize(7))
+		{
+			throw std::string("can't set buffer size");
+		}
+		while (marcXmlReader.next(record)) {
+			recordText += record.toString();
+		}
+		if (marcXmlReader.getErrorCode()
+			!= MarcXmlReader::END_OF_FILE
+			|| recordText != expectedText)
+		{
+			throw std::string("invalid records read with "
+				"small buffer");
+		}
+		fclose(inputFile);
+		inputFile = NULL;
+
+		// Read records from memory-mapped file with both block sizes.
+		size_t bufferSizes[] = { 7, 256 * 1024 };
+		for (size_t i = 0; i < 2; i++) {
+			recordText.erase();
+			if (!marcXmlReader.openMapped("test_013.xml")
+				|| !marcXmlReader.setBufferSize(bufferSizes[i]))
+			{
+				throw marcXmlReader.getErrorMessage();
+			}
+			while (marcXmlReader.next(record)) {
+				recordText += record.toString();
+			}
+			if (marcXmlReader.getErrorCode()
+				!= MarcXmlReader::END_OF_FILE
+				|| recordText != expectedText)
+			{
+				throw std::string("invalid records read from "
+					"memory-mapped file");
+			}
+		}
+		marcXmlReader.close();
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test31(void)
+{
+	FILE *outputFile = NULL, *inputFile = NULL;
+
+	printf("[31] MarcXmlReader with namespaces\n");
+
+	try {
+		// Write OAI-PMH response with prefixed MARCXML record.
+		outputFile = fopen("test_031.xml", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+		fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<OAI-PMH xmlns="
+			"\"http://www.openarchives.org/OAI/2.0/\">"
+			"<ListRecords>\n"
+			"<record><header status=\"deleted\">"
+			"<identifier>1</identifier></header></record>\n"
+			"<record><header><identifier>2</identifier></header>"
+			"<metadata>\n"
+			"<marc:record xmlns:marc="
+			"\"http://www.loc.gov/MARC21/slim\">\n"
+			"<marc:leader>00000nam  2200000   450 </marc:leader>\n"
+			"<marc:controlfield tag=\"001\">12345"
+			"</marc:controlfield>\n"
+			"<marc:datafield tag=\"200\" ind1=\"0\" ind2=\"1\">"
+			"<marc:subfield code=\"a\">abc</marc:subfield>"
+			"<marc:subfield code=\"b\">defg</marc:subfield>"
+			"</marc:datafield>\n"
+			"</marc:record>\n"
+			"</metadata></record>\n"
+			"</ListRecords></OAI-PMH>\n", outputFile);
+		fclose(outputFile);
+		outputFile = NULL;
+
+		// Read records.
+		inputFile = fopen("test_031.xml", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+		MarcXmlReader marcXmlReader(inputFile);
+		MarcRecord record(MarcRecord::UNIMARC);
+		std::string recordText;
+		while (marcXmlReader.next(record)) {
+			recordText += record.toString();
+		}
+		if (marcXmlReader.getErrorCode()
+			!= MarcXmlReader::END_OF_FILE)
+		{
+			throw marcXmlReader.getErrorMessage();
+		}
+		printf("%s\n", recordText.c_str());
+
+		// Close MARCXML file.
+		fclose(inputFile);
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (outputFile) {
+			fclose(outputFile);
+		}
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test32(void)
+{
+	FILE *outputFile = NULL, *inputFile = NULL;
+
+	printf("[32] MarcXmlParallelReader\n");
+
+	try {
+		// Write MARCXML file with markup resembling record elements.
+		outputFile = fopen("test_032.xml", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+		fputs("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<collection "
+			"xmlns=\"http://www.loc.gov/MARC21/slim\">\n"
+			"<!-- <record> -->\n"
+			"<record><leader>00000nam  2200000   450 </leader>"
+			"<datafield tag=\"200\" ind1=\">\" ind2=\" \">"
+			"<subfield code=\"a\"><![CDATA[</record>]]></subfield>"
+			"</datafield></record>\n"
+			"<marc:record xmlns:marc="
+			"\"http://www.loc.gov/MARC21/slim\">"
+			"<marc:controlfield tag=\"001\">2</marc:controlfield>"
+			"</marc:record>\n"
+			"<record><controlfield tag=\"001\">3</controlfield>"
+			"</record>\n"
+			"</collection>\n", outputFile);
+		fclose(outputFile);
+		outputFile = NULL;
+
+		// Read records with sequential reader.
+		inputFile = fopen("test_032.xml", "rb");
+		if (inputFile == NULL) {
+			throw std::string("can't open input file");
+		}
+		MarcXmlReader marcXmlReader(inputFile);
+		MarcRecord record(MarcRecord::UNIMARC);
+		std::string expectedText;
+		while (marcXmlReader.next(record)) {
+			expectedText += record.toString();
+		}
+		if (marcXmlReader.getErrorCode()
+			!= MarcXmlReader::END_OF_FILE)
+		{
+			throw marcXmlReader.getErrorMessage();
+		}
+
+		// Read records with parallel reader, one record per batch.
+		rewind(inputFile);
+		MarcXmlParallelReader marcXmlParallelReader(inputFile, NULL, 2);
+		marcXmlParallelReader.setBatchSize(1);
+		std::string recordText;
+		while (marcXmlParallelReader.next(record)) {
+			printf("%s\n", record.toString().c_str());
+			recordText += record.toString();
+		}
+		if (marcXmlParallelReader.getErrorCode()
+			!= MarcReader::END_OF_FILE)
+		{
+			throw marcXmlParallelReader.getErrorMessage();
+		}
+		if (recordText != expectedText) {
+			throw std::string("records differ from sequential "
+				"reader");
+		}
+		fclose(inputFile);
+		inputFile = NULL;
+
+		// Read records from memory-mapped file.
+		recordText.erase();
+		if (!marcXmlParallelReader.openMapped("test_032.xml")) {
+			throw marcXmlParallelReader.getErrorMessage();
+		}
+		while (marcXmlParallelReader.next(record)) {
+			recordText += record.toString();
+		}
+		if (marcXmlParallelReader.getErrorCode()
+			!= MarcReader::END_OF_FILE
+			|| recordText != expectedText)
+		{
+			throw std::string("invalid records read from "
+				"memory-mapped file");
+		}
+
+		// Read rest of records in unordered mode after next().
+		int numRecords = 0;
+		if (!marcXmlParallelReader.openMapped("test_032.xml")
+			|| !marcXmlParallelReader.next(record)
+			|| !marcXmlParallelReader.read(countRecord, &numRecords,
+			false)
+			|| numRecords != 2)
+		{
+			throw std::string("records read ahead are lost");
+		}
+
+		// Read all records in unordered mode.
+		numRecords = 0;
+		if (!marcXmlParallelReader.openMapped("test_032.xml")
+			|| !marcXmlParallelReader.read(countRecord, &numRecords,
+			false)
+			|| numRecords != 3)
+		{
+			throw std::string("records are lost in unordered mode");
+		}
+
+		// Read records after stop of unordered mode.
+		numRecords = 0;
+		if (!marcXmlParallelReader.openMapped("test_032.xml")
+			|| !marcXmlParallelReader.read(stopReading, &numRecords,
+			false))
+		{
+			throw marcXmlParallelReader.getErrorMessage();
+		}
+		while (marcXmlParallelReader.next(record)) {
+			numRecords++;
+		}
+		if (numRecords != 3) {
+			throw std::string("records read ahead by unordered "
+				"mode are lost");
+		}
+		marcXmlParallelReader.close();
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (outputFile) {
+			fclose(outputFile);
+		}
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+bool
+test33(void)
+{
+	FILE *outputFile = NULL, *inputFile = NULL;
+
+	printf("[33] MarcXmlParallelReader with built-in parser\n");
+
+	try {
+		// Write MARCXML file with entities and self-closing elements.
+		outputFile = fopen("test_033.xml", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+		fputs("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+			"<collection "
+			"xmlns=\"http://www.loc.gov/MARC21/slim\">\n"
+			"<record>\n"
+			"  <leader>00000nam  2200000   450 </leader>\n"
+			"  <controlfield tag=\"001\">1</controlfield>\n"
+			"  <datafield tag='200' ind1=\"1\" ind2=\" \" >\n"
+			"    <subfield code=\"a\">A &amp; B &lt;&#67;&#x44;&gt;"
+			"</subfield>\n"
+			"    <subfield code=\"e\"/>\n"
+			"    <subfield code=\"f\">\xD0\x90\xD0\x91 &quot;"
+			"&apos;</subfield>\n"
+			"  </datafield>\n</record>\n"
+			"<marc:record xmlns:marc="
+			"\"http://www.loc.gov/MARC21/slim\">"
+			"<marc:controlfield tag=\"001\">2</marc:controlfield>"
+			"<marc:datafield tag=\"300\" ind1=\" \" ind2=\" \">"
+			"<marc:subfield code=\"a\">note</marc:subfield>"
+			"</marc:datafield></marc:record>\n"
+			"<record><controlfield tag=\"001\">3</controlfield>"
+			"<datafield tag=\"700\" ind1=\" \" ind2=\"1\">"
+			"<subfield code=\"a\"><![CDATA[<x>]]></subfield>"
+			"</datafield></record>\n"
+			"</collection>\n", outputFile);
+		fclose(outputFile);
+		outputFile = NULL;
+
+		// Write MARCXML file with namespaces declared in context.
+		outputFile = fopen("test_033_2.xml", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+		fputs("<collection xmlns=\"http://example.org/\" "
+			"xmlns:m=\"http://www.loc.gov/MARC21/slim\" "
+			"xmlns:x=\"http://example.org/\">\n"
+			"<record><controlfield tag=\"001\">1</controlfield>"
+			"</record>\n"
+			"<m:record><m:controlfield tag=\"001\">2"
+			"</m:controlfield></m:record>\n"
+			"<x:record><x:controlfield tag=\"001\">3"
+			"</x:controlfield></x:record>\n"
+			"<record xmlns=\"info:lc/xmlns/marcxchange-v1\">"
+			"<controlfield tag=\"001\">4</controlfield>"
+			"</record>\n"
+			"</collection>\n", outputFile);
+		fclose(outputFile);
+		outputFile = NULL;
+
+		const char *fileNames[] = {
+			"test_033.xml", "test_032.xml", "test_033_2.xml"
+		};
+		for (int fileNo = 0; fileNo < 3; fileNo++) {
+			// Read records with sequential reader.
+			inputFile = fopen(fileNames[fileNo], "rb");
+			if (inputFile == NULL) {
+				throw std::string("can't open input file");
+			}
+			MarcXmlReader marcXmlReader(inputFile);
+			MarcRecord record(MarcRecord::UNIMARC);
+			std::string expectedText;
+			while (marcXmlReader.next(record)) {
+				expectedText += record.toString();
+			}
+			if (marcXmlReader.getErrorCode()
+				!= MarcXmlReader::END_OF_FILE)
+			{
+				throw marcXmlReader.getErrorMessage();
+			}
+			fclose(inputFile);
+			inputFile = NULL;
+
+			// Read records with built-in parser.
+			for (unsigned int numThreads = 1; numThreads <= 2;
+				numThreads++)
+			{
+				MarcXmlParallelReader marcXmlParallelReader(
+					NULL, NULL, numThreads);
+				marcXmlParallelReader.setBuiltinParser();
+				marcXmlParallelReader.setBatchSize(1);
+				if (!marcXmlParallelReader.openMapped(
+					fileNames[fileNo]))
+				{
+					throw marcXmlParallelReader
+						.getErrorMessage();
+				}
+				std::string recordText;
+				while (marcXmlParallelReader.next(record)) {
+					if (fileNo == 0 && numThreads == 1) {
+						std::string recordString =
+							record.toString();
+						printf("%s\n",
+							recordString.c_str());
+					}
+					recordText += record.toString();
+				}
+				if (marcXmlParallelReader.getErrorCode()
+					!= MarcReader::END_OF_FILE)
+				{
+					throw marcXmlParallelReader
+						.getErrorMessage();
+				}
+				if (recordText != expectedText) {
+					throw std::string("records differ "
+						"from sequential reader");
+				}
+			}
+		}
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (outputFile) {
+			fclose(outputFile);
+		}
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
+/*
+ * Main function.
+ */
+bool
+test34(void)
+{
+	FILE *outputFile = NULL, *inputFile = NULL;
+
+	printf("[34] MarcIsoReader input blocks\n");
+
+	try {
+		// Write records spanning several input blocks and record
+		// exceeding ISO 2709 limit.
+		outputFile = fopen("test_034.iso", "wb");
+		if (outputFile == NULL) {
+			throw std::string("can't open output file");
+		}
+		MarcIsoWriter marcIsoWriter(outputFile);
+		MarcRecord expectedRecord = createRecord1();
+		for (int i = 0; i < 1000; i++) {
+			if (!marcIsoWriter.write(expectedRecord)) {
+				throw marcIsoWriter.getErrorMessage();
+			}
+		}
+		marcIsoWriter.close();
+		std::string oversizedRecord(150000, 'a');
+		oversizedRecord += '\x1D';
+		fwrite(oversizedRecord.data(), 1, oversizedRecord.size(),
+			outputFile);
+		marcIsoWriter.open(outputFile);
+		if (!marcIsoWriter.write(expectedRecord)) {
+			throw marcIsoWriter.getErrorMessage();
+		}
+		marcIsoWriter.close();
+		fclose(outputFile);
+		outputFile = NULL;
+
+		// Read records from file and memory-mapped file with and
+		// without auto-correction.
+		std::string expectedText = expectedRecord.toString();
+		for (int mode = 0; mode < 4; mode++) {
+			MarcIsoReader marcIsoReader;
+			marcIsoReader.setAutoCorrectionMode(mode % 2 == 1);
+			if (mode < 2) {
+				inputFile = fopen("test_034.iso", "rb");
+				if (inputFile == NULL) {
+					throw std::string(
+						"can't open input file");
+				}
+				marcIsoReader.open(inputFile);
+			} else if (!marcIsoReader.openMapped("test_034.iso")) {
+				throw marcIsoReader.getErrorMessage();
+			}
+
+			MarcRecord record(MarcRecord::UNIMARC);
+			int numRecords = 0, numInvalid = 0;
+			std::string errorMessage;
+			for (;;) {
+				if (marcIsoReader.next(record)) {
+					// Compare record ignoring leader.
+					record.setLeader(
+						expectedRecord.getLeader());
+					if (record.toString() != expectedText) {
+						throw std::string(
+							"record differs");
+					}
+					numRecords++;
+				} else if (marcIsoReader.getErrorCode()
+					== MarcReader::ERROR_INVALID_RECORD)
+				{
+					errorMessage =
+						marcIsoReader.getErrorMessage();
+					numInvalid++;
+				} else {
+					break;
+				}
+			}
+			if (marcIsoReader.getErrorCode()
+				!= MarcReader::END_OF_FILE)
+			{
+				throw marcIsoReader.getErrorMessage();
+			}
+			printf("%s%s: %d records, %d invalid (%s)\n",
+				mode < 2 ? "File" : "Mapped file",
+				mode % 2 == 1 ? " with auto-correction" : "",
+				numRecords, numInvalid, errorMessage.c_str());
+			if (numRecords != 1001 || numInvalid != 1) {
+				throw std::string("wrong number of records");
+			}
+
+			if (inputFile) {
+				fclose(inputFile);
+				inputFile = NULL;
+			}
+		}
+	} catch (std::string errorMessage) {
+		// Close files.
+		if (outputFile) {
+			fclose(outputFile);
+		}
+		if (inputFile) {
+			fclose(inputFile);
+		}
+
+		// Print error message.
+		printf("ERROR: %s.\n\n", errorMessage.c_str());
+
+		return false;
+	}
+
+	// Print status.
+	printf("OK\n\n");
+
+	return true;
+}
+
 int
 main(void)
 {
@@ -784,6 +2592,25 @@ main(void)
 	result &= test13();
 	result &= test14();
 	result &= test15();
+	result &= test16();
+	result &= test17();
+	result &= test18();
+	result &= test19();
+	result &= test20();
+	result &= test21();
+	result &= test22();
+	result &= test23();
+	result &= test24();
+	result &= test25();
+	result &= test26();
+	result &= test27();
+	result &= test28();
+	result &= test29();
+	result &= test30();
+	result &= test31();
+	result &= test32();
+	result &= test33();
+	result &= test34();
 
 	if (!result) {
 		printf("Tests failed.\n");